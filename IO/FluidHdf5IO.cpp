@@ -32,10 +32,13 @@ namespace hemo {
 void writeCEPACField_HDF5(HemoCellFields& cellfields, T dx, T dt, plint iter, string preString) {
   global.statistics.getCurrent()["writeCEPACField"].start();
 
-  WriteFluidField<plb::descriptors::AdvectionDiffusionD3Q19Descriptor> * wff = new WriteFluidField<plb::descriptors::AdvectionDiffusionD3Q19Descriptor>(cellfields, *cellfields.CEPACfield,iter,"CEPAC",dx,dt,cellfields.desiredCEPACfieldOutputVariables);
+  const plint spacing = global.CEPACcoarsening;
+  WriteFluidField<CEPAC_T,plb::descriptors::AdvectionDiffusionD3Q19Descriptor> * wff = new WriteFluidField<CEPAC_T,plb::descriptors::AdvectionDiffusionD3Q19Descriptor>(cellfields, *cellfields.CEPACfield,iter,"CEPAC",dx*spacing,dt*global.CEPACtimeStep,cellfields.desiredCEPACfieldOutputVariables,spacing);
   vector<MultiBlock3D*> wrapper;
   wrapper.push_back(cellfields.CEPACfield);
-  wrapper.push_back(cellfields.immersedParticles); //Needed for the atomicblock id, nothing else
+  if (spacing == 1) {
+    wrapper.push_back(cellfields.immersedParticles); //Needed for the atomicblock id, nothing else
+  }
   applyProcessingFunctional(wff,cellfields.CEPACfield->getBoundingBox(),wrapper);
   
   global.statistics.getCurrent().stop();
@@ -47,7 +50,7 @@ void writeFluidField_HDF5(HemoCellFields& cellfields, T dx, T dt, plint iter, st
     hlogfile << "(FluidOutput) (OutputForce) The force on the fluid field is reset to zero, If there is a bodyforce, reset it after this output function (FluidField write force, OUTPUT_FORCE)" << endl; 
     cellfields.spreadParticleForce();
   }
-  WriteFluidField<DESCRIPTOR> * wff = new WriteFluidField<DESCRIPTOR>(cellfields, *cellfields.lattice,iter,"Fluid",dx,dt,cellfields.desiredFluidOutputVariables);
+  WriteFluidField<FLUID_T,DESCRIPTOR> * wff = new WriteFluidField<FLUID_T,DESCRIPTOR>(cellfields, *cellfields.lattice,iter,"Fluid",dx,dt,cellfields.desiredFluidOutputVariables);
   vector<MultiBlock3D*> wrapper;
   wrapper.push_back(cellfields.lattice);
   wrapper.push_back(cellfields.immersedParticles); //Needed for the atomicblock id, nothing else
@@ -56,7 +59,7 @@ void writeFluidField_HDF5(HemoCellFields& cellfields, T dx, T dt, plint iter, st
     // Reset Forces on the lattice, TODO do own efficient implementation
     plb::setExternalVector(*cellfields.hemocell.lattice, (*cellfields.hemocell.lattice).getBoundingBox(),
           DESCRIPTOR<T>::ExternalField::forceBeginsAt,
-          plb::Array<T, DESCRIPTOR<T>::d>(0.0, 0.0, 0.0));
+          plb::Array<FLUID_T, DESCRIPTOR<FLUID_T>::d>(0.0, 0.0, 0.0));
   }
   
   global.statistics.getCurrent().stop();
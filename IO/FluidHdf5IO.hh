@@ -48,12 +48,14 @@ void outputHDF5(hsize_t* dim, hsize_t* chunk, hid_t& file_id, string& name, floa
     H5Sclose(sid);
 }
 
-template<template<class U> class DD>
+/// S is the storage type of the populations of the lattice (FLUID_T or CEPAC_T),
+/// spacing the distance between its nodes in fluid lattice units
+template<typename S, template<class U> class DD>
 class WriteFluidField : public BoxProcessingFunctional3D
 {
 public:
- WriteFluidField(HemoCellFields& cellfields_, MultiBlock3D & fluid_, plint iter_, string identifier_, T dx_, T dt_, vector<int> & outputVariables_) :
-    cellfields(cellfields_), fluid(fluid_), iter(iter_), identifier(identifier_), dx(dx_), dt(dt_),outputVariables(outputVariables_) { }
+ WriteFluidField(HemoCellFields& cellfields_, MultiBlock3D & fluid_, plint iter_, string identifier_, T dx_, T dt_, vector<int> & outputVariables_, plint spacing_ = 1) :
+    cellfields(cellfields_), fluid(fluid_), iter(iter_), identifier(identifier_), dx(dx_), dt(dt_), spacing(spacing_), outputVariables(outputVariables_) { }
  
  ~WriteFluidField(){};
 
@@ -74,9 +76,19 @@ public:
   void processGenericBlocks( Box3D domain, vector<AtomicBlock3D*> blocks ) {
 
     int id = global::mpi().getRank();
-    ablock = dynamic_cast<BlockLattice3D<T,DD>*>(blocks[0]);
-    particlefield = dynamic_cast<HemoCellParticleField*>(blocks[1]);
-    blockid = particlefield->atomicBlockId; //Nasty trick to prevent us from having to overload the fluid field ( palabos domain)
+    ablock = dynamic_cast<BlockLattice3D<S,DD>*>(blocks[0]);
+    if (blocks.size() > 1) {
+      particlefield = dynamic_cast<HemoCellParticleField*>(blocks[1]);
+      blockid = particlefield->atomicBlockId; //Nasty trick to prevent us from having to overload the fluid field ( palabos domain)
+    } else {
+      // A lattice with its own block structure (coarse CEPAC field), without particle based output
+      particlefield = 0;
+      for (plint bId : fluid.getMultiBlockManagement().getLocalInfo().getBlocks()) {
+        if (&fluid.getComponent(bId) == blocks[0]) {
+          blockid = bId;
+        }
+      }
+    }
 
     this->odomain = &domain; //Access for output functions
     if (outputVariables.size() == 0 ) {
@@ -103,18 +115,18 @@ public:
     int ncells = Nx*Ny*Nz;
     Dot3D rp_temp = blocks[0]->getLocation();
     int subdomainSize[]  = {int(Nz), int(Ny), int(Nx)}; //Reverse for paraview
-    float dxdydz[3] = {1.,1.,1.};
-    float relativePosition[3] = {float(rp_temp.z+domain.z0-1.5),
-                                 float(rp_temp.y+domain.y0-1.5),
-                                 float(rp_temp.x+domain.x0-1.5)}; //Reverse for paraview
+    float dxdydz[3] = {float(spacing),float(spacing),float(spacing)};
+    float relativePosition[3] = {float((rp_temp.z+domain.z0-1)*spacing-0.5),
+                                 float((rp_temp.y+domain.y0-1)*spacing-0.5),
+                                 float((rp_temp.x+domain.x0-1)*spacing-0.5)}; //Reverse for paraview
 
     if (cellfields.hemocell.outputInSiUnits) {
       relativePosition[0] *= param::dx;
       relativePosition[1] *= param::dx;
       relativePosition[2] *= param::dx;
-      dxdydz[0] = param::dx;
-      dxdydz[1] = param::dx;
-      dxdydz[2] = param::dx;
+      dxdydz[0] *= param::dx;
+      dxdydz[1] *= param::dx;
+      dxdydz[2] *= param::dx;
     }
 
     H5LTset_attribute_int (file_id, "/", "numberOfCells", &ncells, 1);
@@ -215,7 +227,7 @@ private:
   float * outputVelocity() {
     float * output = new float [(*nCells)*3];
     unsigned int n = 0;
-    plb::Array<T,3> vel;
+    plb::Array<S,3> vel;
     for (plint iZ=odomain->z0-1; iZ<=odomain->z1+1; ++iZ) {
       for (plint iY=odomain->y0-1; iY<=odomain->y1+1; ++iY) {
         for (plint iX=odomain->x0-1; iX<=odomain->x1+1; ++iX) {
@@ -353,12 +365,18 @@ private:
    
   float * outputOmega() {
     float * output = new float [(*nCells)];
+    // The interior nodes share one dynamics object per block, their relaxation time is in the interior viscosity field
+    ScalarField3D<T> * interiorTau = 0;
+    if (particlefield && static_cast<void*>(particlefield->atomicLattice) == static_cast<void*>(ablock)) {
+      interiorTau = particlefield->interiorViscosityField;
+    }
     unsigned int n = 0;
     for (plint iZ=odomain->z0-1; iZ<=odomain->z1+1; ++iZ) {
       for (plint iY=odomain->y0-1; iY<=odomain->y1+1; ++iY) {
         for (plint iX=odomain->x0-1; iX<=odomain->x1+1; ++iX) {
 
-          output[n] = ablock->get(iX,iY,iZ).getDynamics().getOmega();
+          const T tau = interiorTau ? interiorTau->get(iX,iY,iZ) : 0.;
+          output[n] = tau > 0. ? 1./tau : ablock->get(iX,iY,iZ).getDynamics().getOmega();
           n++;
         }
       }
@@ -406,7 +424,7 @@ private:
   float * outputShearStress() {
     float * output = new float [(*nCells)*6];
     unsigned int n = 0;
-    plb::Array<T,6> stress;
+    plb::Array<S,6> stress;
     for (plint iZ=odomain->z0-1; iZ<=odomain->z1+1; ++iZ) {
       for (plint iY=odomain->y0-1; iY<=odomain->y1+1; ++iY) {
         for (plint iX=odomain->x0-1; iX<=odomain->x1+1; ++iX) {
@@ -436,7 +454,7 @@ private:
   float * outputShearRate() {
     float * output = new float [(*nCells)*9];
     unsigned int n = 0;
-    plb::Array<T,9> shearrate;
+    plb::Array<S,9> shearrate;
 
     for (plint iZ=odomain->z0-1; iZ<=odomain->z1+1; ++iZ) {
       for (plint iY=odomain->y0-1; iY<=odomain->y1+1; ++iY) {
@@ -470,9 +488,9 @@ private:
     float * output = new float [(*nCells)*6];
     unsigned int n = 0;
     // calculate tensorfield strain rate
-    std::auto_ptr<TensorField3D<T,6> > strainrate (computeStrainRateFromStress(*ablock));
+    std::auto_ptr<TensorField3D<S,6> > strainrate (computeStrainRateFromStress(*ablock));
     // calculate norm of tensorfield
-    std::auto_ptr<ScalarField3D<T> > shearrate (computeSymmetricTensorNorm(*strainrate));
+    std::auto_ptr<ScalarField3D<S> > shearrate (computeSymmetricTensorNorm(*strainrate));
     
     //strainrate.get()
     
@@ -523,9 +541,10 @@ private:
     double dx;
     double dt;
     Box3D * odomain;
-    BlockLattice3D<T,DD> * ablock;
+    BlockLattice3D<S,DD> * ablock;
     HemoCellParticleField * particlefield;
     int blockid;
+    plint spacing;
     hsize_t * nCells;
     vector<int> & outputVariables;
 };
@@ -39,7 +39,7 @@ inline void meshRotation (TriangularSurfaceMesh<T> * mesh, hemo::Array<T,3> rota
     mesh->translate(meshCenter);
 }
 
-inline void positionCellInParticleField(HEMOCELL_PARTICLE_FIELD& particleField, BlockLattice3D<T,DESCRIPTOR>& fluid,
+inline void positionCellInParticleField(HEMOCELL_PARTICLE_FIELD& particleField, BlockLattice3D<FLUID_T,DESCRIPTOR>& fluid,
                                             TriangularSurfaceMesh<T> * mesh, hemo::Array<T,3> startingPoint, plint cellId, pluint celltype) {
     plint nVertices=mesh->getNumVertices();
     Box3D fluidbb = fluid.getBoundingBox();
@@ -214,8 +214,8 @@ void ReadPositionsBloodCellField3D::processGenericBlocks (
 {  
     int numberOfCellFields = blocks.size() -1;
     //T ratio;
-    BlockLattice3D<T,DESCRIPTOR>& fluid =
-            *dynamic_cast<BlockLattice3D<T,DESCRIPTOR>*>(blocks[0]);
+    BlockLattice3D<FLUID_T,DESCRIPTOR>& fluid =
+            *dynamic_cast<BlockLattice3D<FLUID_T,DESCRIPTOR>*>(blocks[0]);
     std::vector<HEMOCELL_PARTICLE_FIELD* > particleFields(numberOfCellFields);
     std::vector<T> volumes(numberOfCellFields);
     std::vector<TriangularSurfaceMesh<T>* > meshes(numberOfCellFields);
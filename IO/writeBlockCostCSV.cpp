@@ -0,0 +1,68 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "writeBlockCostCSV.h"
+#include "hemocell.h"
+
+#include <sstream>
+
+namespace hemo {
+
+void writeBlockCost_CSV(HemoCell & hemocell) {
+  global.statistics.getCurrent()["writeBlockCostCSV"].start();
+
+  std::ostringstream lines;
+  for (BlockCostInfo const & info : hemocell.getBlockCosts()) {
+    double total = 0.;
+    for (auto const & entry : info.times) {
+      lines << info.blockId << "," << global::mpi().getRank() << "," << info.fluidNodes << "," << info.particles << ",";
+      lines << info.completeCells << "," << info.samples << "," << entry.first << "," << entry.second << "\n";
+      total += entry.second;
+    }
+    lines << info.blockId << "," << global::mpi().getRank() << "," << info.fluidNodes << "," << info.particles << ",";
+    lines << info.completeCells << "," << info.samples << ",total," << total << "\n";
+  }
+  const std::string local = lines.str();
+
+  // Gather the text of all processes on the main processor
+  int size = local.size();
+  vector<int> sizes(global::mpi().getSize());
+  MPI_Gather(&size,1,MPI_INT,sizes.data(),1,MPI_INT,0,MPI_COMM_WORLD);
+  vector<int> displacements(sizes.size(),0);
+  for (unsigned int i = 1 ; i < sizes.size() ; i++) {
+    displacements[i] = displacements[i-1] + sizes[i-1];
+  }
+  vector<char> all(global::mpi().isMainProcessor() ? displacements.back()+sizes.back() : 0);
+  MPI_Gatherv(local.data(),size,MPI_CHAR,all.data(),sizes.data(),displacements.data(),MPI_CHAR,0,MPI_COMM_WORLD);
+
+  if (global::mpi().isMainProcessor()) {
+    std::string fileName = global::directories().getOutputDir() + "/csv/blockCost." + zeroPadNumber(hemocell.iter) + ".csv";
+    ofstream csvFile(fileName, ofstream::trunc);
+    csvFile << "atomic_block,rank,fluid_nodes,particles,complete_cells,samples,functional,time" << endl;
+    csvFile.write(all.data(),all.size());
+    csvFile.close();
+  }
+  global.statistics.getCurrent().stop();
+}
+
+}
@@ -0,0 +1,33 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef WRITEBLOCKCOSTCSV_H
+#define WRITEBLOCKCOSTCSV_H
+
+#include "hemocell.h"
+
+namespace hemo {
+  /// Write the cost counters of all atomic blocks to csv/blockCost.<iter>.csv, one line per block and functional
+  void writeBlockCost_CSV(HemoCell &);
+}
+#endif /* WRITEBLOCKCOSTCSV_H */
@@ -182,6 +182,20 @@ void loadGlobalConfigValues(hemo::Config * cfg) {
   try {
    global.enableCEPACfield = (*cfg)["parameters"]["enableCEPACfield"].read<int>();
   } catch(std::invalid_argument & e) {}
+  try {
+   global.CEPACtimeStep = (*cfg)["parameters"]["CEPACtimeStep"].read<unsigned int>();
+   if (global.CEPACtimeStep < 1) {
+     hlog << "(Hemocell) (Config) Error CEPACtimeStep must be at least 1" << std::endl;
+     exit(1);
+   }
+  } catch(std::invalid_argument & e) {}
+  try {
+   global.CEPACcoarsening = (*cfg)["parameters"]["CEPACcoarsening"].read<unsigned int>();
+   if (global.CEPACcoarsening < 1) {
+     hlog << "(Hemocell) (Config) Error CEPACcoarsening must be at least 1" << std::endl;
+     exit(1);
+   }
+  } catch(std::invalid_argument & e) {}
   try {
    global.enableSolidifyMechanics = (*cfg)["parameters"]["enableSolidifyMechanics"].read<int>();
 #ifndef SOLIDIFY_MECHANICS
@@ -191,6 +205,48 @@ void loadGlobalConfigValues(hemo::Config * cfg) {
    }
 #endif
   } catch(std::invalid_argument & e) {}
+  try {
+   global.enableIncrementalInteriorNodes = (*cfg)["parameters"]["incrementalInteriorNodes"].read<int>();
+  } catch(std::invalid_argument & e) {}
+  try {
+   global.incrementalInteriorDisplacement = (*cfg)["parameters"]["incrementalInteriorDisplacement"].read<T>();
+  } catch(std::invalid_argument & e) {}
+  try {
+   global.enableSplitPhaseIterate = (*cfg)["parameters"]["splitPhaseIterate"].read<int>();
+  } catch(std::invalid_argument & e) {}
+  try {
+   global.enableFusedFluidKernel = (*cfg)["parameters"]["fusedFluidKernel"].read<int>();
+  } catch(std::invalid_argument & e) {}
+  try {
+   global.enableSparseFluidStorage = (*cfg)["parameters"]["sparseFluidStorage"].read<int>();
+  } catch(std::invalid_argument & e) {}
+  try {
+   global.enableSharedMemoryEnvelopes = (*cfg)["parameters"]["sharedMemoryEnvelopes"].read<int>();
+  } catch(std::invalid_argument & e) {}
+  try {
+   global.blockCostWindow = (*cfg)["parameters"]["blockCostWindow"].read<unsigned int>();
+  } catch(std::invalid_argument & e) {}
+  try {
+   global.blockCostOutput = (*cfg)["parameters"]["blockCostOutput"].read<int>();
+  } catch(std::invalid_argument & e) {}
+  try {
+   const char * text = (*cfg)["parameters"]["tuneBlockSizes"].getOrig()->GetText();
+   std::stringstream blockSizes(text ? text : "");
+   int blockSize;
+   global.tuneBlockSizes.clear();
+   while (blockSizes >> blockSize) {
+     global.tuneBlockSizes.push_back(blockSize);
+   }
+  } catch(std::invalid_argument & e) {}
+  try {
+   global.tuneIterations = (*cfg)["parameters"]["tuneIterations"].read<unsigned int>();
+  } catch(std::invalid_argument & e) {}
+  try {
+   global.stokesInitialization = (*cfg)["parameters"]["stokesInitialization"].read<unsigned int>();
+  } catch(std::invalid_argument & e) {}
+  try {
+   global.coarseCheckpoint = (*cfg)["parameters"]["coarseCheckpoint"].read<std::string>();
+  } catch(std::invalid_argument & e) {}
 }
 
 }
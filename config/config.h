@@ -31,6 +31,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <string>
 #include <iostream>
 #include <sstream>
+#include <vector>
 
 namespace hemo {
 
@@ -81,10 +82,38 @@ struct ConfigValues {
   bool cellsDeletedInfo = false;
 
   bool enableCEPACfield = false;
+  /// Collide and stream the CEPAC field every CEPACtimeStep fluid iterations
+  unsigned int CEPACtimeStep = 1;
+  /// Spacing of the CEPAC lattice in fluid lattice nodes
+  unsigned int CEPACcoarsening = 1;
 
   bool enableSolidifyMechanics = false;
 
   bool enableInteriorViscosity = false;
+  /// Only test the nodes near the previous membrane when the interior nodes are updated
+  bool enableIncrementalInteriorNodes = false;
+  /// Largest vertex displacement (lattice units) since the previous update for an incremental update
+  T incrementalInteriorDisplacement = 1.0;
+
+  bool enableSplitPhaseIterate = false;
+
+  bool enableFusedFluidKernel = false;
+
+  bool enableSparseFluidStorage = false;
+
+  bool enableSharedMemoryEnvelopes = false;
+
+  unsigned int blockCostWindow = 1000;
+
+  std::vector<int> tuneBlockSizes;
+  unsigned int tuneIterations = 10;
+  bool blockCostOutput = false;
+
+  /// Coarsening of the StokesInitializer grid the cases start the fluid from, 0 to start from rest
+  unsigned int stokesInitialization = 0;
+
+  /// Checkpoint directory of a run at another resolution the cases start from, see CoarseCheckpoint
+  std::string coarseCheckpoint = "";
   
   std::string checkpointDirectory = "./checkpoint/";
 
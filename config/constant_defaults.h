@@ -62,6 +62,24 @@ Select BGK dynamics with Guo's forcing method.
 #define CEPAC_DESCRIPTOR plb::descriptors::AdvectionDiffusionD3Q19Descriptor
 #endif
 
+/*
+Storage type of the populations of the fluid (FLUID_T) and CEPAC (CEPAC_T) lattices.
+Palabos stores the populations shifted by their lattice weight (f_i - t_i), which
+leaves enough precision in float for low Mach number flows and halves the memory
+traffic of collideAndStream. The fused fluid kernel (parameters/fusedFluidKernel)
+loads the populations into double lanes, so the bulk collision is always done in
+double. Cells collided by Palabos (walls, inlets, outlets, interior viscosity)
+compute in the storage type. Rebuild the library and the case after changing
+these, scripts/compare_precision.py compares the output against double.
+*/
+#ifndef FLUID_T
+#define FLUID_T double
+#endif
+
+#ifndef CEPAC_T
+#define CEPAC_T double
+#endif
+
 /*
 Force unconditional stability on the material model. Note: it will not make the model magically correct, only stable!
 FORCE_LIMIT sets the allowed maximal force coming from the constitutive model (in LBM units).
@@ -0,0 +1,232 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "fluidHaloExchange.h"
+#include "config.h"
+#include "logfile.h"
+
+#include "palabos3D.h"
+#include "palabos3D.hh"
+
+#include <cstring>
+
+namespace hemo {
+using namespace plb;
+
+FluidHaloExchange::FluidHaloExchange(MultiBlockLattice3D<FLUID_T,DESCRIPTOR> & lattice_) :
+  lattice(lattice_)
+{}
+
+FluidHaloExchange::~FluidHaloExchange() {
+  if (communication) {
+    delete communication;
+  }
+}
+
+void FluidHaloExchange::invalidate() {
+  if (inFlight) {
+    hlog << "(FluidHaloExchange) (Error) Invalidated while a halo exchange is in flight, call finish() first" << std::endl;
+    exit(1);
+  }
+  if (communication) {
+    delete communication;
+    communication = 0;
+  }
+}
+
+void FluidHaloExchange::calculateCommunicationStructure() {
+  MultiBlockManagement3D management_temp(lattice.getMultiBlockManagement());
+  ParallelBlockCommunicator3D * communicator = dynamic_cast<ParallelBlockCommunicator3D const *>(&lattice.getBlockCommunicator())->clone();
+  communicator->duplicateOverlaps(management_temp,lattice.periodicity());
+  communication = new CommunicationStructure3D(*communicator->communication);
+  delete communicator;
+
+  std::set<plint> sending;
+  std::set<int> send_procs;
+  std::map<int,std::size_t> recv_sizes;
+  for (CommunicationInfo3D const& info : communication->sendPackage) {
+    sending.insert(info.fromBlockId);
+    send_procs.insert(info.toProcessId);
+  }
+  for (CommunicationInfo3D const& info : communication->recvPackage) {
+    plint cellSize = lattice.getComponent(info.toBlockId).getDataTransfer().staticCellSize();
+    recv_sizes[info.fromProcessId] += cellSize*info.toDomain.nCells();
+  }
+
+  sendingBlocks.clear();
+  interiorBlocks.clear();
+  for (plint bid : lattice.getLocalInfo().getBlocks()) {
+    if (sending.find(bid) != sending.end()) {
+      sendingBlocks.push_back(bid);
+    } else {
+      interiorBlocks.push_back(bid);
+    }
+  }
+  sendProcs.assign(send_procs.begin(),send_procs.end());
+  recvProcs.clear();
+  recvSizes.clear();
+  for (std::pair<const int,std::size_t> & recv_size : recv_sizes) {
+    recvProcs.push_back(recv_size.first);
+    recvSizes.push_back(recv_size.second);
+  }
+
+  hlogfile << "(FluidHaloExchange) " << sendingBlocks.size() << " blocks communicate with other processors, " << interiorBlocks.size() << " blocks are processed while the halo exchange is in flight" << std::endl;
+}
+
+void FluidHaloExchange::begin() {
+  if (inFlight) {
+    hlog << "(FluidHaloExchange) (Error) begin() called twice without finish()" << std::endl;
+    exit(1);
+  }
+  if (!communication) {
+    calculateCommunicationStructure();
+  }
+
+  // 1. Become receptive, the message sizes are static
+  recvRequests.resize(recvProcs.size());
+  for (unsigned int i = 0 ; i < recvProcs.size() ; i++) {
+    vector<NoInitChar> & buffer = buffers.getRecvBuffer(recvProcs[i],recvSizes[i]);
+    MPI_Irecv(buffer.data(),recvSizes[i],MPI_CHAR,recvProcs[i],43,MPI_COMM_WORLD,&recvRequests[i]);
+  }
+
+  // 2. Collide and stream the blocks that other processors are waiting for
+  global.statistics.getCurrent()["sendingBlocks"].start();
+  for (plint bid : sendingBlocks) {
+    if (fusedFluid) {
+      fusedFluid->collideAndStream(bid);
+    } else {
+      BlockLattice3D<FLUID_T,DESCRIPTOR> & block = lattice.getComponent(bid);
+      block.collideAndStream(block.getBoundingBox());
+    }
+  }
+  global.statistics.getCurrent().stop();
+
+  // 3. Pack and post the sends, per processor in the order of the send package
+  global.statistics.getCurrent()["postHalo"].start();
+  for (int proc : sendProcs) {
+    buffers.getSendBuffer(proc,0);
+  }
+  for (CommunicationInfo3D const& info : communication->sendPackage) {
+    lattice.getComponent(info.fromBlockId).getDataTransfer().send(info.fromDomain,message,modif::staticVariables);
+    std::memcpy(buffers.appendSendBuffer(info.toProcessId,message.size()),message.data(),message.size());
+  }
+  sendRequests.resize(sendProcs.size());
+  for (unsigned int i = 0 ; i < sendProcs.size() ; i++) {
+    vector<NoInitChar> & buffer = buffers.getSendBuffer(sendProcs[i]);
+    MPI_Isend(buffer.data(),buffer.size(),MPI_CHAR,sendProcs[i],43,MPI_COMM_WORLD,&sendRequests[i]);
+  }
+  inFlight = true;
+  completed = false;
+  postedAt = std::chrono::high_resolution_clock::now();
+  global.statistics.getCurrent().stop();
+
+  // 4. Everything else is overlapped with the communication
+  global.statistics.getCurrent()["interiorBlocks"].start();
+  for (plint bid : interiorBlocks) {
+    if (fusedFluid) {
+      fusedFluid->collideAndStream(bid);
+    } else {
+      BlockLattice3D<FLUID_T,DESCRIPTOR> & block = lattice.getComponent(bid);
+      block.collideAndStream(block.getBoundingBox());
+    }
+  }
+  global.statistics.getCurrent().stop();
+  progress();
+}
+
+void FluidHaloExchange::progress() {
+  if (!inFlight || completed) { return; }
+  int sendsDone = 0, recvsDone = 0;
+  MPI_Testall(sendRequests.size(),sendRequests.data(),&sendsDone,MPI_STATUSES_IGNORE);
+  MPI_Testall(recvRequests.size(),recvRequests.data(),&recvsDone,MPI_STATUSES_IGNORE);
+  if (sendsDone && recvsDone) {
+    completed = true;
+    completedAt = std::chrono::high_resolution_clock::now();
+  }
+}
+
+void FluidHaloExchange::finish() {
+  if (!inFlight) {
+    hlog << "(FluidHaloExchange) (Error) finish() called without begin()" << std::endl;
+    exit(1);
+  }
+
+  // 1. Local copies, no communication needed
+  global.statistics.getCurrent()["localCopies"].start();
+  for (CommunicationInfo3D const& info : communication->sendRecvPackage) {
+    AtomicBlock3D const& fromBlock = lattice.getComponent(info.fromBlockId);
+    AtomicBlock3D& toBlock = lattice.getComponent(info.toBlockId);
+    plint deltaX = info.fromDomain.x0 - info.toDomain.x0;
+    plint deltaY = info.fromDomain.y0 - info.toDomain.y0;
+    plint deltaZ = info.fromDomain.z0 - info.toDomain.z0;
+    toBlock.getDataTransfer().attribute(info.toDomain, deltaX, deltaY, deltaZ, fromBlock,
+                                        modif::staticVariables, info.absoluteOffset);
+  }
+  global.statistics.getCurrent().stop();
+  progress();
+
+  // 2. Wait for what is still in flight, this is the exposed communication time
+  std::chrono::high_resolution_clock::time_point waitStart = std::chrono::high_resolution_clock::now();
+  global.statistics.getCurrent()["exposedWait"].start();
+  MPI_Waitall(recvRequests.size(),recvRequests.data(),MPI_STATUSES_IGNORE);
+  global.statistics.getCurrent().stop();
+  std::chrono::high_resolution_clock::time_point waitEnd = std::chrono::high_resolution_clock::now();
+
+  // 3. Unpack, messages from a processor are in the order of the receive package
+  global.statistics.getCurrent()["unpackHalo"].start();
+  std::map<int,std::size_t> positions;
+  for (CommunicationInfo3D const& info : communication->recvPackage) {
+    AtomicBlock3D& toBlock = lattice.getComponent(info.toBlockId);
+    std::size_t size = toBlock.getDataTransfer().staticCellSize()*info.toDomain.nCells();
+    std::size_t & pos = positions[info.fromProcessId];
+    vector<NoInitChar> & buffer = buffers.getRecvBuffer(info.fromProcessId);
+    message.resize(size);
+    std::memcpy(message.data(),&buffer[pos],size);
+    pos += size;
+    toBlock.getDataTransfer().receive(info.toDomain,message,modif::staticVariables,info.absoluteOffset);
+  }
+  MPI_Waitall(sendRequests.size(),sendRequests.data(),MPI_STATUSES_IGNORE);
+  inFlight = false;
+  global.statistics.getCurrent().stop();
+
+  // 4. Finish the timestep like MultiBlockLattice3D::collideAndStream() does
+  global.statistics.getCurrent()["internalProcessors"].start();
+  lattice.executeInternalProcessors();
+  lattice.evaluateStatistics();
+  lattice.incrementTime();
+  global.statistics.getCurrent().stop();
+
+  // 5. Bookkeeping of hidden versus exposed communication time (in microseconds),
+  //    messages that completed before the wait are hidden up to the progress() call that saw them complete
+  std::chrono::high_resolution_clock::time_point hiddenUntil = completed ? completedAt : waitStart;
+  Profiler & current = global.statistics.getCurrent();
+  current.count("hiddenCommunicationUs",std::chrono::duration_cast<std::chrono::microseconds>(hiddenUntil-postedAt).count());
+  current.count("exposedCommunicationUs",std::chrono::duration_cast<std::chrono::microseconds>(waitEnd-waitStart).count());
+  if (completed) {
+    current.count("fullyHiddenExchanges");
+  }
+  current.count("haloExchanges");
+  buffers.reportStatistics(current);
+}
+
+}
@@ -0,0 +1,90 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef HEMO_FLUID_HALO_EXCHANGE_H
+#define HEMO_FLUID_HALO_EXCHANGE_H
+
+#include "constant_defaults.h"
+#include "communicationBufferPool.h"
+#include "fusedFluidKernel.h"
+
+#include "multiBlock/multiBlockLattice3D.h"
+#include "parallelism/parallelBlockCommunicator3D.h"
+
+#include <mpi.h>
+#include <chrono>
+#include <vector>
+
+namespace hemo {
+/**
+ * Split-phase version of MultiBlockLattice3D::collideAndStream().
+ *
+ * begin() does the collision and streaming of all local atomic blocks, the
+ * blocks that have to send data to other processors first. As soon as those
+ * are done the envelope (halo) messages are posted, so they are in flight
+ * while the remaining blocks are processed and while the caller does other
+ * work that does not read the fluid, the envelopes and the internal processors
+ * are only up to date after finish(). finish() waits for the
+ * messages, unpacks them and completes the time step (internal processors,
+ * statistics, time counter).
+ *
+ * The communication pattern is the same as the one palabos uses for
+ * modif::staticVariables, it is cached and must be recalculated with
+ * invalidate() when the block structure changes.
+ */
+class FluidHaloExchange {
+public:
+  FluidHaloExchange(plb::MultiBlockLattice3D<FLUID_T,DESCRIPTOR> & lattice_);
+  ~FluidHaloExchange();
+
+  /// Collide and stream, post the halo exchange
+  void begin();
+  /// Test for completion of the messages, this also drives MPI progress, can be called during overlapped work
+  void progress();
+  /// Wait for the halo exchange and finish the time step
+  void finish();
+  /// The block structure changed, recalculate the communication pattern on the next begin()
+  void invalidate();
+
+  /// When set, the blocks are collided and streamed with the fused kernel
+  FusedFluidKernel * fusedFluid = 0;
+
+private:
+  void calculateCommunicationStructure();
+
+  plb::MultiBlockLattice3D<FLUID_T,DESCRIPTOR> & lattice;
+  plb::CommunicationStructure3D * communication = 0;
+  /// Local blocks that send to another processor, and the rest
+  std::vector<plb::plint> sendingBlocks, interiorBlocks;
+  /// Neighbouring processors and the amount of bytes expected from them
+  std::vector<int> sendProcs, recvProcs;
+  std::vector<std::size_t> recvSizes;
+  std::vector<MPI_Request> sendRequests, recvRequests;
+  CommunicationBufferPool buffers{"fluidHalo"};
+  /// Scratch space for single overlap messages, palabos expects exactly sized vectors
+  std::vector<char> message;
+  bool inFlight = false, completed = false;
+  std::chrono::high_resolution_clock::time_point postedAt, completedAt;
+};
+}
+#endif
@@ -0,0 +1,351 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "fusedFluidKernel.h"
+#include "fusedFluidLanes.h"
+#include "config.h"
+#include "logfile.h"
+
+#include "palabos3D.h"
+#include "palabos3D.hh"
+
+namespace hemo {
+using namespace plb;
+
+typedef DESCRIPTOR<T> D;
+const plint half = D::q/2;
+
+namespace {
+
+/// Start of the cell storage of a block, dense or indirect (SparseFluidStorage)
+inline Cell<FLUID_T,DESCRIPTOR> * cellStorage(BlockLattice3D<FLUID_T,DESCRIPTOR> & block) {
+  ImplicitGrid3D<FLUID_T,DESCRIPTOR> const & grid = block.getImplicitGrid();
+  return &block.get(0,0,0) - (grid.indirection ? grid.indirection[0] : 0);
+}
+
+inline plint storedCells(BlockLattice3D<FLUID_T,DESCRIPTOR> & block) {
+  ImplicitGrid3D<FLUID_T,DESCRIPTOR> const & grid = block.getImplicitGrid();
+  return grid.indirection ? grid.numCells : block.getNx()*block.getNy()*block.getNz();
+}
+
+/// Collide the n cells of a chunk and swap-stream them with their neighbours
+/// next[l][iPop-1] in the directions 1..q/2, returns the number of cells
+/// collided inline. A cell is only changed by the swaps of the cells after it,
+/// so a chunk of consecutive cells can be collided at once before its cells
+/// are streamed one by one
+inline long collideAndStreamChunk(GuoLanes & lanes, void (*collideLanes)(GuoLanes &, int, T),
+                                  Cell<FLUID_T,DESCRIPTOR> * const * chunk, Cell<FLUID_T,DESCRIPTOR> * const (*next)[half], int n,
+                                  Dynamics<FLUID_T,DESCRIPTOR> const * background, T omega, BlockStatistics & statistics) {
+  for (int l = 0 ; l < n ; l++) {
+    for (plint iPop = 0 ; iPop < D::q ; iPop++) {
+      lanes.f[iPop][l] = (*chunk[l])[iPop];
+    }
+    FLUID_T const * force = chunk[l]->getExternal(D::ExternalField::forceBeginsAt);
+    for (int iD = 0 ; iD < D::d ; iD++) {
+      lanes.force[iD][l] = force[iD];
+    }
+  }
+  collideLanes(lanes,n,omega);
+
+  long fused = 0;
+  for (int l = 0 ; l < n ; l++) {
+    Cell<FLUID_T,DESCRIPTOR> & cell = *chunk[l];
+    if (&cell.getDynamics() == background) {
+      fused++;
+    } else {
+      cell.collide(statistics);
+      for (plint iPop = 0 ; iPop < D::q ; iPop++) {
+        lanes.f[iPop][l] = cell[iPop];
+      }
+    }
+    // Swap and stream with the neighbours that are already collided,
+    // equal to latticeTemplates::swapAndStream3D() after the collision
+    cell[0] = lanes.f[0][l];
+    for (plint iPop = 1 ; iPop <= half ; iPop++) {
+      Cell<FLUID_T,DESCRIPTOR> & neighbour = *next[l][iPop-1];
+      cell[iPop] = lanes.f[iPop+half][l];
+      cell[iPop+half] = neighbour[iPop];
+      neighbour[iPop] = lanes.f[iPop][l];
+    }
+  }
+  return fused;
+}
+
+/// Stream domain with its neighbours inside bound, cells is the dense or the
+/// indirect accessor of the block (ImplicitGrid3D)
+template<class Cells>
+void streamWithin(Cells const & cells, Box3D bound, Box3D domain) {
+  for (plint iX = domain.x0 ; iX <= domain.x1 ; iX++) {
+    for (plint iY = domain.y0 ; iY <= domain.y1 ; iY++) {
+      for (plint iZ = domain.z0 ; iZ <= domain.z1 ; iZ++) {
+        for (plint iPop = 1 ; iPop <= half ; iPop++) {
+          const plint nextX = iX + D::c[iPop][0];
+          const plint nextY = iY + D::c[iPop][1];
+          const plint nextZ = iZ + D::c[iPop][2];
+          if (nextX >= bound.x0 && nextX <= bound.x1 &&
+              nextY >= bound.y0 && nextY <= bound.y1 &&
+              nextZ >= bound.z0 && nextZ <= bound.z1) {
+            std::swap(cells(iX,iY,iZ)[iPop+half],cells(nextX,nextY,nextZ)[iPop]);
+          }
+        }
+      }
+    }
+  }
+}
+}
+
+FusedFluidKernel::FusedFluidKernel(MultiBlockLattice3D<FLUID_T,DESCRIPTOR> & lattice_) :
+  lattice(lattice_)
+{
+  if (isaSupported(Isa::avx512)) {
+    setIsa(Isa::avx512);
+  } else if (isaSupported(Isa::avx2)) {
+    setIsa(Isa::avx2);
+  } else {
+    setIsa(Isa::generic);
+  }
+  hlogfile << "(FusedFluidKernel) Using the " << isaName(isa) << " collision" << std::endl;
+}
+
+bool FusedFluidKernel::isaSupported(Isa isa_) {
+#ifdef HEMO_FUSED_KERNEL_X86
+  __builtin_cpu_init();
+  switch (isa_) {
+    case Isa::avx512: return __builtin_cpu_supports("avx512f");
+    case Isa::avx2: return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    case Isa::generic: return true;
+  }
+  return false;
+#else
+  return isa_ == Isa::generic;
+#endif
+}
+
+std::string FusedFluidKernel::isaName(Isa isa_) {
+  switch (isa_) {
+    case Isa::avx512: return "AVX-512";
+    case Isa::avx2: return "AVX2";
+    case Isa::generic: return "generic";
+  }
+  return "unknown";
+}
+
+void FusedFluidKernel::setIsa(Isa isa_) {
+  if (!isaSupported(isa_)) {
+    hlog << "(FusedFluidKernel) (Error) The " << isaName(isa_) << " collision is not supported on this processor" << std::endl;
+    exit(1);
+  }
+  isa = isa_;
+  switch (isa) {
+#ifdef HEMO_FUSED_KERNEL_X86
+    case Isa::avx512: collideLanes = guoBGKcollisionAVX512; break;
+    case Isa::avx2: collideLanes = guoBGKcollisionAVX2; break;
+#endif
+    default: collideLanes = guoBGKcollisionGeneric; break;
+  }
+}
+
+void FusedFluidKernel::collideAndStream() {
+  for (plint bid : lattice.getLocalInfo().getBlocks()) {
+    collideAndStream(bid);
+  }
+  if (!indirectBulksReported && !indirectBulks.empty()) {
+    long cells = 0, bytes = 0;
+    for (auto const & bulk : indirectBulks) {
+      cells += bulk.second.cells.size();
+      bytes += (bulk.second.cells.size() + bulk.second.neighbours.size())*sizeof(int);
+    }
+    hlogfile << "(FusedFluidKernel) Neighbour index tables of " << cells << " stored bulk cells: "
+             << double(bytes)/std::max(cells,1L) << " bytes per cell" << std::endl;
+    indirectBulksReported = true;
+  }
+  // Finish the timestep like MultiBlockLattice3D::collideAndStream() does
+  lattice.getBlockCommunicator().duplicateOverlaps(lattice,modif::staticVariables);
+  lattice.executeInternalProcessors();
+  lattice.evaluateStatistics();
+  lattice.incrementTime();
+}
+
+void FusedFluidKernel::collideAndStream(plint blockId) {
+  static const int guoId = GuoExternalForceBGKdynamics<FLUID_T,DESCRIPTOR>(1.).getId();
+  BlockLattice3D<FLUID_T,DESCRIPTOR> & block = lattice.getComponent(blockId);
+  const Box3D domain = block.getBoundingBox();
+  if (domain.getNx() < 3 || domain.getNy() < 3 || domain.getNz() < 3 ||
+      block.getBackgroundDynamics().getId() != guoId) {
+    block.collideAndStream(domain);
+    global.statistics.getCurrent().count("palabosCells",domain.nCells());
+    return;
+  }
+
+  // The outer layer has no neighbours on one side, it is collided (and reverted)
+  // first and streamed last, as BlockLattice3D::collideAndStream(domain) does
+  const Box3D outerLayer[6] = {
+    Box3D(domain.x0,domain.x0, domain.y0,domain.y1, domain.z0,domain.z1),
+    Box3D(domain.x1,domain.x1, domain.y0,domain.y1, domain.z0,domain.z1),
+    Box3D(domain.x0+1,domain.x1-1, domain.y0,domain.y0, domain.z0,domain.z1),
+    Box3D(domain.x0+1,domain.x1-1, domain.y1,domain.y1, domain.z0,domain.z1),
+    Box3D(domain.x0+1,domain.x1-1, domain.y0+1,domain.y1-1, domain.z0,domain.z0),
+    Box3D(domain.x0+1,domain.x1-1, domain.y0+1,domain.y1-1, domain.z1,domain.z1)};
+  for (Box3D const & layer : outerLayer) {
+    block.collide(layer);
+  }
+  if (block.getImplicitGrid().indirection) {
+    indirectBulkCollideAndStream(blockId,block,domain.enlarge(-1));
+  } else {
+    bulkCollideAndStream(block,domain.enlarge(-1));
+  }
+  for (Box3D const & layer : outerLayer) {
+    boundaryStream(block,domain,layer);
+  }
+  global.statistics.getCurrent().count("palabosCells",domain.nCells()-domain.enlarge(-1).nCells());
+}
+
+void FusedFluidKernel::bulkCollideAndStream(BlockLattice3D<FLUID_T,DESCRIPTOR> & block, Box3D domain) {
+  const plint nY = block.getNy(), nZ = block.getNz();
+  Cell<FLUID_T,DESCRIPTOR> * cells = cellStorage(block);
+  Dynamics<FLUID_T,DESCRIPTOR> const * background = &block.getBackgroundDynamics();
+  const T omega = background->getOmega();
+  BlockStatistics & statistics = block.getInternalStatistics();
+
+  plint offset[D::q];
+  for (plint iPop = 0 ; iPop < D::q ; iPop++) {
+    offset[iPop] = (D::c[iPop][0]*nY + D::c[iPop][1])*nZ + D::c[iPop][2];
+  }
+
+  long fused = 0;
+  GuoLanes lanes;
+  Cell<FLUID_T,DESCRIPTOR> * chunk[laneWidth];
+  Cell<FLUID_T,DESCRIPTOR> * next[laneWidth][half];
+  for (plint iX = domain.x0 ; iX <= domain.x1 ; iX++) {
+    for (plint iY = domain.y0 ; iY <= domain.y1 ; iY++) {
+      const plint rowStart = (iX*nY + iY)*nZ;
+      for (plint z0 = domain.z0 ; z0 <= domain.z1 ; z0 += laneWidth) {
+        const int n = std::min<plint>(laneWidth,domain.z1-z0+1);
+        for (int l = 0 ; l < n ; l++) {
+          chunk[l] = cells + rowStart + z0 + l;
+          for (plint iPop = 1 ; iPop <= half ; iPop++) {
+            next[l][iPop-1] = chunk[l] + offset[iPop];
+          }
+        }
+        fused += collideAndStreamChunk(lanes,collideLanes,chunk,next,n,background,omega,statistics);
+      }
+    }
+  }
+  global.statistics.getCurrent().count("fusedCells",fused);
+  global.statistics.getCurrent().count("palabosCells",domain.nCells()-fused);
+}
+
+void FusedFluidKernel::indirectBulkCollideAndStream(plint blockId, BlockLattice3D<FLUID_T,DESCRIPTOR> & block, Box3D domain) {
+  ImplicitGrid3D<FLUID_T,DESCRIPTOR> const & grid = block.getImplicitGrid();
+  Cell<FLUID_T,DESCRIPTOR> * cells = cellStorage(block);
+  auto found = indirectBulks.find(blockId);
+  if (found == indirectBulks.end()) {
+    // The stored cells in storage order, the shared cell of the removed nodes
+    // is skipped: it has no fluid neighbours
+    IndirectBulk & bulk = indirectBulks[blockId];
+    const plint nY = block.getNy(), nZ = block.getNz();
+    for (plint iX = domain.x0 ; iX <= domain.x1 ; iX++) {
+      for (plint iY = domain.y0 ; iY <= domain.y1 ; iY++) {
+        for (plint iZ = domain.z0 ; iZ <= domain.z1 ; iZ++) {
+          const int index = grid.indirection[(iX*nY + iY)*nZ + iZ];
+          if (index == grid.numCells-1) { continue; }
+          bulk.cells.push_back(index);
+          for (plint iPop = 1 ; iPop <= half ; iPop++) {
+            bulk.neighbours.push_back(grid.indirection[((iX+D::c[iPop][0])*nY + iY+D::c[iPop][1])*nZ + iZ+D::c[iPop][2]]);
+          }
+        }
+      }
+    }
+    found = indirectBulks.find(blockId);
+  }
+  IndirectBulk const & bulk = found->second;
+
+  Dynamics<FLUID_T,DESCRIPTOR> const * background = &block.getBackgroundDynamics();
+  const T omega = background->getOmega();
+  BlockStatistics & statistics = block.getInternalStatistics();
+  const plint nCells = bulk.cells.size();
+
+  long fused = 0;
+  GuoLanes lanes;
+  Cell<FLUID_T,DESCRIPTOR> * chunk[laneWidth];
+  Cell<FLUID_T,DESCRIPTOR> * next[laneWidth][half];
+  for (plint start = 0 ; start < nCells ; start += laneWidth) {
+    const int n = std::min<plint>(laneWidth,nCells-start);
+    for (int l = 0 ; l < n ; l++) {
+      chunk[l] = cells + bulk.cells[start+l];
+      int const * neighbours = &bulk.neighbours[(start+l)*half];
+      for (plint iPop = 1 ; iPop <= half ; iPop++) {
+        next[l][iPop-1] = cells + neighbours[iPop-1];
+      }
+    }
+    fused += collideAndStreamChunk(lanes,collideLanes,chunk,next,n,background,omega,statistics);
+  }
+  global.statistics.getCurrent().count("fusedCells",fused);
+  global.statistics.getCurrent().count("palabosCells",nCells-fused);
+}
+
+void FusedFluidKernel::boundaryStream(BlockLattice3D<FLUID_T,DESCRIPTOR> & block, Box3D bound, Box3D domain) {
+  ImplicitGrid3D<FLUID_T,DESCRIPTOR> const & grid = block.getImplicitGrid();
+  if (grid.indirection) {
+    streamWithin(grid.indirect(),bound,domain);
+  } else {
+    streamWithin(grid.dense(),bound,domain);
+  }
+}
+
+void FusedFluidKernel::resetForce() {
+  for (plint bid : lattice.getLocalInfo().getBlocks()) {
+    BlockLattice3D<FLUID_T,DESCRIPTOR> & block = lattice.getComponent(bid);
+    Cell<FLUID_T,DESCRIPTOR> * cells = cellStorage(block);
+    const plint nCells = storedCells(block);
+    for (plint i = 0 ; i < nCells ; i++) {
+      FLUID_T * force = cells[i].getExternal(D::ExternalField::forceBeginsAt);
+      for (int iD = 0 ; iD < D::d ; iD++) {
+        force[iD] = 0.;
+      }
+    }
+  }
+}
+
+void FusedFluidKernel::shareBackgroundDynamics(MultiBlockLattice3D<FLUID_T,DESCRIPTOR> & lattice) {
+  long shared = 0;
+  for (plint bid : lattice.getLocalInfo().getBlocks()) {
+    BlockLattice3D<FLUID_T,DESCRIPTOR> & block = lattice.getComponent(bid);
+    Dynamics<FLUID_T,DESCRIPTOR> * background = &block.getBackgroundDynamics();
+    for (plint iX = 0 ; iX < block.getNx() ; iX++) {
+      for (plint iY = 0 ; iY < block.getNy() ; iY++) {
+        for (plint iZ = 0 ; iZ < block.getNz() ; iZ++) {
+          Dynamics<FLUID_T,DESCRIPTOR> & dynamics = block.get(iX,iY,iZ).getDynamics();
+          if (&dynamics != background && dynamics.getId() == background->getId() &&
+              dynamics.getOmega() == background->getOmega()) {
+            block.attributeDynamics(iX,iY,iZ,background);
+            shared++;
+          }
+        }
+      }
+    }
+  }
+  hlogfile << "(FusedFluidKernel) " << shared << " cells use the background dynamics again after the redistribution" << std::endl;
+}
+
+}
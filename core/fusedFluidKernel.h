@@ -0,0 +1,112 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef HEMO_FUSED_FLUID_KERNEL_H
+#define HEMO_FUSED_FLUID_KERNEL_H
+
+#include "constant_defaults.h"
+
+#include "multiBlock/multiBlockLattice3D.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace hemo {
+struct GuoLanes;
+
+/**
+ * HemoCell owned replacement of MultiBlockLattice3D::collideAndStream() for the
+ * D3Q19 Guo forced BGK fluid, enabled with parameters/fusedFluidKernel.
+ *
+ * Palabos collides every cell through a virtual call on its dynamics object.
+ * Here the bulk of an atomic block is processed in a single sweep over the
+ * contiguous cell storage: cells that use the background (Guo forced BGK)
+ * dynamics of the block are collided inline, all other cells (bounce back,
+ * interior viscosity, inlets/outlets) still go through their Palabos dynamics.
+ * Streaming is done in place in the same sweep, with the swap scheme Palabos
+ * uses, so the populations are in their natural order after every time step
+ * and the boundary conditions, envelopes, IBM and output keep working on them.
+ * The outer layer of cells of an atomic block is handled as Palabos does.
+ *
+ * The collision works on chunks of a row of cells copied into structure of
+ * arrays lanes. It is compiled for AVX-512, AVX2 and the baseline of the
+ * processor family (fusedFluidLanes.cpp, without -march=native), the best one
+ * the processor supports is chosen at runtime. The lanes
+ * are always double, also when the populations are stored as float (FLUID_T).
+ *
+ * Blocks with indirect storage (parameters/sparseFluidStorage) are swept over
+ * their stored bulk cells only, with a neighbour index table that is built the
+ * first time the block is collided.
+ *
+ * The external force is not reset in the same sweep: the IBM interpolation after
+ * the collision reads the velocity, which includes half the force for the Guo
+ * scheme. resetForce() replaces the setExternalVector() call at the end of the
+ * iteration with a plain sweep over the local blocks instead.
+ */
+class FusedFluidKernel {
+public:
+  /// Instruction sets the collision is compiled for
+  enum class Isa { generic, avx2, avx512 };
+
+  FusedFluidKernel(plb::MultiBlockLattice3D<FLUID_T,DESCRIPTOR> & lattice_);
+
+  /// Collide and stream all local blocks, update the envelopes and finish the time step
+  void collideAndStream();
+  /// Collide and stream one local atomic block, replaces block.collideAndStream(block.getBoundingBox())
+  void collideAndStream(plb::plint blockId);
+  /// Reset the external force of all local blocks (including their envelopes) to zero
+  void resetForce();
+
+  /// Use the collision compiled for isa, exits when the processor does not support it
+  void setIsa(Isa isa_);
+  Isa getIsa() const { return isa; }
+  static bool isaSupported(Isa isa_);
+  static std::string isaName(Isa isa_);
+
+  /// Give every cell that has a private copy of the background dynamics the
+  /// background dynamics again, so it is collided inline. Only valid right after
+  /// the lattice was filled with modif::dataStructure, when every non background
+  /// dynamics object is owned by a single cell
+  static void shareBackgroundDynamics(plb::MultiBlockLattice3D<FLUID_T,DESCRIPTOR> & lattice);
+
+private:
+  /// Stored cells of the bulk of a block with indirect storage, with the
+  /// storage index of their neighbours in the directions 1..q/2
+  struct IndirectBulk {
+    std::vector<int> cells;
+    std::vector<int> neighbours;
+  };
+
+  void bulkCollideAndStream(plb::BlockLattice3D<FLUID_T,DESCRIPTOR> & block, plb::Box3D domain);
+  void indirectBulkCollideAndStream(plb::plint blockId, plb::BlockLattice3D<FLUID_T,DESCRIPTOR> & block, plb::Box3D domain);
+  void boundaryStream(plb::BlockLattice3D<FLUID_T,DESCRIPTOR> & block, plb::Box3D bound, plb::Box3D domain);
+
+  plb::MultiBlockLattice3D<FLUID_T,DESCRIPTOR> & lattice;
+  Isa isa = Isa::generic;
+  void (*collideLanes)(GuoLanes &, int, T) = 0;
+  std::map<plb::plint,IndirectBulk> indirectBulks;
+  bool indirectBulksReported = false;
+};
+}
+#endif
@@ -0,0 +1,91 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "fusedFluidLanes.h"
+
+namespace hemo {
+
+typedef DESCRIPTOR<T> D;
+typedef plb::plint plint;
+
+namespace {
+
+/// Same arithmetic as GuoExternalForceBGKdynamics::collide() (second order
+/// BGK equilibrium and the Guo forcing term) for the first n lanes. Every loop
+/// over the lanes is innermost, it is compiled once per instruction set below
+__attribute__((always_inline)) inline void guoBGKcollisionLanes(GuoLanes & lanes, int n, T omega) {
+  T rhoBar[laneWidth], invRho[laneWidth], jSqr[laneWidth], forceAmplitude[laneWidth];
+  T j[D::d][laneWidth], u[D::d][laneWidth];
+  for (int l = 0 ; l < n ; l++) {
+    rhoBar[l] = 0.;
+    j[0][l] = j[1][l] = j[2][l] = 0.;
+  }
+  for (plint iPop = 0 ; iPop < D::q ; iPop++) {
+    const T cx = D::c[iPop][0], cy = D::c[iPop][1], cz = D::c[iPop][2];
+    for (int l = 0 ; l < n ; l++) {
+      const T f = lanes.f[iPop][l];
+      rhoBar[l] += f;
+      j[0][l] += cx*f;
+      j[1][l] += cy*f;
+      j[2][l] += cz*f;
+    }
+  }
+  for (int l = 0 ; l < n ; l++) {
+    const T rho = D::fullRho(rhoBar[l]);
+    invRho[l] = 1./rho;
+    jSqr[l] = 0.;
+    for (int iD = 0 ; iD < D::d ; iD++) {
+      u[iD][l] = j[iD][l]*invRho[l] + lanes.force[iD][l]*0.5;
+      j[iD][l] = rho*u[iD][l];
+      jSqr[l] += j[iD][l]*j[iD][l];
+    }
+    forceAmplitude[l] = (1.-0.5*omega)*rho;
+  }
+  for (plint iPop = 0 ; iPop < D::q ; iPop++) {
+    const T cx = D::c[iPop][0], cy = D::c[iPop][1], cz = D::c[iPop][2];
+    const T t = D::t[iPop];
+    for (int l = 0 ; l < n ; l++) {
+      const T c_j = cx*j[0][l] + cy*j[1][l] + cz*j[2][l];
+      const T c_u = (cx*u[0][l] + cy*u[1][l] + cz*u[2][l])*D::invCs2*D::invCs2;
+      const T forceTerm = ((cx-u[0][l])*D::invCs2 + c_u*cx)*lanes.force[0][l]
+                        + ((cy-u[1][l])*D::invCs2 + c_u*cy)*lanes.force[1][l]
+                        + ((cz-u[2][l])*D::invCs2 + c_u*cz)*lanes.force[2][l];
+      const T feq = t*(rhoBar[l] + D::invCs2*c_j + D::invCs2*0.5*invRho[l]*(D::invCs2*c_j*c_j - jSqr[l]));
+      lanes.f[iPop][l] = (1.-omega)*lanes.f[iPop][l] + omega*feq + t*forceAmplitude[l]*forceTerm;
+    }
+  }
+}
+}
+
+void guoBGKcollisionGeneric(GuoLanes & lanes, int n, T omega) {
+  guoBGKcollisionLanes(lanes,n,omega);
+}
+#ifdef HEMO_FUSED_KERNEL_X86
+__attribute__((target("avx2,fma"))) void guoBGKcollisionAVX2(GuoLanes & lanes, int n, T omega) {
+  guoBGKcollisionLanes(lanes,n,omega);
+}
+__attribute__((target("avx512f"))) void guoBGKcollisionAVX512(GuoLanes & lanes, int n, T omega) {
+  guoBGKcollisionLanes(lanes,n,omega);
+}
+#endif
+}
@@ -0,0 +1,53 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef HEMO_FUSED_FLUID_LANES_H
+#define HEMO_FUSED_FLUID_LANES_H
+
+#include "constant_defaults.h"
+
+namespace hemo {
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HEMO_FUSED_KERNEL_X86
+#endif
+
+/// Cells of a chunk of a row of a block, stored as structure of arrays so the
+/// collision vectorizes over the cells
+const int laneWidth = 32;
+struct GuoLanes {
+  alignas(64) T f[DESCRIPTOR<T>::q][laneWidth];
+  alignas(64) T force[DESCRIPTOR<T>::d][laneWidth];
+};
+
+/// Guo forced BGK collision of the first n lanes, one variant per instruction
+/// set. They are compiled in their own translation unit, without the -march
+/// flag of the library (see build/hemocell/CMakeLists.txt), so the generic
+/// variant runs on any processor of the family
+void guoBGKcollisionGeneric(GuoLanes & lanes, int n, T omega);
+#ifdef HEMO_FUSED_KERNEL_X86
+void guoBGKcollisionAVX2(GuoLanes & lanes, int n, T omega);
+void guoBGKcollisionAVX512(GuoLanes & lanes, int n, T omega);
+#endif
+}
+#endif
@@ -35,6 +35,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "ParticleHdf5IO.h"
 #include "FluidHdf5IO.h"
 #include "writeCellInfoCSV.h"
+#include "writeBlockCostCSV.h"
 #include "genericFunctions.h"
 
 #include "palabos3D.h"
@@ -42,6 +43,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "preInlet.h"
 #include "bindingField.h"
 #include "interiorViscosity.h"
+#include "fluidHaloExchange.h"
+#include "fusedFluidKernel.h"
+#include "gridRefinement.h"
+#include "coarseCheckpoint.h"
+#include "leesEdwardsBC.h"
+#include "sparseFluidStorage.h"
 
 using namespace hemo;
 
@@ -93,6 +100,18 @@ HemoCell::HemoCell(char * configFileName, int argc, char * argv[])
 }
 
 HemoCell::~HemoCell() {
+  if (fluidHalo) {
+    delete fluidHalo;
+  }
+  if (fusedFluid) {
+    delete fusedFluid;
+  }
+  if (gridRefinement) {
+    delete gridRefinement;
+  }
+  if (leesEdwards) {
+    delete leesEdwards;
+  }
   if (cellfields) {
     delete cellfields;
   }
@@ -122,8 +141,8 @@ HemoCell::~HemoCell() {
 
 void HemoCell::latticeEquilibrium(T rho, hemo::Array<T, 3> vel) {
   hlog << "(HemoCell) (Fluid) Setting Fluid Equilibrium" << endl;
-  plb::Array<T,3> vel_plb = {vel[0],vel[1],vel[2]};
-  plb::initializeAtEquilibrium(*lattice, (*lattice).getBoundingBox(), rho, vel_plb);
+  plb::Array<FLUID_T,3> vel_plb = {FLUID_T(vel[0]),FLUID_T(vel[1]),FLUID_T(vel[2])};
+  plb::initializeAtEquilibrium(*lattice, (*lattice).getBoundingBox(), FLUID_T(rho), vel_plb);
 }
 
 void HemoCell::initializeCellfield() {
@@ -154,6 +173,14 @@ void HemoCell::setFluidOutputs(vector<int> outputs) {
 
 void HemoCell::setCEPACOutputs(vector<int> outputs) {
   hlog << "(HemoCell) (Fluid) Setting CEPAC output variables for fluid field" << endl;
+  if (global.CEPACcoarsening > 1) {
+    for (int output : outputs) {
+      if (output == OUTPUT_BINDING_SITES || output == OUTPUT_INTERIOR_POINTS || output == OUTPUT_CELL_DENSITY) {
+        hlog << "(HemoCell) (Error) Particle based output is not available on a coarse CEPAC field (parameters/CEPACcoarsening)" << endl;
+        exit(1);
+      }
+    }
+  }
   vector<int> outputs_c = outputs;
   cellfields->desiredCEPACfieldOutputVariables = outputs_c;
 }
@@ -199,6 +226,17 @@ void HemoCell::loadCheckPoint() {
   if (global.enableInteriorViscosity) {
     InteriorViscosityHelper::restore(*cellfields);
   }
+  if (gridRefinement) {
+    gridRefinement->restore();
+  }
+}
+
+void HemoCell::loadCoarseCheckPoint(std::string directory) {
+  hlog << "(HemoCell) (Saving Functions) Loading Checkpoint at another resolution from " << directory << endl;
+  loadParticlesIsCalled = true;
+  CoarseCheckpoint checkpoint(*this, directory);
+  checkpoint.loadFluid();
+  checkpoint.loadCells();
 }
 
 void HemoCell::saveCheckPoint() {
@@ -210,6 +248,9 @@ void HemoCell::saveCheckPoint() {
   if (global.enableInteriorViscosity) {
     InteriorViscosityHelper::get(*cellfields).checkpoint();
   }
+  if (gridRefinement) {
+    gridRefinement->checkpoint();
+  }
 }
 
 void HemoCell::writeOutput() {
@@ -271,6 +312,9 @@ void HemoCell::writeOutput() {
     writeCEPACField_HDF5(*cellfields,param::dx,param::dt,iter);
   }
   writeCellInfo_CSV(*this);
+  if (global.blockCostOutput) {
+    writeBlockCost_CSV(*this);
+  }
   global.statistics.getCurrent().stop();
 
   //Repoint surfaceparticle forces for speed
@@ -306,27 +350,61 @@ void HemoCell::iterate() {
   }
   cellfields->spreadParticleForce();
 
-  // #### 2 #### LBM
-  global.statistics.getCurrent()["collideAndStream"].start();
-  lattice->collideAndStream();
-  global.statistics.getCurrent().stop();
+  if (global.enableFusedFluidKernel && !fusedFluid) {
+    fusedFluid = new FusedFluidKernel(*lattice);
+  }
 
-  if (global.enableCEPACfield)
+  if (gridRefinement) {
+    gridRefinement->beforeFineStep();
+  }
+
+  if (global.enableSplitPhaseIterate) {
+    // #### 2, 3 #### LBM overlapped with the fluid halo exchange, IBM interpolation
+    iterateSplitPhase();
+  } else {
+    // #### 2 #### LBM
+    double fluidTime = 0.;
     {
-      global.statistics.getCurrent()["CEPACcollideAndStream"].start();
-      cellfields->CEPACfield->collideAndStream();
+      ScopedBlockTimer timer(fluidTime);
+      global.statistics.getCurrent()["collideAndStream"].start();
+      if (fusedFluid) {
+        fusedFluid->collideAndStream();
+      } else {
+        lattice->collideAndStream();
+      }
       global.statistics.getCurrent().stop();
+
+      if (leesEdwards) {
+        leesEdwards->apply();
+      }
+
+      if (global.enableCEPACfield) {
+        cellfields->CEPACcollideAndStream();
+      }
+    }
+    cellfields->distributeFluidTime(fluidTime);
+
+    if(iter %cellfields->particleVelocityUpdateTimescale == 0) {
+      // #### 3 #### IBM interpolation
+      cellfields->interpolateFluidVelocity();
+    }
   }
 
-  if(iter %cellfields->particleVelocityUpdateTimescale == 0) {
-    // #### 3 #### IBM interpolation
-    cellfields->interpolateFluidVelocity();
+  if (gridRefinement) {
+    gridRefinement->afterFineStep();
+  }
 
-    // ### 4 ### sync the particles
-    cellfields->syncEnvelopes();
+  const bool solidify = global.enableSolidifyMechanics && !(iter%cellfields->solidifyTimescale);
+  if(iter %cellfields->particleVelocityUpdateTimescale == 0) {
+    // ### 4 ### sync the particles, with the split-phase iterate ### 5 ### and ### 6 ### of the
+    // cells that are not in any envelope are done while the envelope messages are in flight
+    cellfields->syncEnvelopes(global.enableSplitPhaseIterate && !solidify && !gridRefinement);
+    if (gridRefinement) {
+      gridRefinement->removeCellsInCouplingBand();
+    }
   }
 
-  if(global.enableSolidifyMechanics && !(iter%cellfields->solidifyTimescale)) {
+  if(solidify) {
     global.statistics.getCurrent()["solidifyCells"].start();
     cellfields->solidifyCells();
     global.statistics.getCurrent().stop();
@@ -358,16 +436,83 @@ void HemoCell::iterate() {
   }
 
   global.statistics.getCurrent()["setExternalVector"].start();
-  // Reset Forces on the lattice, TODO do own efficient implementation
-  setExternalVector(*lattice, (*lattice).getBoundingBox(),
-          DESCRIPTOR<T>::ExternalField::forceBeginsAt,
-          plb::Array<T, DESCRIPTOR<T>::d>(0.0, 0.0, 0.0));
+  // Reset Forces on the lattice
+  if (fusedFluid) {
+    fusedFluid->resetForce();
+  } else {
+    setExternalVector(*lattice, (*lattice).getBoundingBox(),
+            DESCRIPTOR<T>::ExternalField::forceBeginsAt,
+            plb::Array<FLUID_T, DESCRIPTOR<FLUID_T>::d>(0.0, 0.0, 0.0));
+  }
   global.statistics.getCurrent().stop();
+
+  cellfields->closeBlockCostSample();
   
   iter++;
   global.statistics.getCurrent().stop();
 }
 
+vector<BlockCostInfo> HemoCell::getBlockCosts() {
+  vector<BlockCostInfo> costs;
+  for (plint lbid : cellfields->immersedParticles->getLocalInfo().getBlocks()) {
+    HemoCellParticleField & pf = cellfields->immersedParticles->getComponent(lbid);
+    BlockCostInfo info;
+    info.blockId = lbid;
+    info.fluidNodes = pf.nFluidCells;
+    info.particles = pf.particles.size();
+    info.completeCells = pf.get_lpc().size();
+    info.samples = pf.cost.getSamples();
+    for (unsigned int e = 0 ; e < BlockCost::numEntries ; e++) {
+      const double time = pf.cost.getTime(BlockCost::Entry(e));
+      if (time != 0.) {
+        info.times[BlockCost::name(BlockCost::Entry(e))] = time;
+      }
+    }
+    costs.push_back(info);
+  }
+  return costs;
+}
+
+void HemoCell::iterateSplitPhase() {
+  if (!fluidHalo) {
+    fluidHalo = new FluidHaloExchange(*lattice);
+    fluidHalo->fusedFluid = fusedFluid;
+  }
+  double fluidTime = 0.;
+  {
+    ScopedBlockTimer timer(fluidTime);
+    global.statistics.getCurrent()["collideAndStream"].start();
+    fluidHalo->begin();
+    global.statistics.getCurrent().stop();
+  }
+
+  // Everything that reads the fluid waits for finish(), which also runs the
+  // internal processors of the lattice
+  global.statistics.getCurrent()["overlappedWithHalo"].start();
+  fluidHalo->progress();
+  global.statistics.getCurrent().stop();
+
+  {
+    ScopedBlockTimer timer(fluidTime);
+    global.statistics.getCurrent()["finishHaloExchange"].start();
+    fluidHalo->finish();
+    global.statistics.getCurrent().stop();
+    if (leesEdwards) {
+      leesEdwards->apply();
+    }
+  }
+  cellfields->distributeFluidTime(fluidTime);
+
+  // The velocity restriction to the CEPAC lattice reads the fluid envelopes
+  if (global.enableCEPACfield) {
+    cellfields->CEPACcollideAndStream();
+  }
+
+  if(iter %cellfields->particleVelocityUpdateTimescale == 0) {
+    cellfields->interpolateFluidVelocity();
+  }
+}
+
 T HemoCell::calculateFractionalLoadImbalance() {
   hlog << "(HemoCell) (LoadBalancer) Calculating Fractional Load Imbalance at timestep " << iter << endl;
   return loadBalancer->calculateFractionalLoadImbalance();
@@ -435,11 +580,11 @@ void HemoCell::initializeLattice(MultiBlockManagement3D const & management) {
 
   if (!preInlet) {
     hlog << "(HemoCell) No preinlet specified, running with all cores on domain with given management" << endl;
-    lattice = new MultiBlockLattice3D<T,DESCRIPTOR>(management,
+    lattice = new MultiBlockLattice3D<FLUID_T,DESCRIPTOR>(management,
             defaultMultiBlockPolicy3D().getBlockCommunicator(),
             defaultMultiBlockPolicy3D().getCombinedStatistics(),
-            defaultMultiBlockPolicy3D().getMultiCellAccess<T, DESCRIPTOR>(),
-            new GuoExternalForceBGKdynamics<T, DESCRIPTOR>(1.0/param::tau));
+            defaultMultiBlockPolicy3D().getMultiCellAccess<FLUID_T, DESCRIPTOR>(),
+            new GuoExternalForceBGKdynamics<FLUID_T, DESCRIPTOR>(1.0/param::tau));
     domain_lattice = lattice;
     return;
   }
@@ -495,16 +640,16 @@ void HemoCell::initializeLattice(MultiBlockManagement3D const & management) {
   ExplicitThreadAttribution * eta = new ExplicitThreadAttribution(BlockToMpi);
   domain_lattice_management = new MultiBlockManagement3D(sb,eta,management.getEnvelopeWidth(),management.getRefinementLevel());
   
-  preinlet_lattice = new MultiBlockLattice3D<T,DESCRIPTOR>(*preinlet_lattice_management,
+  preinlet_lattice = new MultiBlockLattice3D<FLUID_T,DESCRIPTOR>(*preinlet_lattice_management,
             defaultMultiBlockPolicy3D().getBlockCommunicator(),
             defaultMultiBlockPolicy3D().getCombinedStatistics(),
-            defaultMultiBlockPolicy3D().getMultiCellAccess<T, DESCRIPTOR>(),
-            new GuoExternalForceBGKdynamics<T, DESCRIPTOR>(1.0/param::tau));
-  domain_lattice = new MultiBlockLattice3D<T,DESCRIPTOR>(*domain_lattice_management,
+            defaultMultiBlockPolicy3D().getMultiCellAccess<FLUID_T, DESCRIPTOR>(),
+            new GuoExternalForceBGKdynamics<FLUID_T, DESCRIPTOR>(1.0/param::tau));
+  domain_lattice = new MultiBlockLattice3D<FLUID_T,DESCRIPTOR>(*domain_lattice_management,
             defaultMultiBlockPolicy3D().getBlockCommunicator(),
             defaultMultiBlockPolicy3D().getCombinedStatistics(),
-            defaultMultiBlockPolicy3D().getMultiCellAccess<T, DESCRIPTOR>(),
-            new GuoExternalForceBGKdynamics<T, DESCRIPTOR>(1.0/param::tau));
+            defaultMultiBlockPolicy3D().getMultiCellAccess<FLUID_T, DESCRIPTOR>(),
+            new GuoExternalForceBGKdynamics<FLUID_T, DESCRIPTOR>(1.0/param::tau));
   
   if (!partOfpreInlet) {
     lattice = domain_lattice;
@@ -514,16 +659,46 @@ void HemoCell::initializeLattice(MultiBlockManagement3D const & management) {
   }
 }
 
-#ifdef HEMO_PARMETIS
+void HemoCell::compactFluidStorage(MultiScalarField3D<int> & flagMatrix) {
+  if (!global.enableSparseFluidStorage) {
+    return;
+  }
+  hlog << "(HemoCell) (Fluid) Compacting the fluid storage to the fluid nodes" << endl;
+  SparseFluidStorage::compact(*lattice,flagMatrix);
+  //The cells moved, the particle kernels point to their old location
+  if (cellfields) {
+    for (plint lbid : cellfields->immersedParticles->getLocalInfo().getBlocks()) {
+      cellfields->immersedParticles->getComponent(lbid).invalidateKernels();
+    }
+  }
+}
+
 void HemoCell::doLoadBalance() {
 	pcout << "(HemoCell) (LoadBalancer) Balancing Atomic Block over mpi processes" << endl;
   loadBalancer->doLoadBalance();
 }
-#endif
+
+void HemoCell::tuneDecomposition(std::function<void()> afterIteration) {
+  loadBalancer->tuneDecomposition(afterIteration);
+}
 
 void HemoCell::doRestructure(bool checkpoint_avail) {
   hlog << "(HemoCell) (LoadBalancer) Restructuring Atomic Blocks on processors" << endl;
   loadBalancer->restructureBlocks(checkpoint_avail);
+  if (fluidHalo) {
+    delete fluidHalo;
+    fluidHalo = 0;
+  }
+  if (fusedFluid) {
+    delete fusedFluid;
+    fusedFluid = 0;
+  }
+  if (gridRefinement) {
+    gridRefinement->redistribute();
+  }
+  if (leesEdwards) {
+    leesEdwards->redistribute();
+  }
 }
 
 void HemoCell::sanityCheck() {
@@ -593,6 +768,15 @@ void HemoCell::sanityCheck() {
   if (sizeof(T) == sizeof(float)) {
     hlog << "(HemoCell) WARNING: Running with single precision, you might want to switch to double precision" << endl;
   }
+  if (sizeof(FLUID_T) != sizeof(T)) {
+    hlog << "(HemoCell) Storing the fluid populations with " << sizeof(FLUID_T) << " bytes per value" << endl;
+    if (!global.enableFusedFluidKernel) {
+      hlog << "(HemoCell) WARNING: The bulk of the fluid is collided in the storage precision, enable parameters/fusedFluidKernel to collide it in double precision" << endl;
+    }
+  }
+  if (global.enableCEPACfield && sizeof(CEPAC_T) != sizeof(T)) {
+    hlog << "(HemoCell) Storing the CEPAC populations with " << sizeof(CEPAC_T) << " bytes per value" << endl;
+  }
 
   // Check lattice viscosity [0.01, 0.45]
   if(param::nu_lbm < 0.01 || param::nu_lbm > 0.45) {
@@ -104,9 +104,6 @@ HemoCellField::HemoCellField(HemoCellFields& cellFields_, string & name_, unsign
      if (doInteriorViscosity) {
 #ifdef INTERIOR_VISCOSITY
        hlog << "(HemoCell) (AddCellType) ("<< name << ") Enabling interior viscosity" << endl;
-       double omegaInt = 1.0/interiorViscosityTau;
-      innerViscosityDynamics = cellFields.lattice->getBackgroundDynamics().clone();
-      innerViscosityDynamics->setOmega(omegaInt);
       global.enableInteriorViscosity = true;
 #else
       hlog << "(HemoCell) (AddCellType) (" << name << ") Cannot enable interior viscosity when INTERIOR_VISCOSITY is not defined at compile time" << endl;
@@ -117,9 +114,6 @@ HemoCellField::HemoCellField(HemoCellFields& cellFields_, string & name_, unsign
  } catch (std::invalid_argument & e) {}
 }
 HemoCellField::~HemoCellField() {
-  if (innerViscosityDynamics) {
-    delete innerViscosityDynamics;
-  }
   if (mechanics) {
     delete mechanics;
   }
@@ -183,5 +177,5 @@ int HemoCellField::getNumberOfCells_Global() {return 0;}
 std::string HemoCellField::getIdentifier() {return name;}
 vector<int> HemoCellField::default_output ({OUTPUT_POSITION});
 plb::MultiParticleField3D<HEMOCELL_PARTICLE_FIELD> * HemoCellField::getParticleField3D() {return cellFields.immersedParticles;}
-plb::MultiBlockLattice3D<T,DESCRIPTOR> * HemoCellField::getFluidField3D() {return cellFields.lattice;}
+plb::MultiBlockLattice3D<FLUID_T,DESCRIPTOR> * HemoCellField::getFluidField3D() {return cellFields.lattice;}
 plb::TriangularSurfaceMesh<T> & HemoCellField::getMesh() { return *meshElement;}
@@ -64,9 +64,9 @@ class HemoCellField{
   unsigned int minimumDistanceFromSolid = 0;
   bool outputTriangles = false;
   vector<hemo::Array<plint,3>> triangle_list;
-  void(*kernelMethod)(plb::BlockLattice3D<T,DESCRIPTOR> &,HemoCellParticle&);
+  void(*kernelMethod)(plb::BlockLattice3D<FLUID_T,DESCRIPTOR> &,HemoCellParticle&);
   plb::MultiParticleField3D<HEMOCELL_PARTICLE_FIELD> * getParticleField3D();
-  plb::MultiBlockLattice3D<T,DESCRIPTOR> * getFluidField3D();
+  plb::MultiBlockLattice3D<FLUID_T,DESCRIPTOR> * getFluidField3D();
   int getNumberOfCells_Global();
   std::string getIdentifier();
   plb::MultiParticleField3D<HEMOCELL_PARTICLE_FIELD> * getParticleArg();
@@ -80,7 +80,6 @@ class HemoCellField{
   bool doSolidifyMechanics = false;
   bool doInteriorViscosity = false;
   T interiorViscosityTau = 1.0;
-  plb::Dynamics<T,DESCRIPTOR> * innerViscosityDynamics = 0;
 };
 }
 
@@ -36,7 +36,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 namespace hemo {
 
  
-HemoCellFields::HemoCellFields( MultiBlockLattice3D<T, DESCRIPTOR> & lattice_, unsigned int particleEnvelopeWidth, HemoCell & hemocell_) :
+HemoCellFields::HemoCellFields( MultiBlockLattice3D<FLUID_T, DESCRIPTOR> & lattice_, unsigned int particleEnvelopeWidth, HemoCell & hemocell_) :
   lattice(&lattice_), hemocell(hemocell_)
 {   
   envelopeSize=particleEnvelopeWidth;
@@ -65,6 +65,9 @@ HemoCellFields::~HemoCellFields() {
   if (large_communicator) {
     delete large_communicator;
   }  
+  if (sharedMemory) {
+    delete sharedMemory;
+  }
 }
 
 void HemoCellFields::createParticleField(SparseBlockStructure3D* sbStructure, ThreadAttribution * tAttribution) {
@@ -110,32 +113,136 @@ void HemoCellFields::createParticleField(SparseBlockStructure3D* sbStructure, Th
   InitAfterLoadCheckpoint();
 }
 
+T HemoCellFields::CEPACtau() {
+  // The diffusion constant in CEPAC lattice units scales with dt/dx^2
+  const T r = global.CEPACcoarsening;
+  return 0.5 + (param::tau_CEPAC - 0.5)*global.CEPACtimeStep/(r*r);
+}
+
 void HemoCellFields::createCEPACfield() {
-  SparseBlockStructure3D* sbStructure = lattice->getSparseBlockStructure().clone();
-  ThreadAttribution * tAttribution = lattice->getMultiBlockManagement().getThreadAttribution().clone();
+  const plint r = global.CEPACcoarsening;
+  const bool subcycled = global.CEPACtimeStep > 1 || r > 1;
+  if (subcycled && param::tau_CEPAC <= 0.5) {
+    hlog << "(HemoCellFields) (Error) parameters/CEPACtimeStep and parameters/CEPACcoarsening need the diffusion constant of the CEPAC field (domain/DCEPAC)" << endl;
+    exit(1);
+  }
+  // Without domain/DCEPAC the relaxation parameter is passed on as before
+  const T omega = param::tau_CEPAC > 0.5 ? 1.0/CEPACtau() : param::tau_CEPAC;
+
+  SparseBlockStructure3D* sbStructure;
+  ThreadAttribution * tAttribution;
+  if (r == 1) {
+    sbStructure = lattice->getSparseBlockStructure().clone();
+    tAttribution = lattice->getMultiBlockManagement().getThreadAttribution().clone();
+  } else {
+    // Coarse node X lies on fine node r*X, a fluid block gets the coarse nodes within its bulk
+    Box3D fineBox = lattice->getBoundingBox();
+    const plint n[3] = {fineBox.getNx(), fineBox.getNy(), fineBox.getNz()};
+    for (int d = 0; d < 3; d++) {
+      if (lattice->periodicity().get(d) && n[d] % r != 0) {
+        hlog << "(HemoCellFields) (Error) The periodic domain size along axis " << d << " is not a multiple of parameters/CEPACcoarsening" << endl;
+        exit(1);
+      }
+    }
+    sbStructure = new SparseBlockStructure3D(Box3D(0, (n[0]-1)/r, 0, (n[1]-1)/r, 0, (n[2]-1)/r));
+    map<plint,plint> blockToMpi;
+    for (auto const & bulk : lattice->getSparseBlockStructure().getBulks()) {
+      Box3D coarse((bulk.second.x0 + r - 1)/r, bulk.second.x1/r,
+                   (bulk.second.y0 + r - 1)/r, bulk.second.y1/r,
+                   (bulk.second.z0 + r - 1)/r, bulk.second.z1/r);
+      if (coarse.getNx() < 1 || coarse.getNy() < 1 || coarse.getNz() < 1) {
+        continue;
+      }
+      sbStructure->addBlock(coarse, coarse, bulk.first);
+      blockToMpi[bulk.first] = lattice->getMultiBlockManagement().getThreadAttribution().getMpiProcess(bulk.first);
+    }
+    tAttribution = new ExplicitThreadAttribution(blockToMpi);
+  }
   plint refinement = lattice->getMultiBlockManagement().getRefinementLevel();
   lattice->getBlockCommunicator();
-  CEPACfield = new MultiBlockLattice3D<T,CEPAC_DESCRIPTOR>(
+  CEPACfield = new MultiBlockLattice3D<CEPAC_T,CEPAC_DESCRIPTOR>(
           MultiBlockManagement3D( *sbStructure,
                                   tAttribution,
                                   envelopeSize,
                                   refinement ),
           plb::defaultMultiBlockPolicy3D().getBlockCommunicator(),
           plb::defaultMultiBlockPolicy3D().getCombinedStatistics(),
-          plb::defaultMultiBlockPolicy3D().getMultiCellAccess<T,CEPAC_DESCRIPTOR>(),
-          new plb::AdvectionDiffusionBGKdynamics<T,CEPAC_DESCRIPTOR>(param::tau_CEPAC)
+          plb::defaultMultiBlockPolicy3D().getMultiCellAccess<CEPAC_T,CEPAC_DESCRIPTOR>(),
+          new plb::AdvectionDiffusionBGKdynamics<CEPAC_T,CEPAC_DESCRIPTOR>(omega)
           );
+  delete sbStructure;
   
   CEPACfield->periodicity().toggle(0,lattice->periodicity().get(0));
   CEPACfield->periodicity().toggle(1,lattice->periodicity().get(1));
   CEPACfield->periodicity().toggle(2,lattice->periodicity().get(2));
 
   CEPACfield->toggleInternalStatistics(false);
-  
-  integrateProcessingFunctional ( // instead of integrateProcessingFunctional
-    new LatticeToPassiveAdvDiff3D<T,DESCRIPTOR,CEPAC_DESCRIPTOR>(1),
-    lattice->getBoundingBox(), *lattice, *CEPACfield, 1);
 
+  if (subcycled) {
+    hlog << "(HemoCellFields) CEPAC field every " << global.CEPACtimeStep << " iterations on every " << r << "th fluid node, tau_CEPAC " << CEPACtau() << endl;
+    // The advection velocity is scaled by CEPACtimeStep/CEPACcoarsening
+    if (param::u_lbm_max*global.CEPACtimeStep/r > 0.1) {
+      hlog << "(HemoCellFields) WARNING: the maximum velocity on the CEPAC lattice is " << param::u_lbm_max*global.CEPACtimeStep/r << " (lattice units), lower parameters/CEPACtimeStep" << endl;
+    }
+  }
+}
+
+void HemoCellFields::restrictVelocityToCEPAC() {
+  const plint r = global.CEPACcoarsening;
+  const T scale = T(global.CEPACtimeStep)/r;
+  const int velOffset = CEPAC_DESCRIPTOR<CEPAC_T>::ExternalField::velocityBeginsAt;
+  plb::Array<FLUID_T,3> vel;
+  for (plint bId : CEPACfield->getLocalInfo().getBlocks()) {
+    BlockLattice3D<CEPAC_T,CEPAC_DESCRIPTOR> & CEPAC = CEPACfield->getComponent(bId);
+    BlockLattice3D<FLUID_T,DESCRIPTOR> & fluid = lattice->getComponent(bId);
+    const Dot3D CEPACloc = CEPAC.getLocation();
+    const Dot3D fluidLoc = fluid.getLocation();
+    Box3D bulk = CEPACfield->getMultiBlockManagement().getBulk(bId);
+    // Tent weighted average of the fluid nodes around r*X, as far as they lie within the local fluid block
+    for (plint X = bulk.x0; X <= bulk.x1; X++) {
+      for (plint Y = bulk.y0; Y <= bulk.y1; Y++) {
+        for (plint Z = bulk.z0; Z <= bulk.z1; Z++) {
+          T u[3] = {0.,0.,0.};
+          T weights = 0.;
+          for (plint dx = 1-r; dx < r; dx++) {
+            const plint x = r*X + dx - fluidLoc.x;
+            if (x < 0 || x >= fluid.getNx()) { continue; }
+            for (plint dy = 1-r; dy < r; dy++) {
+              const plint y = r*Y + dy - fluidLoc.y;
+              if (y < 0 || y >= fluid.getNy()) { continue; }
+              for (plint dz = 1-r; dz < r; dz++) {
+                const plint z = r*Z + dz - fluidLoc.z;
+                if (z < 0 || z >= fluid.getNz()) { continue; }
+                Cell<FLUID_T,DESCRIPTOR> & cell = fluid.get(x,y,z);
+                if (cell.getDynamics().isBoundary()) { continue; }
+                const T w = T((r-std::abs(dx))*(r-std::abs(dy))*(r-std::abs(dz)));
+                cell.computeVelocity(vel);
+                u[0] += w*vel[0];
+                u[1] += w*vel[1];
+                u[2] += w*vel[2];
+                weights += w;
+              }
+            }
+          }
+          CEPAC_T * ext = CEPAC.get(X-CEPACloc.x,Y-CEPACloc.y,Z-CEPACloc.z).getExternal(velOffset);
+          for (int d = 0; d < 3; d++) {
+            ext[d] = weights > 0. ? u[d]/weights*scale : 0.;
+          }
+        }
+      }
+    }
+  }
+  CEPACfield->duplicateOverlaps(modif::staticVariables);
+}
+
+void HemoCellFields::CEPACcollideAndStream() {
+  if (hemocell.iter % global.CEPACtimeStep != 0) {
+    return;
+  }
+  global.statistics.getCurrent()["CEPACcollideAndStream"].start();
+  restrictVelocityToCEPAC();
+  CEPACfield->collideAndStream();
+  global.statistics.getCurrent().stop();
 }
 
 HemoCellField * HemoCellFields::addCellType(std::string name_, int constructType)
@@ -210,12 +317,13 @@ void HemoCellFields::InitAfterLoadCheckpoint()
     immersedParticles->getComponent(blocks[iBlock]).cellFields = this;
     immersedParticles->getComponent(blocks[iBlock]).atomicBlockId = blocks[iBlock];
     immersedParticles->getComponent(blocks[iBlock]).atomicLattice = &lattice->getComponent(blocks[iBlock]);
-    if (global.enableCEPACfield && CEPACfield) {
+    // A coarse CEPAC block does not overlap the fluid block node by node
+    if (global.enableCEPACfield && CEPACfield && global.CEPACcoarsening == 1) {
       immersedParticles->getComponent(blocks[iBlock]).CEPAClattice = &CEPACfield->getComponent(blocks[iBlock]);
     }
     immersedParticles->getComponent(blocks[iBlock]).envelopeSize = envelopeSize;
     
-    BlockLattice3D<T,DESCRIPTOR> * fluid = immersedParticles->getComponent(blocks[iBlock]).atomicLattice;
+    BlockLattice3D<FLUID_T,DESCRIPTOR> * fluid = immersedParticles->getComponent(blocks[iBlock]).atomicLattice;
     immersedParticles->getComponent(blocks[iBlock]).nFluidCells = 0;
     for(unsigned int x = 0; x < fluid->getNx(); x++ ) {
       for(unsigned int y = 0; y < fluid->getNy(); y++ ) {
@@ -307,6 +415,10 @@ void HemoCellFields::save(XMLreader *xmlr, unsigned int iter, Config * cfg)
     /* Save XML & Data */
     xmlw["Checkpoint"]["General"]["Iteration"].set(iter);
     xmlw["Checkpoint"]["General"]["OutDirectory"].set(plb::global::directories().getOutputDir());
+    // Needed to start a run at another resolution from this checkpoint, see CoarseCheckpoint
+    xmlw["Checkpoint"]["General"]["LatticeSize"]["nx"].set(hemocell.domain_lattice->getNx());
+    xmlw["Checkpoint"]["General"]["LatticeSize"]["ny"].set(hemocell.domain_lattice->getNy());
+    xmlw["Checkpoint"]["General"]["LatticeSize"]["nz"].set(hemocell.domain_lattice->getNz());
     xmlw.print(outDir + "checkpoint.xml");
 
     if (hemocell.preInlet) {
@@ -325,7 +437,9 @@ void readPositionsCellFields(std::string particlePosFile) {
 //void HemoCellFields::
 
 void HemoCellFields::HemoFindInternalParticleGridPoints::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
-    dynamic_cast<HEMOCELL_PARTICLE_FIELD*>(blocks[0])->findInternalParticleGridPoints(domain);
+    HEMOCELL_PARTICLE_FIELD * pf = dynamic_cast<HEMOCELL_PARTICLE_FIELD*>(blocks[0]);
+    BlockCostTimer timer(pf->cost,BlockCost::findInternalParticleGridPoints);
+    pf->findInternalParticleGridPoints(domain);
 }
 
 void HemoCellFields::findInternalParticleGridPoints() {
@@ -336,7 +450,9 @@ void HemoCellFields::findInternalParticleGridPoints() {
 
 
 void HemoCellFields::HemoInternalGridPointsMembrane::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
-    dynamic_cast<HEMOCELL_PARTICLE_FIELD*>(blocks[0])->internalGridPointsMembrane(domain);
+    HEMOCELL_PARTICLE_FIELD * pf = dynamic_cast<HEMOCELL_PARTICLE_FIELD*>(blocks[0]);
+    BlockCostTimer timer(pf->cost,BlockCost::internalGridPointsMembrane);
+    pf->internalGridPointsMembrane(domain);
 }
 
 void HemoCellFields::internalGridPointsMembrane() {
@@ -348,7 +464,9 @@ void HemoCellFields::internalGridPointsMembrane() {
 
 
 void HemoCellFields::HemoInterpolateFluidVelocity::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
-    dynamic_cast<HEMOCELL_PARTICLE_FIELD*>(blocks[0])->interpolateFluidVelocity(domain);
+  HEMOCELL_PARTICLE_FIELD * pf = dynamic_cast<HEMOCELL_PARTICLE_FIELD*>(blocks[0]);
+  BlockCostTimer timer(pf->cost,BlockCost::interpolateFluidVelocity);
+  pf->interpolateFluidVelocity(domain);
 }
 void HemoCellFields::interpolateFluidVelocity() {
   global.statistics.getCurrent()["interpolateFluidVelocity"].start();
@@ -361,6 +479,9 @@ void HemoCellFields::interpolateFluidVelocity() {
 }
 
 void HemoCellFields::calculateCommunicationStructure() {
+  if (large_communicator) {
+    delete large_communicator;
+  }
   MultiBlockManagement3D management_temp(immersedParticles->getMultiBlockManagement());
   ParallelBlockCommunicator3D * communicator = dynamic_cast<ParallelBlockCommunicator3D const *>(&immersedParticles->getBlockCommunicator())->clone();
   communicator->duplicateOverlaps(management_temp,immersedParticles->periodicity());
@@ -369,12 +490,35 @@ void HemoCellFields::calculateCommunicationStructure() {
   immersedParticles->signalPeriodicity();
   immersedParticles->getBlockCommunicator().duplicateOverlaps(*immersedParticles,modif::hemocell_no_comm);
   delete communicator;
+  if (global.enableSharedMemoryEnvelopes && !sharedMemory) {
+    sharedMemory = new SharedMemoryExchange();
+  }
+}
+
+void HemoCellFields::distributeFluidTime(double seconds) {
+  int localFluidCells = 0;
+  for (plint lbid : immersedParticles->getLocalInfo().getBlocks() ) {
+    localFluidCells += immersedParticles->getComponent(lbid).nFluidCells;
+  }
+  if (localFluidCells == 0) { return; }
+  for (plint lbid : immersedParticles->getLocalInfo().getBlocks() ) {
+    HemoCellParticleField & pf = immersedParticles->getComponent(lbid);
+    pf.cost.add(BlockCost::collideAndStream,seconds*pf.nFluidCells/localFluidCells);
+  }
+}
+
+void HemoCellFields::closeBlockCostSample() {
+  for (plint lbid : immersedParticles->getLocalInfo().getBlocks() ) {
+    immersedParticles->getComponent(lbid).cost.closeSample(global.blockCostWindow);
+  }
 }
 
 void HemoCellFields::HemoSyncEnvelopes::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
-    dynamic_cast<HEMOCELL_PARTICLE_FIELD*>(blocks[0])->syncEnvelopes();
+    HEMOCELL_PARTICLE_FIELD * pf = dynamic_cast<HEMOCELL_PARTICLE_FIELD*>(blocks[0]);
+    BlockCostTimer timer(pf->cost,BlockCost::syncEnvelopes);
+    pf->syncEnvelopes();
 }
-void HemoCellFields::syncEnvelopes() {
+void HemoCellFields::syncEnvelopes(bool advanceInterior) {
   global.statistics.getCurrent()["syncEnvelopes"].start();
 
   vector<MultiBlock3D*> wrapper;
@@ -399,6 +543,19 @@ void HemoCellFields::syncEnvelopes() {
       recv_infos[info.fromProcessId].push_back(&info);
     }
 
+    //Neighbours on the same node read our particles directly from shared memory
+    std::set<int> node_recv_procs, node_send_procs;
+    if (sharedMemory) {
+      for (int proc : recv_procs) {
+        if (sharedMemory->onNode(proc)) { node_recv_procs.insert(proc); }
+      }
+      for (int proc : send_procs) {
+        if (sharedMemory->onNode(proc)) { node_send_procs.insert(proc); }
+      }
+      for (int proc : node_recv_procs) { recv_procs.erase(proc); }
+      for (int proc : node_send_procs) { send_procs.erase(proc); }
+    }
+
     set<int> locals;
     for (plint lbid : immersedParticles->getLocalInfo().getBlocks() ) {
       HemoCellParticleField & pf = immersedParticles->getComponent(lbid);
@@ -406,33 +563,36 @@ void HemoCellFields::syncEnvelopes() {
         locals.insert(particle.sv.cellId);
       }
     }
-    vector<int> locals_v;
-    locals_v.insert(locals_v.end(),locals.begin(),locals.end());
+    //The same list is sent to every neighbour, use the send buffer of this rank for it
+    int * locals_v = cellIdBuffers.getSendBufferAs<int>(global::mpi().getRank(),locals.size());
+    std::copy(locals.begin(),locals.end(),locals_v);
          
     vector<int> recv_procs_v;
     recv_procs_v.insert(recv_procs_v.end(),recv_procs.begin(),recv_procs.end());
     vector<MPI_Request> reqs(recv_procs.size());
 
     for (unsigned int i = 0 ; i < recv_procs_v.size() ; i ++) {
-      MPI_Isend(&locals_v[0],locals_v.size(),MPI_INT,recv_procs_v[i],24,MPI_COMM_WORLD,&reqs[i]);
+      MPI_Isend(locals_v,locals.size(),MPI_INT,recv_procs_v[i],24,MPI_COMM_WORLD,&reqs[i]);
+    }
+    //The neighbours are doing the same, the requests are answered afterwards
+    if (advanceInterior) {
+      advanceInteriorCells();
     }
-    sendBuffers.resize(send_procs.size());
     for (unsigned int i = 0 ; i < send_procs.size() ; i ++) {
       MPI_Status status;
       MPI_Probe(MPI_ANY_SOURCE,24,MPI_COMM_WORLD,&status);
       int count;
       MPI_Get_count(&status,MPI_INT,&count);
-      vector<int> requested_ids(count);
-      vector<NoInitChar> & sendBuffer = sendBuffers[i];
-      sendBuffer.clear();
-      int offset = 0 ;
-      MPI_Recv(&requested_ids[0],count,MPI_INT,status.MPI_SOURCE,24,MPI_COMM_WORLD,MPI_STATUS_IGNORE);
+      int * requested_ids = cellIdBuffers.getRecvBufferAs<int>(status.MPI_SOURCE,count);
+      particleBuffers.getSendBuffer(status.MPI_SOURCE,0);
+      MPI_Recv(requested_ids,count,MPI_INT,status.MPI_SOURCE,24,MPI_COMM_WORLD,MPI_STATUS_IGNORE);
       for (CommunicationInfo3D const * info : send_infos[status.MPI_SOURCE] ) {
         HemoCellParticleField & pf = immersedParticles->getComponent(info->fromBlockId);
         int offset_p = pf.getDataTransfer().getOffset(info->absoluteOffset);
         const map<int,vector<int>> & ppc = pf.get_particles_per_cell();
         
-        for (int id : requested_ids) {
+        for (int c = 0 ; c < count ; c++) {
+          int id = requested_ids[c];
           if (((offset_p < 0) && (id > INT_MAX+offset_p)) ||
               ((offset_p > 0) && (id < INT_MIN+offset_p))) {
             cout << "(HemoCellFields syncEnvelopes) Almost invoking overflow in periodic particle communication, resetting ID to base ID instead, this will most likely delete the particle" << endl;
@@ -444,25 +604,24 @@ void HemoCellFields::syncEnvelopes() {
           for (int pid : ppc.at(id)) {
             if (pid <= -1) { continue; }
             if (pid >= (int) pf.particles.size()) { continue; }
-            sendBuffer.resize(sendBuffer.size()+sizeof(HemoCellParticle::serializeValues_t));
-            *((HemoCellParticle::serializeValues_t*)&sendBuffer[offset]) = pf.particles[pid].sv;
-            offset += sizeof(HemoCellParticle::serializeValues_t);
+            *((HemoCellParticle::serializeValues_t*)particleBuffers.appendSendBuffer(status.MPI_SOURCE,sizeof(HemoCellParticle::serializeValues_t))) = pf.particles[pid].sv;
           }         
         }
       }
+      vector<NoInitChar> & sendBuffer = particleBuffers.getSendBuffer(status.MPI_SOURCE);
       reqs.emplace_back();
       MPI_Isend(sendBuffer.data(),sendBuffer.size(),MPI_CHAR,status.MPI_SOURCE,42,MPI_COMM_WORLD,&reqs.back());
     }
 
     vector<MPI_Request> recv_reqs(recv_procs.size());
-    recvBuffers.resize(recv_procs.size());
+    vector<int> recv_sources(recv_procs.size());
     for (unsigned int i = 0 ; i < recv_procs.size() ; i ++) {
       MPI_Status status;
       MPI_Probe(MPI_ANY_SOURCE,42,MPI_COMM_WORLD,&status);
       int count;
       MPI_Get_count(&status,MPI_CHAR,&count);
-      vector<NoInitChar> & recv_buffer = recvBuffers[i];
-      recv_buffer.resize(count);
+      recv_sources[i] = status.MPI_SOURCE;
+      vector<NoInitChar> & recv_buffer = particleBuffers.getRecvBuffer(status.MPI_SOURCE,count);
       MPI_Irecv(recv_buffer.data(),count,MPI_CHAR,status.MPI_SOURCE,42,MPI_COMM_WORLD,&recv_reqs[i]);
     }
 
@@ -474,14 +633,19 @@ void HemoCellFields::syncEnvelopes() {
         exit(1);
       }
       recv_reqs[index] = MPI_REQUEST_NULL;
+      vector<NoInitChar> & recv_buffer = particleBuffers.getRecvBuffer(recv_sources[index]);
       //Get Offsets and Destinations
       for (CommunicationInfo3D const * info : recv_infos[status.MPI_SOURCE]) {
         HEMOCELL_PARTICLE_FIELD& toBlock = immersedParticles->getComponent(info->toBlockId);
-        toBlock.getDataTransfer().receive (info->toDomain, recvBuffers[index], info->absoluteOffset );
+        toBlock.getDataTransfer().receive (info->toDomain, recv_buffer, info->absoluteOffset );
       }
     }
 
     MPI_Waitall(reqs.size(),reqs.data(),MPI_STATUSES_IGNORE);
+
+    if (sharedMemory) {
+      syncEnvelopesSharedMemory(node_send_procs, node_recv_procs, send_infos, recv_infos, locals);
+    }
     
     // 3. Local copies which require no communication.
     for (unsigned iSendRecv=0; iSendRecv<comms->sendRecvPackage.size(); ++iSendRecv) {
@@ -494,12 +658,91 @@ void HemoCellFields::syncEnvelopes() {
                 modif::hemocell, info.absoluteOffset );
     }
     
+    particleBuffers.reportStatistics(global.statistics.getCurrent());
+    cellIdBuffers.reportStatistics(global.statistics.getCurrent());
+  } else if (advanceInterior) {
+    advanceInteriorCells();
+  }
+  global.statistics.getCurrent().stop();
+}
+
+void HemoCellFields::advanceInteriorCells() {
+  global.statistics.getCurrent()["advanceInteriorCells"].start();
+  long cells = 0;
+  for (plint lbid : immersedParticles->getLocalInfo().getBlocks() ) {
+    HemoCellParticleField & pf = immersedParticles->getComponent(lbid);
+    BlockCostTimer timer(pf.cost,BlockCost::applyConstitutiveModel);
+    cells += pf.advanceInteriorCells();
   }
+  global.statistics.getCurrent().count("interiorCells",cells);
+  global.statistics.getCurrent().stop();
+}
+
+void HemoCellFields::syncEnvelopesSharedMemory(const std::set<int> & node_send_procs, const std::set<int> & node_recv_procs,
+                                               std::map<int,vector<CommunicationInfo3D const *>> & send_infos,
+                                               std::map<int,vector<CommunicationInfo3D const *>> & recv_infos,
+                                               const std::set<int> & locals) {
+  global.statistics.getCurrent()["sharedMemoryEnvelopes"].start();
+
+  // 1. Publish every particle of the blocks our on-node neighbours overlap with, one section per block
+  //    layout: nSections, then per section: blockId, nParticles, serializeValues_t[nParticles]
+  std::set<plint> published_blocks;
+  for (int proc : node_send_procs) {
+    for (CommunicationInfo3D const * info : send_infos[proc]) {
+      published_blocks.insert(info->fromBlockId);
+    }
+  }
+  std::size_t size = sizeof(plint);
+  for (plint bid : published_blocks) {
+    HemoCellParticleField & pf = immersedParticles->getComponent(bid);
+    size += 2*sizeof(plint) + pf.particles.size()*sizeof(HemoCellParticle::serializeValues_t);
+  }
+  char * out = sharedMemory->beginPublish(size);
+  *((plint*)out) = published_blocks.size();
+  out += sizeof(plint);
+  for (plint bid : published_blocks) {
+    HemoCellParticleField & pf = immersedParticles->getComponent(bid);
+    ((plint*)out)[0] = bid;
+    ((plint*)out)[1] = pf.particles.size();
+    out += 2*sizeof(plint);
+    for (HemoCellParticle & particle : pf.particles) {
+      *((HemoCellParticle::serializeValues_t*)out) = particle.sv;
+      out += sizeof(HemoCellParticle::serializeValues_t);
+    }
+  }
+  sharedMemory->publish();
+
+  // 2. Read directly from the buffers of our on-node neighbours, only the cells we have locally
+  for (int proc : node_recv_procs) {
+    std::size_t published_size;
+    const char * in = sharedMemory->getPublished(proc,published_size);
+    std::map<plint,std::pair<const HemoCellParticle::serializeValues_t *,plint>> sections;
+    plint nSections = *((const plint*)in);
+    in += sizeof(plint);
+    for (plint s = 0 ; s < nSections ; s++) {
+      plint bid = ((const plint*)in)[0];
+      plint nParticles = ((const plint*)in)[1];
+      in += 2*sizeof(plint);
+      sections[bid] = std::make_pair((const HemoCellParticle::serializeValues_t *)in,nParticles);
+      in += nParticles*sizeof(HemoCellParticle::serializeValues_t);
+    }
+    for (CommunicationInfo3D const * info : recv_infos[proc]) {
+      if (sections.find(info->fromBlockId) == sections.end()) { continue; }
+      std::pair<const HemoCellParticle::serializeValues_t *,plint> & section = sections[info->fromBlockId];
+      HEMOCELL_PARTICLE_FIELD& toBlock = immersedParticles->getComponent(info->toBlockId);
+      toBlock.getDataTransfer().receiveCells(section.first, section.second, info->absoluteOffset, locals);
+    }
+  }
+
+  // 3. Nobody may overwrite their buffer before everybody is done reading
+  sharedMemory->release();
   global.statistics.getCurrent().stop();
 }
 
 void HemoCellFields::HemoAdvanceParticles::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
-    dynamic_cast<HEMOCELL_PARTICLE_FIELD*>(blocks[0])->advanceParticles();
+    HEMOCELL_PARTICLE_FIELD * pf = dynamic_cast<HEMOCELL_PARTICLE_FIELD*>(blocks[0]);
+    BlockCostTimer timer(pf->cost,BlockCost::advanceParticles);
+    pf->advanceParticles();
 }
 void HemoCellFields::advanceParticles() {
   global.statistics.getCurrent()["advanceParticles"].start();
@@ -512,7 +755,9 @@ void HemoCellFields::advanceParticles() {
 }
 
 void HemoCellFields::HemoSpreadParticleForce::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
-    dynamic_cast<HEMOCELL_PARTICLE_FIELD*>(blocks[0])->spreadParticleForce(domain);
+    HEMOCELL_PARTICLE_FIELD * pf = dynamic_cast<HEMOCELL_PARTICLE_FIELD*>(blocks[0]);
+    BlockCostTimer timer(pf->cost,BlockCost::spreadParticleForce);
+    pf->spreadParticleForce(domain);
 }
 void HemoCellFields::spreadParticleForce() {
   global.statistics.getCurrent()["spreadParticleForce"].start();
@@ -525,7 +770,9 @@ void HemoCellFields::spreadParticleForce() {
 }
 
 void HemoCellFields::HemoApplyConstitutiveModel::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
-    dynamic_cast<HEMOCELL_PARTICLE_FIELD*>(blocks[0])->applyConstitutiveModel(forced);
+    HEMOCELL_PARTICLE_FIELD * pf = dynamic_cast<HEMOCELL_PARTICLE_FIELD*>(blocks[0]);
+    BlockCostTimer timer(pf->cost,BlockCost::applyConstitutiveModel);
+    pf->applyConstitutiveModel(forced);
 }
 void HemoCellFields::applyConstitutiveModel(bool forced) {
   global.statistics.getCurrent()["applyConstitutiveModel"].start();
@@ -540,7 +787,9 @@ void HemoCellFields::applyConstitutiveModel(bool forced) {
 }
 
 void HemoCellFields::HemoUnifyForceVectors::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
-    dynamic_cast<HEMOCELL_PARTICLE_FIELD*>(blocks[0])->unifyForceVectors();
+    HEMOCELL_PARTICLE_FIELD * pf = dynamic_cast<HEMOCELL_PARTICLE_FIELD*>(blocks[0]);
+    BlockCostTimer timer(pf->cost,BlockCost::unifyForceVectors);
+    pf->unifyForceVectors();
 }
 void HemoCellFields::unify_force_vectors() {
   global.statistics.getCurrent()["unifyForceVectors"].start();
@@ -553,7 +802,9 @@ void HemoCellFields::unify_force_vectors() {
 }
 
 void HemoCellFields::HemoRepulsionForce::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
-    dynamic_cast<HEMOCELL_PARTICLE_FIELD*>(blocks[0])->applyRepulsionForce();
+    HEMOCELL_PARTICLE_FIELD * pf = dynamic_cast<HEMOCELL_PARTICLE_FIELD*>(blocks[0]);
+    BlockCostTimer timer(pf->cost,BlockCost::repulsionForce);
+    pf->applyRepulsionForce();
 }
 void HemoCellFields::applyRepulsionForce() {
   global.statistics.getCurrent()["repulsionForce"].start();
@@ -567,7 +818,9 @@ void HemoCellFields::applyRepulsionForce() {
 }
 
 void HemoCellFields::HemoBoundaryRepulsionForce::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
-    dynamic_cast<HEMOCELL_PARTICLE_FIELD*>(blocks[0])->applyBoundaryRepulsionForce();
+    HEMOCELL_PARTICLE_FIELD * pf = dynamic_cast<HEMOCELL_PARTICLE_FIELD*>(blocks[0]);
+    BlockCostTimer timer(pf->cost,BlockCost::boundaryRepulsionForce);
+    pf->applyBoundaryRepulsionForce();
 }
 void HemoCellFields::applyBoundaryRepulsionForce() {
   global.statistics.getCurrent()["boundaryRepulsionForce"].start();
@@ -581,7 +834,9 @@ void HemoCellFields::applyBoundaryRepulsionForce() {
 }
 
 void HemoCellFields::HemoPopulateBoundaryParticles::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
-    dynamic_cast<HEMOCELL_PARTICLE_FIELD*>(blocks[0])->populateBoundaryParticles();
+    HEMOCELL_PARTICLE_FIELD * pf = dynamic_cast<HEMOCELL_PARTICLE_FIELD*>(blocks[0]);
+    BlockCostTimer timer(pf->cost,BlockCost::populateBoundaryParticles);
+    pf->populateBoundaryParticles();
 }
 void HemoCellFields::populateBoundaryParticles() {
     vector<MultiBlock3D*>wrapper;
@@ -591,7 +846,9 @@ void HemoCellFields::populateBoundaryParticles() {
 }
 
 void HemoCellFields::HemoPopulateBindingSites::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
-    dynamic_cast<HEMOCELL_PARTICLE_FIELD*>(blocks[0])->populateBindingSites(domain);
+    HEMOCELL_PARTICLE_FIELD * pf = dynamic_cast<HEMOCELL_PARTICLE_FIELD*>(blocks[0]);
+    BlockCostTimer timer(pf->cost,BlockCost::populateBindingSites);
+    pf->populateBindingSites(domain);
 }
 void HemoCellFields::populateBindingSites(plb::Box3D * box) {
   //Initialize bindingField before entering functional
@@ -609,7 +866,9 @@ void HemoCellFields::populateBindingSites(plb::Box3D * box) {
   applyProcessingFunctional(fnct,domain,wrapper);
 }
 void HemoCellFields::HemoupdateResidenceTime::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
-    dynamic_cast<HEMOCELL_PARTICLE_FIELD*>(blocks[0])->updateResidenceTime(rtime);
+    HEMOCELL_PARTICLE_FIELD * pf = dynamic_cast<HEMOCELL_PARTICLE_FIELD*>(blocks[0]);
+    BlockCostTimer timer(pf->cost,BlockCost::updateResidenceTime);
+    pf->updateResidenceTime(rtime);
 }
 void HemoCellFields::updateResidenceTime(unsigned int rtime) {
     global.statistics.getCurrent()["updateResidenceTime"].start();
@@ -622,7 +881,9 @@ void HemoCellFields::updateResidenceTime(unsigned int rtime) {
 }
 
 void HemoCellFields::HemoSeperateForceVectors::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
-    dynamic_cast<HEMOCELL_PARTICLE_FIELD*>(blocks[0])->separateForceVectors();
+    HEMOCELL_PARTICLE_FIELD * pf = dynamic_cast<HEMOCELL_PARTICLE_FIELD*>(blocks[0]);
+    BlockCostTimer timer(pf->cost,BlockCost::seperateForceVectors);
+    pf->separateForceVectors();
 }
 void HemoCellFields::separate_force_vectors() {
   global.statistics.getCurrent()["separateForceVectors"].start();
@@ -634,7 +895,9 @@ void HemoCellFields::separate_force_vectors() {
   global.statistics.getCurrent().stop();
 }
 void HemoCellFields::HemoDeleteIncompleteCells::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
-    dynamic_cast<HEMOCELL_PARTICLE_FIELD*>(blocks[0])->deleteIncompleteCells(verbose);
+    HEMOCELL_PARTICLE_FIELD * pf = dynamic_cast<HEMOCELL_PARTICLE_FIELD*>(blocks[0]);
+    BlockCostTimer timer(pf->cost,BlockCost::deleteIncompleteCells);
+    pf->deleteIncompleteCells(verbose);
 }
 void HemoCellFields::deleteIncompleteCells(bool verbose) {
   global.statistics.getCurrent()["deleteIncompleteCells"].start();
@@ -649,6 +912,7 @@ void HemoCellFields::deleteIncompleteCells(bool verbose) {
 }
 void HemoCellFields::HemoGetParticles::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
   HEMOCELL_PARTICLE_FIELD * pf = dynamic_cast<HEMOCELL_PARTICLE_FIELD*>(blocks[0]);
+  BlockCostTimer timer(pf->cost,BlockCost::getParticles);
   Box3D localDomain;
   intersect(domain,pf->localDomain,localDomain);
   pf->findParticles(localDomain,particles);
@@ -660,6 +924,7 @@ void HemoCellFields::getParticles(vector<HemoCellParticle *> & particles, Box3D&
 }
 void HemoCellFields::HemoSetParticles::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
   HEMOCELL_PARTICLE_FIELD * pf = dynamic_cast<HEMOCELL_PARTICLE_FIELD*>(blocks[0]);
+  BlockCostTimer timer(pf->cost,BlockCost::setParticles);
   Box3D localDomain;
   intersect(domain,pf->localDomain,localDomain);
   for (HemoCellParticle & particle : particles ) {
@@ -675,6 +940,7 @@ void HemoCellFields::addParticles(vector<HemoCellParticle> & particles) {
 
 void HemoCellFields::HemoDeleteNonLocalParticles::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
   HEMOCELL_PARTICLE_FIELD * pf = dynamic_cast<HEMOCELL_PARTICLE_FIELD*>(blocks[0]);
+  BlockCostTimer timer(pf->cost,BlockCost::deleteNonLocalParticles);
   pf->removeParticles_inverse(pf->localDomain.enlarge(envelopeSize));
 }
 void HemoCellFields::deleteNonLocalParticles(int envelope) {
@@ -689,6 +955,7 @@ void HemoCellFields::deleteNonLocalParticles(int envelope) {
 
 void HemoCellFields::HemoSolidifyCells::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
   HEMOCELL_PARTICLE_FIELD * pf = dynamic_cast<HEMOCELL_PARTICLE_FIELD*>(blocks[0]);
+  BlockCostTimer timer(pf->cost,BlockCost::solidifyCells);
   pf->solidifyCells();
 }
 void HemoCellFields::solidifyCells() {
@@ -32,6 +32,8 @@ class HemoCellFields;
 #include "hemoCellField.h"
 #include "hemoCellParticle.h"
 #include "config.h"
+#include "communicationBufferPool.h"
+#include "sharedMemoryExchange.h"
 #include <unistd.h>
 
 #include "latticeBoltzmann/advectionDiffusionLattices.hh"
@@ -54,7 +56,7 @@ class HemoCellFields
 public:
   
   ///Default constructor, needs an palabos lattice, envelope width (lbm units), and hemocell reference
-  HemoCellFields(plb::MultiBlockLattice3D<T, DESCRIPTOR> & lattice_, unsigned int particleEnvelopeWidth,HemoCell &);
+  HemoCellFields(plb::MultiBlockLattice3D<FLUID_T, DESCRIPTOR> & lattice_, unsigned int particleEnvelopeWidth,HemoCell &);
  
   /*
    * Create the particle field seperately, takes the arguments set in the constructor
@@ -62,7 +64,18 @@ public:
    */
   void createParticleField(plb::SparseBlockStructure3D* sbStructure_ = 0, plb::ThreadAttribution * tAttribution_ = 0);
   
+  /// Create the CEPAC field, with a spacing of parameters/CEPACcoarsening fluid nodes.
+  /// A coarse CEPAC lattice has an atomic block per fluid block (on the same process)
+  /// that covers the coarse nodes within the bulk of the fluid block
   void createCEPACfield();
+
+  /// Relaxation time of the CEPAC field at its spacing and time step, from domain/DCEPAC
+  static T CEPACtau();
+
+  /// Collide and stream the CEPAC field when this is a CEPAC time step (parameters/CEPACtimeStep).
+  /// The fluid velocity is restricted to the CEPAC lattice first, so the fluid envelopes must be
+  /// up to date (after FluidHaloExchange::finish() in the split-phase iteration)
+  void CEPACcollideAndStream();
   
   ///Used to set variables inside the celltypes for correct access, called through createParticleField
   void InitAfterLoadCheckpoint();
@@ -132,8 +145,17 @@ public:
   /// Apply the material model of the cells to the particles, updating their force
   void applyConstitutiveModel(bool forced = false);
   
-  /// Sync the particle envelopes between domains
-  void syncEnvelopes();
+  /// Sync the particle envelopes between domains. With advanceInterior the cells that
+  /// are not part of any envelope are advanced and get their mechanics while the
+  /// messages are in flight, see HemoCellParticleField::advanceInteriorCells()
+  void syncEnvelopes(bool advanceInterior = false);
+private:
+  /// Part of syncEnvelopes for the neighbours on the same node
+  void syncEnvelopesSharedMemory(const std::set<int> & node_send_procs, const std::set<int> & node_recv_procs,
+                                 std::map<int,vector<plb::CommunicationInfo3D const *>> & send_infos,
+                                 std::map<int,vector<plb::CommunicationInfo3D const *>> & recv_infos,
+                                 const std::set<int> & locals);
+public:
 
   /// Get particles in a given domain
   void getParticles(vector<HemoCellParticle*> & particles, plb::Box3D & domain);
@@ -159,7 +181,7 @@ public:
   //Class Variables
   
   ///the fluid lattice
-  plb::MultiBlockLattice3D<T, DESCRIPTOR> * lattice;
+  plb::MultiBlockLattice3D<FLUID_T, DESCRIPTOR> * lattice;
   ///A vector specifying the output variables (from const_defaults.h)
   vector<int> desiredFluidOutputVariables;
   
@@ -176,7 +198,7 @@ public:
   plb::MultiParticleField3D<HEMOCELL_PARTICLE_FIELD> * preinlet_immersedParticles = 0, * domain_immersedParticles = 0;
 
   /// palabos field for storing the CPAC scalar field if used
-  plb::MultiBlockLattice3D<T,CEPAC_DESCRIPTOR> * CEPACfield = 0; 
+  plb::MultiBlockLattice3D<CEPAC_T,CEPAC_DESCRIPTOR> * CEPACfield = 0; 
 
   ///Repulsion variable set through hemocell.h
   T repulsionCutoff = 0.0;
@@ -207,7 +229,12 @@ public:
   int periodicity_limit_offset_z = 10000;
   
 private:
-  vector<vector<NoInitChar>> sendBuffers, recvBuffers;
+  ///Set the advection velocity of the CEPAC lattice to the fluid velocity around its nodes
+  void restrictVelocityToCEPAC();
+  /// Part of syncEnvelopes(true)
+  void advanceInteriorCells();
+  ///Persistent buffers for the envelope particles and the cellId requests in syncEnvelopes
+  CommunicationBufferPool particleBuffers{"particleEnvelope"}, cellIdBuffers{"cellIdExchange"};
 public:
   
   /**
@@ -221,9 +248,16 @@ public:
    unsigned int max_neighbours = 0;
    
    plb::CommunicationStructure3D * large_communicator = 0;
+   ///Only when parameters/sharedMemoryEnvelopes is set, used for the envelopes of neighbours on the same node
+   SharedMemoryExchange * sharedMemory = 0;
    plb::ParallelBlockCommunicator3D envelope_communicator;
    
    void calculateCommunicationStructure();
+
+   /// Spread the wall clock time of a fluid step over the local blocks by their number of fluid cells
+   void distributeFluidTime(double seconds);
+   /// Close the BlockCost sample of this iteration on all local blocks
+   void closeBlockCostSample();
    
    /*
    * Functionals needed for access of the cellfields
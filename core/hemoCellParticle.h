@@ -72,8 +72,11 @@ public:
   std::vector<hemo::Array<plint, 3>> kernelCoordinates;
   #endif
 
-  std::vector<plb::Cell<T,DESCRIPTOR>*> kernelLocations;
+  std::vector<plb::Cell<FLUID_T,DESCRIPTOR>*> kernelLocations;
   std::vector<T>         kernelWeights;
+  /// The kernel above must be recomputed before it is used, set when the
+  /// particle moves, migrates or the lattice under it changes
+  bool kernelDirty = true;
 
   hemo::Array<T,3> *force_volume = &sv.force;
   hemo::Array<T,3> *force_bending = &sv.force;
@@ -91,6 +94,7 @@ public:
     tag = copy.tag;
     kernelLocations = copy.kernelLocations;
     kernelWeights = copy.kernelWeights;
+    kernelDirty = copy.kernelDirty;
     #ifdef INTERIOR_VISCOSITY
     normalDirection = copy.normalDirection;
     kernelCoordinates = copy.kernelCoordinates;
@@ -140,6 +144,7 @@ public:
     sv = copy.sv;
     kernelLocations = copy.kernelLocations;
     kernelWeights = copy.kernelWeights;
+    kernelDirty = copy.kernelDirty;
     #ifdef INTERIOR_VISCOSITY
     normalDirection = copy.normalDirection;
     kernelCoordinates = copy.kernelCoordinates;
@@ -193,11 +198,15 @@ public:
          */
         #if HEMOCELL_MATERIAL_INTEGRATION == 1
               sv.position += sv.v;
+              if (sv.v[0] != 0.0 || sv.v[1] != 0.0 || sv.v[2] != 0.0) {
+                kernelDirty = true;
+              }
 
         #elif HEMOCELL_MATERIAL_INTEGRATION == 2
               hemo::Array<T,3> dxyz = (1.5*v - 0.5*vPrevious);
               position +=  dxyz;
               vPrevious = v;  // Store velocity
+              kernelDirty = true;
         #endif
         //v = {0.0,0.0,0.0};
     }
@@ -24,6 +24,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "hemoCellParticleDataTransfer.h"
 #include "hemoCellParticleField.h"
 #include "hemocell.h"
+#include "leesEdwardsBC.h"
 
 namespace hemo
 {
@@ -266,6 +267,40 @@ void HemoCellParticleDataTransfer::receivePreInlet(char *buffer, unsigned int si
   global.statistics.getCurrent().stop();
 }
 
+void HemoCellParticleDataTransfer::receiveCells(const HemoCellParticle::serializeValues_t *svs, unsigned int n, Dot3D absoluteOffset, std::set<int> const &cellIds)
+{
+  global.statistics.getCurrent()["SharedMemoryReceive"].start();
+
+  int offset = getOffset(absoluteOffset);
+  hemo::Array<T, 3> realAbsoluteOffset({(T)absoluteOffset.x, (T)absoluteOffset.y, (T)absoluteOffset.z});
+  HemoCellParticle::serializeValues_t newParticle;
+  for (unsigned int i = 0; i < n; i++)
+  {
+    int cellId = svs[i].cellId;
+    //Check for overflows
+    if (((offset < 0) && (cellId < INT_MIN - offset)) ||
+        ((offset > 0) && (cellId > INT_MAX - offset)))
+    {
+      cout << "(HemoCellParticleDataTransfer) Almost invoking overflow in periodic particle communication, resetting ID to base ID instead, this will most likely delete the particle" << endl;
+      cellId = particleField->cellFields->base_cell_id(cellId);
+    }
+    else
+    {
+      cellId += offset;
+    }
+    if (cellIds.find(cellId) == cellIds.end())
+    {
+      continue;
+    }
+    //The source is not ours to edit, copy only what we keep
+    newParticle = svs[i];
+    newParticle.cellId = cellId;
+    newParticle.position += realAbsoluteOffset;
+    particleField->addParticle(newParticle);
+  }
+  global.statistics.getCurrent().stop();
+}
+
 void HemoCellParticleDataTransfer::receive(char *buffer, unsigned int size, modif::ModifT kind, Dot3D absoluteOffset)
 {
   if (absoluteOffset.x == 0 && absoluteOffset.y == 0 && absoluteOffset.z == 0)
@@ -384,23 +419,20 @@ void HemoCellParticleDataTransfer::attribute(
 
   if ((kind == modif::hemocell || kind == modif::dataStructure))
   {
-    //Box3D fromDomain(toDomain.shift(deltaX,deltaY,deltaZ));
     HemoCellParticleField const &fromParticleField =
         dynamic_cast<HemoCellParticleField const &>(from);
-    vector<const HemoCellParticle *> particles;
-    //fromParticleField.findParticles(fromDomain, particles);
     //Calling addParticle on self can invalidate particles pointer array on realloc from vector
-    //Do for every local communication to accomodate overcoupling particle field in the future.
+    //Therefore copy the particles that end up in toDomain first, then append them in bulk
     vector<HemoCellParticle::serializeValues_t> sv_values;
-    sv_values.reserve(fromParticleField.particles.size());
     for (const HemoCellParticle &particle : fromParticleField.particles)
     {
+      if (!particleField->isContainedABS(particle.sv.position, toDomain))
+      {
+        continue;
+      }
       sv_values.emplace_back(particle.sv);
     }
-    for (const HemoCellParticle::serializeValues_t &sv : sv_values)
-    {
-      particleField->addParticle(sv);
-    }
+    particleField->addParticles(sv_values);
   }
   global.statistics.getCurrent().stop();
 }
@@ -419,26 +451,41 @@ void HemoCellParticleDataTransfer::attribute(
 
   if ((kind == modif::hemocell || kind == modif::dataStructure))
   {
-    //Box3D fromDomain(toDomain.shift(deltaX,deltaY,deltaZ));
     HemoCellParticleField const &fromParticleField =
         dynamic_cast<HemoCellParticleField const &>(from);
-    //vector<const HemoCellParticle *> particles;
-    //fromParticleField.findParticles(fromDomain, particles);
     int offset = getOffset(absoluteOffset);
     hemo::Array<T, 3> realAbsoluteOffset({(T)absoluteOffset.x, (T)absoluteOffset.y, (T)absoluteOffset.z});
-    plint nZ = this->particleField->cellFields->hemocell.lattice->getNz();
-    if (absoluteOffset.z == -nZ) {
-      realAbsoluteOffset[0] += *this->particleField->cellFields->hemocell.LEcurrentDisplacement;
-    }
-    if (absoluteOffset.z == nZ) {
-      realAbsoluteOffset[0] -= *this->particleField->cellFields->hemocell.LEcurrentDisplacement;
+    //The Lees-Edwards shift moves particles along the flow direction with respect to the overlap,
+    //so do not filter on that direction then and let addParticle check the bounding box
+    Box3D filterDomain(toDomain);
+    const HemoCell & hemocell = this->particleField->cellFields->hemocell;
+    if (hemocell.leesEdwards) {
+      const unsigned int normal = hemocell.leesEdwards->getNormal(), flow = hemocell.leesEdwards->getFlow();
+      const plint n[3] = {hemocell.lattice->getNx(), hemocell.lattice->getNy(), hemocell.lattice->getNz()};
+      const plint offsets[3] = {absoluteOffset.x, absoluteOffset.y, absoluteOffset.z};
+      if (offsets[normal] == -n[normal] || offsets[normal] == n[normal]) {
+        if (offsets[normal] == -n[normal]) {
+          realAbsoluteOffset[flow] += hemocell.leesEdwards->getDisplacement();
+        } else {
+          realAbsoluteOffset[flow] -= hemocell.leesEdwards->getDisplacement();
+        }
+        const Box3D bbox = particleField->getBoundingBox();
+        switch (flow) {
+          case 0: filterDomain.x0 = bbox.x0; filterDomain.x1 = bbox.x1; break;
+          case 1: filterDomain.y0 = bbox.y0; filterDomain.y1 = bbox.y1; break;
+          default: filterDomain.z0 = bbox.z0; filterDomain.z1 = bbox.z1; break;
+        }
+      }
     }
     //Calling addParticle on self can invalidate particles pointer array on realloc from vector
-    //Do for every local communication to accomodate overcoupling particle field in the future.
+    //Therefore copy the particles that end up in toDomain first, then append them in bulk
     vector<HemoCellParticle::serializeValues_t> sv_values;
-    sv_values.reserve(fromParticleField.particles.size());
     for (const HemoCellParticle &particle : fromParticleField.particles)
     {
+      if (!particleField->isContainedABS(particle.sv.position + realAbsoluteOffset, filterDomain))
+      {
+        continue;
+      }
       sv_values.emplace_back(particle.sv);
       sv_values.back().position += realAbsoluteOffset;
 
@@ -454,11 +501,7 @@ void HemoCellParticleDataTransfer::attribute(
         sv_values.back().cellId += offset;
       }
     }
-    // pcout << sv_values.size() << endl;
-    for (const HemoCellParticle::serializeValues_t &sv : sv_values)
-    {
-      particleField->addParticle(sv);
-    }
+    particleField->addParticles(sv_values);
   }
   global.statistics.getCurrent().stop();
 }
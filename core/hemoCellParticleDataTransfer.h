@@ -47,6 +47,8 @@ public:
     void receive(char *, unsigned int size, modif::ModifT);
     void receive(char *, unsigned int size, modif::ModifT, Dot3D absoluteOffset);
     void receivePreInlet(char *, unsigned int size, modif::ModifT, Dot3D absoluteOffset);
+    //Read-only source (shared memory of another process), only particles of the given (offset) cellIds are added
+    void receiveCells(const HemoCellParticle::serializeValues_t *, unsigned int n, Dot3D absoluteOffset, std::set<int> const& cellIds);
 
     virtual void receive(Box3D domain, std::vector<NoInitChar> const& buffer);
     virtual void receive(Box3D domain, std::vector<NoInitChar> const& buffer, Dot3D absoluteOffset);
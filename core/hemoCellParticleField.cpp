@@ -24,7 +24,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "hemoCellParticleField.h"
 #include "hemocell.h"
-#include "octree.h"
+#include "cellBVH.h"
 #include "mollerTrumbore.h"
 #include "bindingField.h"
 #include "interiorViscosity.h"
@@ -75,10 +75,6 @@ HemoCellParticleField::~HemoCellParticleField()
   
   // Sanitize for MultiBlockLattice destructor (releasememory). It can't handle releasing non-background dynamics that are not singular
   if (global.enableInteriorViscosity) {
-    for (const Dot3D & internalPoint : internalPoints ) {
-      atomicLattice->get(internalPoint.x,internalPoint.y,internalPoint.z);
-      atomicLattice->get(internalPoint.x,internalPoint.y,internalPoint.z).attributeDynamics(&atomicLattice->getBackgroundDynamics());
-    }
     InteriorViscosityHelper::get(*cellFields).empty(*this);
   }
 }
@@ -191,6 +187,7 @@ void HemoCellParticleField::addParticle(const HemoCellParticle::serializeValues_
           local_sparticle->sv = sv;
           particle = local_sparticle;
           particle->setTag(-1);
+          particle->kernelDirty = true;
 
           //Invalidate lpc hemo::Array
           lpc_up_to_date = false;
@@ -234,6 +231,17 @@ outer_else:
   }
 }
 
+void HemoCellParticleField::addParticles(const vector<HemoCellParticle::serializeValues_t> & svs) {
+  if (svs.empty()) { return; }
+  // Grow geometrically, an exact reserve on every call would copy the vector each time
+  if (particles.size()+svs.size() > particles.capacity()) {
+    particles.reserve(std::max(particles.size()+svs.size(), 2*particles.capacity()));
+  }
+  for (const HemoCellParticle::serializeValues_t & sv : svs) {
+    addParticle(sv);
+  }
+}
+
 void HemoCellParticleField::addParticlePreinlet(const HemoCellParticle::serializeValues_t & sv) {
   HemoCellParticle * local_sparticle, * particle;
   const hemo::Array<T,3> & pos = sv.position;
@@ -565,6 +573,7 @@ void HemoCellParticleField::setlocalDomain(Box3D & localDomain_) {
 
 void HemoCellParticleField::advanceParticles() {
   for(HemoCellParticle & particle:particles){
+    if (!interiorCells.empty() && interiorCells.count(particle.sv.cellId)) { continue; }
     particle.advance();
     //By lack of better place, check if it is on a boundary, if so, delete it
     plb::Box3D const box = atomicLattice->getBoundingBox();
@@ -587,6 +596,73 @@ void HemoCellParticleField::advanceParticles() {
   pg_up_to_date = false;
 }
 
+int HemoCellParticleField::advanceInteriorCells() {
+  interiorCells.clear();
+  //The envelope of a neighbour reaches envelopeSize into the local domain
+  const plint e = envelopeSize;
+  const Box3D interior(localDomain.x0+e,localDomain.x1-e,
+                       localDomain.y0+e,localDomain.y1-e,
+                       localDomain.z0+e,localDomain.z1-e);
+  map<int,vector<HemoCellParticle*>> ppc_interior;
+  map<int,bool> lpc;
+  for (const auto & pair : get_particles_per_cell()) {
+    bool inside = true;
+    for (int index : pair.second) {
+      if (index == -1 || !isContainedABS(particles[index].sv.position,interior)) {
+        inside = false;
+        break;
+      }
+    }
+    if (!inside) { continue; }
+    vector<HemoCellParticle*> & cell = ppc_interior[pair.first];
+    for (int index : pair.second) {
+      cell.push_back(&particles[index]);
+    }
+    lpc[pair.first] = true;
+    interiorCells.insert(pair.first);
+  }
+  if (lpc.empty()) { return 0; }
+
+  //Same as advanceParticles, the particles tagged here are removed there
+  plb::Box3D const box = atomicLattice->getBoundingBox();
+  plb::Dot3D const& location = atomicLattice->getLocation();
+  for (const auto & pair : ppc_interior) {
+    for (HemoCellParticle * particle : pair.second) {
+      particle->advance();
+      plint x = (particle->sv.position[0]-location.x)+0.5;
+      plint y = (particle->sv.position[1]-location.y)+0.5;
+      plint z = (particle->sv.position[2]-location.z)+0.5;
+      if ((x >= box.x0) && (x <= box.x1) &&
+          (y >= box.y0) && (y <= box.y1) &&
+          (z >= box.z0) && (z <= box.z1)) {
+        if (atomicLattice->get(x,y,z).getDynamics().isBoundary()) {
+          particle->tag = 1;
+        }
+      }
+    }
+  }
+
+  //Same as applyConstitutiveModel
+  for (pluint ctype = 0; ctype < (*cellFields).size(); ctype++) {
+    if ((*cellFields).hemocell.iter % (*cellFields)[ctype]->timescale == 0) {
+      for (const auto & pair : ppc_interior) {
+        for (HemoCellParticle * particle : pair.second) {
+          if (particle->sv.celltype != ctype || particle->force_area != &particle->sv.force) { continue; }
+          particle->sv.force = {0.,0.,0.};
+#ifdef INTERIOR_VISCOSITY
+          particle->normalDirection = {0., 0., 0.};
+#endif
+        }
+      }
+      (*cellFields)[ctype]->mechanics->ParticleMechanics(ppc_interior,lpc,ctype);
+    }
+  }
+
+  lpc_up_to_date = false;
+  pg_up_to_date = false;
+  return lpc.size();
+}
+
 void HemoCellParticleField::separateForceVectors() {
   //Also save the total force, therfore recalculate in advance
   applyConstitutiveModel();
@@ -650,6 +726,10 @@ void HemoCellParticleField::applyConstitutiveModel(bool forced) {
     lpc[cid]=true;
     no_add_lpc:;
   }
+  //These were already calculated by advanceInteriorCells()
+  for (int cid : interiorCells) {
+    lpc.erase(cid);
+  }
   
   for (pluint ctype = 0; ctype < (*cellFields).size(); ctype++) {
     if ((*cellFields).hemocell.iter % (*cellFields)[ctype]->timescale == 0 || forced) {
@@ -659,6 +739,7 @@ void HemoCellParticleField::applyConstitutiveModel(bool forced) {
         //only reset forces when the forces actually point at it.
         if (found[0]->force_area == &found[0]->sv.force) {
           for (HemoCellParticle* particle : found) {
+            if (!interiorCells.empty() && interiorCells.count(particle->sv.cellId)) { continue; }
             particle->sv.force = {0.,0.,0.};
 #ifdef INTERIOR_VISCOSITY
             particle->normalDirection = {0., 0., 0.};
@@ -671,6 +752,7 @@ void HemoCellParticleField::applyConstitutiveModel(bool forced) {
   }
   
   delete ppc_new;
+  interiorCells.clear();
   
 }
 
@@ -761,26 +843,52 @@ void HemoCellParticleField::internalGridPointsMembrane(Box3D domain) {
                 particle.kernelCoordinates[i][1],
                 particle.kernelCoordinates[i][2]},
                 (*cellFields)[particle.sv.celltype]->interiorViscosityTau);
-        particle.kernelLocations[i]->attributeDynamics((*cellFields)[particle.sv.celltype]->innerViscosityDynamics);
       } else {  // Node is outside
         InteriorViscosityHelper::get(*cellFields).remove(*this, {particle.kernelCoordinates[i][0],
                                                                 particle.kernelCoordinates[i][1],
                                                                 particle.kernelCoordinates[i][2]});
-        particle.kernelLocations[i]->attributeDynamics(&atomicLattice->getBackgroundDynamics());
       }
     }
   }
 }
 
+namespace {
+/// Interior nodes (local coordinates) of a cell from its interior nodes at the previous update. A node can
+/// only change side when the membrane passed it, so only the nodes within the largest vertex displacement
+/// of the previous membrane are tested again, all others keep their state. Returns false when the cell
+/// moved too far (parameters/incrementalInteriorDisplacement) and has to be tested completely
+bool incrementalInnerNodes(const hemo::CellBVH & bvh, vector<HemoCellParticle> & particles, const vector<int> & cell,
+                           const HemoCellParticleField::InteriorNodeState & previous,
+                           BlockLattice3D<FLUID_T,DESCRIPTOR> & fluid, std::set<Array<plint,3>> & innerNodes) {
+  if (previous.positions.size() != cell.size()) {
+    return false;
+  }
+  T maxDisplacement = 0.;
+  for (unsigned int i = 0; i < cell.size(); i++) {
+    if (cell[i] == -1) {
+      return false;
+    }
+    maxDisplacement = std::max(maxDisplacement, computeLength(particles[cell[i]].sv.position - previous.positions[i]));
+  }
+  if (maxDisplacement > global.incrementalInteriorDisplacement) {
+    return false;
+  }
+
+  innerNodes = previous.innerNodes;
+  bvh.updateInnerNodes(&fluid, previous.positions, maxDisplacement, innerNodes);
+  return true;
+}
+}
+
 // For performance reason, this is only executed once every n iterations to make
 // sure that there are no higher viscosity grid points left after substantial movement
 void HemoCellParticleField::findInternalParticleGridPoints(Box3D domain) {
   // Reset all the lattice points to the orignal relaxation parameter
-  for (const Dot3D & internalPoint : internalPoints ) {
-    atomicLattice->get(internalPoint.x,internalPoint.y,internalPoint.z);
-    atomicLattice->get(internalPoint.x,internalPoint.y,internalPoint.z).attributeDynamics(&atomicLattice->getBackgroundDynamics());
-  }
   InteriorViscosityHelper::get(*cellFields).empty(*this);
+
+  // Cells that left the block are dropped with the previous states
+  map<int,InteriorNodeState> previousStates;
+  previousStates.swap(interiorNodeStates);
   
   for (const auto & pair : get_lpc()) { // Go over each cell?
     const int & cid = pair.first;
@@ -793,15 +901,26 @@ void HemoCellParticleField::findInternalParticleGridPoints(Box3D domain) {
       continue;
     }
     
-    hemo::OctreeStructCell octCell(3, 1, 30,
-                                  (*cellFields)[ctype]->mechanics->cellConstants.triangle_list,
-                                  particles, cell);
+    const hemo::CellBVH & bvh = hemo::CellBVH::forCell((*cellFields)[ctype]->mechanics->cellConstants.triangle_list,
+                                                       particles, cell);
 
     std::set<Array<plint,3>> innerNodes;
-    octCell.findInnerNodes(atomicLattice,particles,cell,innerNodes);
+    const auto previous = previousStates.find(cid);
+    if (!global.enableIncrementalInteriorNodes || previous == previousStates.end() ||
+        !incrementalInnerNodes(bvh, particles, cell, previous->second, *atomicLattice, innerNodes)) {
+      bvh.findInnerNodes(atomicLattice,innerNodes);
+    }
     for (const Array<plint,3> & node : innerNodes) {
       InteriorViscosityHelper::get(*cellFields).add(*this, {node[0],node[1],node[2]},(*cellFields)[ctype]->interiorViscosityTau );
-      atomicLattice->get(node[0],node[1],node[2]).attributeDynamics((*cellFields)[ctype]->innerViscosityDynamics);
+    }
+
+    if (global.enableIncrementalInteriorNodes && std::find(cell.begin(),cell.end(),-1) == cell.end()) {
+      InteriorNodeState & state = interiorNodeStates[cid];
+      state.positions.resize(cell.size());
+      for (unsigned int i = 0; i < cell.size(); i++) {
+        state.positions[i] = particles[cell[i]].sv.position;
+      }
+      state.innerNodes.swap(innerNodes);
     }
   }
 }
@@ -819,7 +938,7 @@ void HemoCellParticleField::internalGridPointsMembrane(Box3D domain) {
 void HemoCellParticleField::interpolateFluidVelocity(Box3D domain) {
   //Prealloc is nice
   hemo::Array<T,3> velocity;
-  plb::Array<T,3> velocity_comp;
+  plb::Array<FLUID_T,3> velocity_comp;
 
   for (HemoCellParticle &particle:particles) {
 
@@ -832,7 +951,9 @@ void HemoCellParticleField::interpolateFluidVelocity(Box3D domain) {
     for (pluint j = 0; j < particle.kernelLocations.size(); j++) {
       //Yay for direct access
       particle.kernelLocations[j]->computeVelocity(velocity_comp);
-      velocity += (velocity_comp * particle.kernelWeights[j]);
+      for (int d = 0; d < 3; d++) {
+        velocity[d] += velocity_comp[d] * particle.kernelWeights[j];
+      }
     }
     particle.sv.v = velocity;
   }
@@ -840,10 +961,16 @@ void HemoCellParticleField::interpolateFluidVelocity(Box3D domain) {
 }
 
 void HemoCellParticleField::spreadParticleForce(Box3D domain) {
+  long rebuilds = 0;
   for( HemoCellParticle &particle:particles) {
 
     //Clever trick to allow for different kernels for different particle types.
-    (*cellFields)[particle.sv.celltype]->kernelMethod(*atomicLattice,particle);
+    //Only particles that moved since their kernel was computed need a new one
+    if (particle.kernelDirty) {
+      (*cellFields)[particle.sv.celltype]->kernelMethod(*atomicLattice,particle);
+      particle.kernelDirty = false;
+      rebuilds++;
+    }
 
     // Capping force to ensure stability -> NOTE: this introduces error!
 #ifdef FORCE_LIMIT
@@ -862,6 +989,14 @@ void HemoCellParticleField::spreadParticleForce(Box3D domain) {
     }
 
   }
+  global.statistics.getCurrent().count("kernelRebuilds",rebuilds);
+  global.statistics.getCurrent().count("kernelReuses",particles.size()-rebuilds);
+}
+
+void HemoCellParticleField::invalidateKernels() {
+  for (HemoCellParticle & particle : particles) {
+    particle.kernelDirty = true;
+  }
 }
 
 void HemoCellParticleField::populateBoundaryParticles() {
@@ -952,14 +1087,14 @@ end_inner_loop:;
 }
 
 
-T HemoCellParticleField::eigenValueFromCell(plb::Cell<T,DESCRIPTOR> & cell) {
-    plb::Array<T,SymmetricTensor<T,DESCRIPTOR>::n> element;
+T HemoCellParticleField::eigenValueFromCell(plb::Cell<FLUID_T,DESCRIPTOR> & cell) {
+    plb::Array<FLUID_T,SymmetricTensor<FLUID_T,DESCRIPTOR>::n> element;
     cell.computePiNeq(element);
-    T omega     = cell.getDynamics().getOmega();
+    T omega     = omegaOf(cell);
     T rhoBar    = cell.getDynamics().computeRhoBar(cell);
     T prefactor = - omega * DESCRIPTOR<T>::invCs2 *
                  DESCRIPTOR<T>::invRho(rhoBar) / (T)2;
-        for (int iTensor=0; iTensor<SymmetricTensor<T,DESCRIPTOR>::n; ++iTensor) {
+        for (int iTensor=0; iTensor<SymmetricTensor<FLUID_T,DESCRIPTOR>::n; ++iTensor) {
             element[iTensor] *= prefactor;
         }
 
@@ -1012,6 +1147,8 @@ void HemoCellParticleField::solidifyCells() {
     }
   }
   removeParticles(1);
+  //Solidified nodes are bounce back now, they must leave the kernels around them
+  invalidateKernels();
   if(!pg_up_to_date) {
     update_pg();
   }
@@ -26,11 +26,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 namespace hemo {
   class HemoCellParticleField;
+  class InteriorViscosityDynamics;
 }
 
 #include "hemoCellFields.h"
 #include "hemoCellParticleDataTransfer.h"
 #include "hemoCellParticle.h"
+#include "blockCost.h"
 
 #include "atomicBlock/blockLattice3D.hh"
 
@@ -47,6 +49,8 @@ public:
     virtual void applyConstitutiveModel(bool forced = false);
     virtual void addParticle(HemoCellParticle* particle);
     void addParticle(const HemoCellParticle::serializeValues_t & sv);
+    ///Bulk version of addParticle, grows the storage at most once (geometrically) for all new particles
+    void addParticles(const vector<HemoCellParticle::serializeValues_t> & svs);
     void addParticlePreinlet(const HemoCellParticle::serializeValues_t & sv);
 
     virtual void removeParticles(plb::Box3D domain);
@@ -61,9 +65,19 @@ public:
                                std::vector<HemoCellParticle*>& found,
                                pluint type);
     virtual void advanceParticles();
+    ///Advance and apply the mechanics of the complete cells that are further than the particle
+    ///envelope inside the local domain. syncEnvelopes neither sends nor receives these, so this
+    ///can run while its messages are in flight. Returns the number of cells
+    int advanceInteriorCells();
+    ///Cells handled by advanceInteriorCells() in this iteration, advanceParticles() and
+    ///applyConstitutiveModel() skip them
+    set<int> interiorCells;
     void applyRepulsionForce(bool forced = false);
     virtual void interpolateFluidVelocity(plb::Box3D domain);
+    ///Spread the force of the particles, recomputes the kernel of the particles that moved since the last call
     virtual void spreadParticleForce(plb::Box3D domain);
+    ///Recompute the kernel of every particle on the next spreadParticleForce, needed when the lattice cells are changed or moved
+    void invalidateKernels();
     void separateForceVectors();
     void unifyForceVectors();
     void updateResidenceTime(unsigned int rtime);
@@ -78,7 +92,7 @@ public:
     void applyBoundaryRepulsionForce();
     void populateBindingSites(plb::Box3D & domain);
 
-    T eigenValueFromCell(plb::Cell<T,DESCRIPTOR> & cell);
+    T eigenValueFromCell(plb::Cell<FLUID_T,DESCRIPTOR> & cell);
     
     void solidifyCells();
     
@@ -133,8 +147,8 @@ public:
     static std::string getBlockName();
     static HemoCellFields* cellFields;
     pluint atomicBlockId;
-    plb::BlockLattice3D<T, DESCRIPTOR> * atomicLattice = 0;
-    plb::BlockLattice3D<T, CEPAC_DESCRIPTOR> * CEPAClattice = 0;
+    plb::BlockLattice3D<FLUID_T, DESCRIPTOR> * atomicLattice = 0;
+    plb::BlockLattice3D<CEPAC_T, CEPAC_DESCRIPTOR> * CEPAClattice = 0;
 
     vector<plint> neighbours;
     vector<plb::Dot3D> boundaryParticles;
@@ -148,6 +162,8 @@ public:
     vector<HemoCellParticle> particles;
     plb::Box3D boundingBox; 
     int nFluidCells = 0;
+    ///Wall clock time per functional and the share of the fluid step over a sliding window, used by the LoadBalancer
+    BlockCost cost;
     
 private:
   bool lpc_up_to_date = false;
@@ -188,7 +204,16 @@ public:
   const map<int,bool> & get_lpc();
   
   set<plb::Dot3D> internalPoints; // Store found interior points
+  /// Membrane and interior nodes (local coordinates) of a cell at the last findInternalParticleGridPoints()
+  struct InteriorNodeState {
+    vector<hemo::Array<T,3>> positions;
+    set<hemo::Array<plint,3>> innerNodes;
+  };
+  /// Only kept with parameters/incrementalInteriorNodes
+  map<int,InteriorNodeState> interiorNodeStates;
   plb::ScalarField3D<T> * interiorViscosityField = 0;
+  /// Dynamics of the interior nodes of this block, owned by the InteriorViscosityHelper
+  InteriorViscosityDynamics * interiorViscosityDynamics = 0;
   
     
     //vector<vector<vector<vector<HemoCellParticle*>>>> particle_grid; //maybe better to make custom data structure, But that would be slower
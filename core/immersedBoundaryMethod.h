@@ -60,7 +60,7 @@ void interpolationCoefficientsPhi1 (
         std::vector<Dot3D>& cellPos, std::vector<T>& weights);
 
 inline void interpolationCoefficientsPhi2 (
-        BlockLattice3D<T,DESCRIPTOR> & block, HemoCellParticle & particle)
+        BlockLattice3D<FLUID_T,DESCRIPTOR> & block, HemoCellParticle & particle)
 {
     //Clean current
     particle.kernelWeights.clear();
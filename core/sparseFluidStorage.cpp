@@ -0,0 +1,125 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "sparseFluidStorage.h"
+#include "config.h"
+#include "logfile.h"
+
+#include "palabos3D.h"
+#include "palabos3D.hh"
+
+namespace hemo {
+using namespace plb;
+
+typedef DESCRIPTOR<T> D;
+
+void SparseFluidStorage::compact(MultiBlockLattice3D<FLUID_T,DESCRIPTOR> & lattice, MultiScalarField3D<int> & flagMatrix) {
+  compact(lattice,&flagMatrix);
+}
+
+void SparseFluidStorage::compact(MultiBlockLattice3D<FLUID_T,DESCRIPTOR> & lattice) {
+  compact(lattice,0);
+}
+
+void SparseFluidStorage::compact(MultiBlockLattice3D<FLUID_T,DESCRIPTOR> & lattice, MultiScalarField3D<int> * flagMatrix) {
+  global.statistics.getCurrent()["compactFluidStorage"].start();
+  if (flagMatrix) {
+    flagMatrix->duplicateOverlaps(modif::staticVariables);
+  }
+  std::map<plint,Box3D> const & bulks = lattice.getSparseBlockStructure().getBulks();
+  std::map<plint,Box3D> const * flagBulks = flagMatrix ? &flagMatrix->getSparseBlockStructure().getBulks() : 0;
+
+  Usage usage;
+  bool flagsMatch = true;
+  for (plint bid : lattice.getLocalInfo().getBlocks()) {
+    BlockLattice3D<FLUID_T,DESCRIPTOR> & block = lattice.getComponent(bid);
+    ScalarField3D<int> * flags = 0;
+    if (flagBulks) {
+      auto flagBulk = flagBulks->find(bid);
+      if (flagBulk != flagBulks->end() && flagBulk->second == bulks.at(bid) &&
+          flagMatrix->getComponent(bid).getBoundingBox() == block.getBoundingBox()) {
+        flags = &flagMatrix->getComponent(bid);
+      } else {
+        flagsMatch = false;
+      }
+    }
+    const Dot3D location = block.getLocation();
+    compactBlock(block,flags,bulks.at(bid).shift(-location.x,-location.y,-location.z),usage);
+  }
+  if (!flagsMatch) {
+    hlog << "(SparseFluidStorage) (Warning) The flag matrix does not have the block structure of the lattice, the fluid nodes are taken from the dynamics" << std::endl;
+  }
+
+  long total[3] = {usage.nodes, usage.storedCells, usage.fluidNodes};
+  MPI_Allreduce(MPI_IN_PLACE,total,3,MPI_LONG,MPI_SUM,MPI_COMM_WORLD);
+  const double cellBytes = sizeof(Cell<FLUID_T,DESCRIPTOR>);
+  const double denseBytes = total[0]*cellBytes;
+  const double sparseBytes = total[1]*cellBytes + total[0]*sizeof(int);
+  const long fluidNodes = std::max(total[2],1L);
+  hlog << "(SparseFluidStorage) Storing " << total[1] << " of " << total[0] << " nodes, "
+       << sparseBytes/fluidNodes << " bytes per fluid node (dense storage: " << denseBytes/fluidNodes << ")" << std::endl;
+  global.statistics.getCurrent().stop();
+}
+
+void SparseFluidStorage::compactBlock(BlockLattice3D<FLUID_T,DESCRIPTOR> & block, ScalarField3D<int> * flags, Box3D bulk, Usage & usage) {
+  static const int bbId = BounceBack<FLUID_T,DESCRIPTOR>().getId();
+  ImplicitGrid3D<FLUID_T,DESCRIPTOR> & grid = block.getImplicitGrid();
+  const plint nX = block.getNx(), nY = block.getNy(), nZ = block.getNz();
+  const plint nodes = nX*nY*nZ;
+
+  std::vector<bool> fluid(nodes,false);
+  for (plint iX = 0 ; iX < nX ; iX++) {
+    for (plint iY = 0 ; iY < nY ; iY++) {
+      for (plint iZ = 0 ; iZ < nZ ; iZ++) {
+        const plint node = (iX*nY + iY)*nZ + iZ;
+        fluid[node] = (flags && flags->get(iX,iY,iZ) == 1) ||
+                      block.get(iX,iY,iZ).getDynamics().getId() != bbId;
+        if (fluid[node] && contained(iX,iY,iZ,bulk)) {
+          usage.fluidNodes++;
+        }
+      }
+    }
+  }
+
+  if (!grid.indirection) {
+    // Keep the fluid nodes and all nodes they exchange populations with
+    std::vector<bool> keep(fluid);
+    for (plint iX = 0 ; iX < nX ; iX++) {
+      for (plint iY = 0 ; iY < nY ; iY++) {
+        for (plint iZ = 0 ; iZ < nZ ; iZ++) {
+          if (!fluid[(iX*nY + iY)*nZ + iZ]) { continue; }
+          for (plint iPop = 1 ; iPop < D::q ; iPop++) {
+            const plint nextX = iX + D::c[iPop][0], nextY = iY + D::c[iPop][1], nextZ = iZ + D::c[iPop][2];
+            if (nextX >= 0 && nextX < nX && nextY >= 0 && nextY < nY && nextZ >= 0 && nextZ < nZ) {
+              keep[(nextX*nY + nextY)*nZ + nextZ] = true;
+            }
+          }
+        }
+      }
+    }
+    grid.makeIndirect(keep);
+  }
+  usage.nodes += nodes;
+  usage.storedCells += grid.numCells;
+}
+}
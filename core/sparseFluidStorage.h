@@ -0,0 +1,68 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef HEMO_SPARSE_FLUID_STORAGE_H
+#define HEMO_SPARSE_FLUID_STORAGE_H
+
+#include "constant_defaults.h"
+
+#include "multiBlock/multiBlockLattice3D.h"
+#include "multiBlock/multiDataField3D.h"
+
+namespace hemo {
+
+/**
+ * Indirectly addressed storage of the fluid lattice, enabled with
+ * parameters/sparseFluidStorage.
+ *
+ * A tortuous vessel leaves most nodes of an atomic block solid. compact() keeps
+ * the cells of the fluid nodes and of the solid (bounce back) nodes next to
+ * them, in their original order, in the storage of the block. All remaining
+ * nodes share a single cell with bounce back dynamics, owned by the block, so
+ * they stay solid for the fluid counts, the IBM kernels and a redistribution,
+ * and they never exchange populations with a fluid node. Every access of Palabos and HemoCell goes through
+ * BlockLattice3D::get(), which resolves the node through the index map of the
+ * block (ImplicitGrid3D in the Palabos patch), so the boundary conditions, the
+ * IBM kernels and the output keep working on (x,y,z).
+ *
+ * Dynamics must not be defined on the removed nodes afterwards, so compact
+ * after all walls, inlets and outlets are defined.
+ */
+class SparseFluidStorage {
+public:
+  /// Compact the local blocks of lattice, a node is fluid when its flag is 1 or
+  /// when it has other than bounce back dynamics. flagMatrix is the voxelized
+  /// domain of voxelizeDomain, on the block structure of the lattice
+  static void compact(plb::MultiBlockLattice3D<FLUID_T,DESCRIPTOR> & lattice, plb::MultiScalarField3D<int> & flagMatrix);
+  /// Compact the local blocks of lattice from the dynamics only, used after a redistribution
+  static void compact(plb::MultiBlockLattice3D<FLUID_T,DESCRIPTOR> & lattice);
+
+private:
+  struct Usage {
+    long nodes = 0, storedCells = 0, fluidNodes = 0;
+  };
+  static void compactBlock(plb::BlockLattice3D<FLUID_T,DESCRIPTOR> & block, plb::ScalarField3D<int> * flags, plb::Box3D bulk, Usage & usage);
+  static void compact(plb::MultiBlockLattice3D<FLUID_T,DESCRIPTOR> & lattice, plb::MultiScalarField3D<int> * flagMatrix);
+};
+}
+#endif
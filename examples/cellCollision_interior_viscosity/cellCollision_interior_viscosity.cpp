@@ -57,18 +57,18 @@ int main(int argc, char* argv[])
 
 	plint extendedEnvelopeWidth = 2;  // Because we might use ibmKernel with with 2.
 
-	hemocell.lattice = new MultiBlockLattice3D<double,DESCRIPTOR>(
+	hemocell.lattice = new MultiBlockLattice3D<FLUID_T,DESCRIPTOR>(
 			defaultMultiBlockPolicy3D().getMultiBlockManagement(nx, ny, nz, extendedEnvelopeWidth),
 			defaultMultiBlockPolicy3D().getBlockCommunicator(),
 			defaultMultiBlockPolicy3D().getCombinedStatistics(),
-			defaultMultiBlockPolicy3D().getMultiCellAccess<T, DESCRIPTOR>(),
-			new GuoExternalForceBGKdynamics<T, DESCRIPTOR>(1.0/param::tau));
+			defaultMultiBlockPolicy3D().getMultiCellAccess<FLUID_T, DESCRIPTOR>(),
+			new GuoExternalForceBGKdynamics<FLUID_T, DESCRIPTOR>(1.0/param::tau));
 
 	pcout << "(CellCollision) Re corresponds to u_max = " << (param::re * param::nu_p)/(hemocell.lattice->getBoundingBox().getNy()*param::dx) << " [m/s]" << endl;
 	// -------------------------- Define boundary conditions ---------------------
 
-	OnLatticeBoundaryCondition3D<double,DESCRIPTOR>* boundaryCondition
-			= createLocalBoundaryCondition3D<double,DESCRIPTOR>();
+	OnLatticeBoundaryCondition3D<FLUID_T,DESCRIPTOR>* boundaryCondition
+			= createLocalBoundaryCondition3D<FLUID_T,DESCRIPTOR>();
 
 	hemocell.lattice->toggleInternalStatistics(false);
 
@@ -77,7 +77,7 @@ int main (int argc, char * argv[]) {
   hemocell.preInlet->preInletFromSlice(Direction::Xpos,slice);
     
   hlog << "(Stl preinlet) (Fluid) Initializing Palabos Fluid Field" << endl;
-  hemocell.initializeLattice(voxelizedDomain->getMultiBlockManagement());
+  hemocell.initializeLattice(flagMatrix->getMultiBlockManagement());
  
     if (!hemocell.partOfpreInlet) {
       hemocell.lattice->periodicity().toggleAll(false);
@@ -149,10 +149,10 @@ int main (int argc, char * argv[]) {
       //outlet.y0 = 80;
       //outlet.y1 = 122;
 
-      OnLatticeBoundaryCondition3D<T,DESCRIPTOR>* boundary = new BoundaryConditionInstantiator3D 
-        < T, DESCRIPTOR, WrappedZouHeBoundaryManager3D<T,DESCRIPTOR> > ();
+      OnLatticeBoundaryCondition3D<FLUID_T,DESCRIPTOR>* boundary = new BoundaryConditionInstantiator3D 
+        < T, DESCRIPTOR, WrappedZouHeBoundaryManager3D<FLUID_T,DESCRIPTOR> > ();
       boundary->addPressureBoundary0N(outlet,*hemocell.lattice,boundary::density);
-      setBoundaryDensity(*hemocell.lattice,outlet, 1.0);
+      setBoundaryDensity(*hemocell.lattice,outlet, (FLUID_T)1.0);
     }
   
     //loading the cellfield
@@ -217,7 +217,7 @@ int main (int argc, char * argv[]) {
           //Set force as required after this function;
           //setExternalVector(*hemocell.lattice, hemocell.lattice->getBoundingBox(),
                     // DESCRIPTOR<T>::ExternalField::forceBeginsAt,
-                   //  hemo::Array<T, DESCRIPTOR<T>::d>(poiseuilleForce, 0.0, 0.0));
+                   //  hemo::Array<FLUID_T, DESCRIPTOR<FLUID_T>::d>(poiseuilleForce, 0.0, 0.0));
          // pcout << "Fluid force, Minimum: " << finfo.min << " Maximum: " << finfo.max << " Average: " << finfo.avg << endl;
           //ParticleStatistics pinfo = ParticleInfo::calculateVelocityStatistics(&hemocell);
           //pcout << "Particle velocity, Minimum: " << pinfo.min << " Maximum: " << pinfo.max << " Average: " << pinfo.avg << endl;
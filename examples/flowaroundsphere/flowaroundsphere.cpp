@@ -106,33 +106,33 @@ int main(int argc, char *argv[]) {
   plint extendedEnvelopeWidth = 2;  // Because we might use ibmKernel with with 2.
 
   pcout << "(Flowaroundsphere) (Fluid) Initializing Palabos Fluid Field" << endl;
-  hemocell.lattice = new MultiBlockLattice3D<double, DESCRIPTOR>(
+  hemocell.lattice = new MultiBlockLattice3D<FLUID_T, DESCRIPTOR>(
             defaultMultiBlockPolicy3D().getMultiBlockManagement(nx, ny, nz, extendedEnvelopeWidth),     
        //voxelizedDomain->getMultiBlockManagement(),
             defaultMultiBlockPolicy3D().getBlockCommunicator(),
             defaultMultiBlockPolicy3D().getCombinedStatistics(),
-            defaultMultiBlockPolicy3D().getMultiCellAccess<double, DESCRIPTOR>(),
-            new GuoExternalForceBGKdynamics<double, DESCRIPTOR>(1.0/param::tau));
+            defaultMultiBlockPolicy3D().getMultiCellAccess<FLUID_T, DESCRIPTOR>(),
+            new GuoExternalForceBGKdynamics<FLUID_T, DESCRIPTOR>(1.0/param::tau));
 
 //  pcout << "(PipeFlow) (Fluid) Setting up boundaries in Palabos Fluid Field" << endl; 
-//  defineDynamics(*hemocell.lattice, *flagMatrix, (*hemocell.lattice).getBoundingBox(), new BounceBack<T, DESCRIPTOR>(1.), 0);
+//  defineDynamics(*hemocell.lattice, *flagMatrix, (*hemocell.lattice).getBoundingBox(), new BounceBack<FLUID_T, DESCRIPTOR>(1.), 0);
 
 //--------------------------------- boundary conditions ---------------------------------------------------
-  OnLatticeBoundaryCondition3D<T,DESCRIPTOR>* boundaryCondition = createLocalBoundaryCondition3D<T,DESCRIPTOR>();
+  OnLatticeBoundaryCondition3D<FLUID_T,DESCRIPTOR>* boundaryCondition = createLocalBoundaryCondition3D<FLUID_T,DESCRIPTOR>();
 
   defineDynamics(*hemocell.lattice, (*hemocell.lattice).getBoundingBox(),
               new SphereShapeDomain3D<T>(sphere_x,sphere_y,sphere_z, sphere_diameter/2.0),
-              new BounceBack<T, DESCRIPTOR> ); //b
+              new BounceBack<FLUID_T, DESCRIPTOR> ); //b
 
   Box3D topChannel(0, 2*lengthChannel-1, 0, lengthChannel-1, lengthChannel-1, lengthChannel-1 );
   Box3D bottomChannel( 0, 2*lengthChannel-1, 0, lengthChannel-1, 0, 0);
 
-  defineDynamics(*hemocell.lattice, bottomChannel, new BounceBack<T, DESCRIPTOR> );
+  defineDynamics(*hemocell.lattice, bottomChannel, new BounceBack<FLUID_T, DESCRIPTOR> );
 
   boundaryCondition->setVelocityConditionOnBlockBoundaries (*hemocell.lattice, topChannel );
-  setBoundaryVelocity(*hemocell.lattice, topChannel, plb::Array<T,3>(0.75*velocity_max_lbm,0,0)); // #calculated form: vmax=shearrate*h/32 = 0.04375, v_topwall,p = 0.75*vmax, v_top_lbm=v_topwall*(dt/dx)
+  setBoundaryVelocity(*hemocell.lattice, topChannel, plb::Array<FLUID_T,3>(0.75*velocity_max_lbm,0,0)); // #calculated form: vmax=shearrate*h/32 = 0.04375, v_topwall,p = 0.75*vmax, v_top_lbm=v_topwall*(dt/dx)
 
-//  defineDynamics(*hemocell.lattice, topChannel, new BounceBack<T, DESCRIPTOR> );
+//  defineDynamics(*hemocell.lattice, topChannel, new BounceBack<FLUID_T, DESCRIPTOR> );
 
 // -----------------------------------
 
@@ -148,7 +148,7 @@ int main(int argc, char *argv[]) {
 //  double poiseuilleForce = 0.0; // 8 * param::nu_lbm * (param::u_lbm_max * 0.5) / rPipe / rPipe;
 //  setExternalVector(*hemocell.lattice, (*hemocell.lattice).getBoundingBox(),
 //                    DESCRIPTOR<double>::ExternalField::forceBeginsAt,
-//                    plb::Array<double, DESCRIPTOR<double>::d>(poiseuilleForce, 0.0, 0.0));
+//                    plb::Array<FLUID_T, DESCRIPTOR<FLUID_T>::d>(poiseuilleForce, 0.0, 0.0));
 
   hemocell.lattice->initialize();   
 
@@ -207,9 +207,9 @@ int main(int argc, char *argv[]) {
 //    //Set driving force as required after each iteration
 //    setExternalVector(*hemocell.lattice, hemocell.lattice->getBoundingBox(),
 //               DESCRIPTOR<T>::ExternalField::forceBeginsAt,
-//               plb::Array<T, DESCRIPTOR<T>::d>(poiseuilleForce, 0.0, 0.0));
+//               plb::Array<FLUID_T, DESCRIPTOR<FLUID_T>::d>(poiseuilleForce, 0.0, 0.0));
     
-    // Only enable if PARMETIS build is available
+    // Only enable when there are more atomic blocks than processes
     // if (hemocell.iter % tbalance == 0) {
     //   if(hemocell.calculateFractionalLoadImbalance() > 3) {
     //    // hemocell.doLoadBalance();
@@ -231,7 +231,7 @@ int main(int argc, char *argv[]) {
       //Set force as required after this function;
       // setExternalVector(*hemocell.lattice, hemocell.lattice->getBoundingBox(),
       //           DESCRIPTOR<T>::ExternalField::forceBeginsAt,
-      //           plb::Array<T, DESCRIPTOR<T>::d>(poiseuilleForce, 0.0, 0.0));
+      //           plb::Array<FLUID_T, DESCRIPTOR<FLUID_T>::d>(poiseuilleForce, 0.0, 0.0));
       // pcout << "Fluid force, Minimum: " << finfo.min << " Maximum: " << finfo.max << " Average: " << finfo.avg << endl;
       // ParticleStatistics pinfo = ParticleInfo::calculateVelocityStatistics(&hemocell);
       // pcout << "Particle velocity, Minimum: " << pinfo.min << " Maximum: " << pinfo.max << " Average: " << pinfo.avg << endl;
@@ -0,0 +1,68 @@
+#include "hemocell.h"
+#include "fusedFluidKernel.h"
+#include <chrono>
+
+// Fluid only benchmark: million lattice updates per second (MLUPS) of the
+// Palabos collideAndStream and of the fused kernel, for every instruction set
+// the processor supports, on a periodic box driven by a constant body force.
+
+double timeIterations(std::function<void()> step, unsigned int warmup, unsigned int iterations) {
+  for (unsigned int i = 0 ; i < warmup ; i++) {
+    step();
+  }
+  global::mpi().barrier();
+  std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+  for (unsigned int i = 0 ; i < iterations ; i++) {
+    step();
+  }
+  global::mpi().barrier();
+  return std::chrono::duration<double>(std::chrono::high_resolution_clock::now()-start).count();
+}
+
+int main(int argc, char * argv[]) {
+  if(argc < 2) {
+    cout << "Usage: " << argv[0] << " <configuration.xml>" << endl;
+    return -1;
+  }
+
+  HemoCell hemocell(argv[1],argc,argv);
+  Config * cfg = hemocell.cfg;
+
+  param::lbm_base_parameters(*cfg);
+  param::printParameters();
+
+  const plint n = (*cfg)["benchmark"]["boxSize"].read<plint>();
+  const unsigned int warmup = (*cfg)["benchmark"]["warmup"].read<unsigned int>();
+  const unsigned int iterations = (*cfg)["benchmark"]["iterations"].read<unsigned int>();
+
+  MultiBlockManagement3D management = defaultMultiBlockPolicy3D().getMultiBlockManagement(n, n, n, 1);
+  hemocell.initializeLattice(management);
+  hemocell.lattice->periodicity().toggleAll(true);
+  hemocell.lattice->toggleInternalStatistics(false);
+  hemocell.latticeEquilibrium(1.,plb::Array<double, 3>(0.,0.,0.));
+  hemocell.lattice->initialize();
+
+  // The force is never reset, so it drives every iteration
+  setExternalVector(*hemocell.lattice, hemocell.lattice->getBoundingBox(),
+              DESCRIPTOR<T>::ExternalField::forceBeginsAt,
+              plb::Array<FLUID_T, DESCRIPTOR<FLUID_T>::d>(1e-6, 0.0, 0.0));
+
+  const double updates = double(n*n*n)*iterations/1e6;
+  pcout << "(FluidBenchmark) " << n << "^3 periodic box, " << global::mpi().getSize() << " processes, " << iterations << " iterations per kernel" << endl;
+
+  double time = timeIterations([&]() { hemocell.lattice->collideAndStream(); }, warmup, iterations);
+  pcout << "(FluidBenchmark) Palabos collideAndStream: " << updates/time << " MLUPS" << endl;
+
+  FusedFluidKernel kernel(*hemocell.lattice);
+  for (FusedFluidKernel::Isa isa : {FusedFluidKernel::Isa::generic, FusedFluidKernel::Isa::avx2, FusedFluidKernel::Isa::avx512}) {
+    if (!FusedFluidKernel::isaSupported(isa)) {
+      pcout << "(FluidBenchmark) Fused kernel (" << FusedFluidKernel::isaName(isa) << "): not supported" << endl;
+      continue;
+    }
+    kernel.setIsa(isa);
+    time = timeIterations([&]() { kernel.collideAndStream(); }, warmup, iterations);
+    pcout << "(FluidBenchmark) Fused kernel (" << FusedFluidKernel::isaName(isa) << "): " << updates/time << " MLUPS" << endl;
+  }
+
+  return 0;
+}
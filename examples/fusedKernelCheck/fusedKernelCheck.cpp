@@ -0,0 +1,116 @@
+#include "hemocell.h"
+#include "fusedFluidKernel.h"
+
+// Compares the fused fluid kernel with Palabos collideAndStream on a channel
+// with bounce back walls, an obstacle, a region with another viscosity and a
+// non uniform force. Every instruction set the processor supports is checked,
+// the case fails when a population differs by more than <validation><tolerance>.
+
+// Largest difference of the populations of the bulk cells of two lattices with the same blocks
+T maxDifference(MultiBlockLattice3D<FLUID_T,DESCRIPTOR> & a, MultiBlockLattice3D<FLUID_T,DESCRIPTOR> & b) {
+  double difference = 0.;
+  for (plint bId : a.getLocalInfo().getBlocks()) {
+    BlockLattice3D<FLUID_T,DESCRIPTOR> & blockA = a.getComponent(bId);
+    BlockLattice3D<FLUID_T,DESCRIPTOR> & blockB = b.getComponent(bId);
+    const Dot3D & location = blockA.getLocation();
+    Box3D bulk;
+    a.getSparseBlockStructure().getBulk(bId, bulk);
+    for (plint x = bulk.x0 ; x <= bulk.x1 ; x++) {
+      for (plint y = bulk.y0 ; y <= bulk.y1 ; y++) {
+        for (plint z = bulk.z0 ; z <= bulk.z1 ; z++) {
+          Cell<FLUID_T,DESCRIPTOR> & cellA = blockA.get(x-location.x, y-location.y, z-location.z);
+          Cell<FLUID_T,DESCRIPTOR> & cellB = blockB.get(x-location.x, y-location.y, z-location.z);
+          for (plint iPop = 0 ; iPop < DESCRIPTOR<T>::q ; iPop++) {
+            difference = std::max(difference, std::fabs(double(cellA[iPop]) - double(cellB[iPop])));
+          }
+        }
+      }
+    }
+  }
+  MPI_Allreduce(MPI_IN_PLACE, &difference, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+  return difference;
+}
+
+int main(int argc, char * argv[]) {
+  if(argc < 2) {
+    cout << "Usage: " << argv[0] << " <configuration.xml>" << endl;
+    return -1;
+  }
+
+  HemoCell hemocell(argv[1],argc,argv);
+  Config * cfg = hemocell.cfg;
+
+  param::lbm_base_parameters(*cfg);
+  param::printParameters();
+
+  const plint nx = (*cfg)["channel"]["nx"].read<plint>();
+  const plint ny = (*cfg)["channel"]["ny"].read<plint>();
+  const plint nz = (*cfg)["channel"]["nz"].read<plint>();
+  const T force = (*cfg)["channel"]["force"].read<T>();
+  const unsigned int iterations = (*cfg)["sim"]["tmax"].read<unsigned int>();
+  const T tolerance = (*cfg)["validation"]["tolerance"].read<T>();
+  if (nx < 8 || ny < 8 || nz < 8) {
+    hlog << "(FusedKernelCheck) (Error) The channel must be at least 8 nodes in every direction" << endl;
+    return -1;
+  }
+
+  // Periodic in x and z, walls in y, a bounce back obstacle and a region with
+  // another relaxation time (as the interior of a cell) in the middle
+  MultiBlockManagement3D management = defaultMultiBlockPolicy3D().getMultiBlockManagement(nx, ny, nz, 1);
+  hemocell.initializeLattice(management);
+  MultiBlockLattice3D<FLUID_T,DESCRIPTOR> & lattice = *hemocell.lattice;
+  lattice.toggleInternalStatistics(false);
+  lattice.periodicity().toggle(0, true);
+  lattice.periodicity().toggle(2, true);
+  defineDynamics(lattice, Box3D(0,nx-1,0,0,0,nz-1), new BounceBack<FLUID_T,DESCRIPTOR>(1.));
+  defineDynamics(lattice, Box3D(0,nx-1,ny-1,ny-1,0,nz-1), new BounceBack<FLUID_T,DESCRIPTOR>(1.));
+  defineDynamics(lattice, Box3D(nx/4,nx/4+2,ny/2-1,ny/2+1,nz/2-1,nz/2+1), new BounceBack<FLUID_T,DESCRIPTOR>(1.));
+  defineDynamics(lattice, Box3D(nx/2,3*nx/4,ny/4,ny/2,nz/4,3*nz/4),
+                 new GuoExternalForceBGKdynamics<FLUID_T,DESCRIPTOR>(1./(5.*param::tau)));
+  hemocell.latticeEquilibrium(1.,plb::Array<double, 3>(0.,0.,0.));
+  initializeAtEquilibrium(lattice, Box3D(0,nx/2,1,ny/2,0,nz-1), FLUID_T(1.01), plb::Array<FLUID_T,3>(0.02,0.01,-0.005));
+  lattice.initialize();
+
+  // A different force in part of the channel, the force is never reset
+  setExternalVector(lattice, lattice.getBoundingBox(), DESCRIPTOR<T>::ExternalField::forceBeginsAt,
+              plb::Array<FLUID_T, DESCRIPTOR<FLUID_T>::d>(force, 0.0, 0.0));
+  setExternalVector(lattice, Box3D(0,nx-1,ny/3,2*ny/3,0,nz/2), DESCRIPTOR<T>::ExternalField::forceBeginsAt,
+              plb::Array<FLUID_T, DESCRIPTOR<FLUID_T>::d>(0.5*force, 0.3*force, -0.2*force));
+
+  // Copies of the initial state for the fused kernel, one per instruction set
+  std::vector<FusedFluidKernel::Isa> isas;
+  std::vector<std::unique_ptr<MultiBlockLattice3D<FLUID_T,DESCRIPTOR>>> fused;
+  for (FusedFluidKernel::Isa isa : {FusedFluidKernel::Isa::generic, FusedFluidKernel::Isa::avx2, FusedFluidKernel::Isa::avx512}) {
+    if (!FusedFluidKernel::isaSupported(isa)) {
+      hlog << "(FusedKernelCheck) " << FusedFluidKernel::isaName(isa) << " is not supported, skipped" << endl;
+      continue;
+    }
+    isas.push_back(isa);
+    fused.emplace_back(new MultiBlockLattice3D<FLUID_T,DESCRIPTOR>(lattice));
+    FusedFluidKernel::shareBackgroundDynamics(*fused.back());
+  }
+
+  for (unsigned int i = 0 ; i < iterations ; i++) {
+    lattice.collideAndStream();
+  }
+
+  int failed = 0;
+  for (unsigned int k = 0 ; k < isas.size() ; k++) {
+    FusedFluidKernel kernel(*fused[k]);
+    kernel.setIsa(isas[k]);
+    for (unsigned int i = 0 ; i < iterations ; i++) {
+      kernel.collideAndStream();
+    }
+    const T difference = maxDifference(lattice, *fused[k]);
+    hlog << "(FusedKernelCheck) " << FusedFluidKernel::isaName(isas[k]) << ": largest difference of the populations after "
+         << iterations << " iterations " << difference << endl;
+    if (difference > tolerance) {
+      hlog << "(FusedKernelCheck) (Error) The " << FusedFluidKernel::isaName(isas[k]) << " fused kernel differs from Palabos by more than the tolerance " << tolerance << endl;
+      failed = 1;
+    }
+  }
+  if (!failed) {
+    hlog << "(FusedKernelCheck) The fused kernel matches Palabos collideAndStream" << endl;
+  }
+  return failed;
+}
@@ -0,0 +1,182 @@
+#include "hemocell.h"
+#include "cellBVH.h"
+#include "mollerTrumbore.h"
+#include <chrono>
+#include <random>
+
+// Inner node benchmark: the lattice sites within an RBC mesh are found for a
+// number of random placements of the cell, with the full bounding box sweep of
+// CellBVH::findInnerNodes() for every instruction set the processor supports.
+// The reference tests every site of the bounding box against every triangle,
+// like the sweep did before the BVH, and must find exactly the same sites.
+// Afterwards every placement is moved a little and the moved cell is found
+// again, with the full sweep and with CellBVH::updateInnerNodes() from the
+// sites of the placement (parameters/incrementalInteriorNodes).
+
+typedef std::vector<std::set<hemo::Array<plint,3>>> InnerNodes;
+
+double timeSweep(std::function<void(unsigned int)> sweep, unsigned int placements) {
+  std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+  for (unsigned int p = 0 ; p < placements ; p++) {
+    sweep(p);
+  }
+  return std::chrono::duration<double>(std::chrono::high_resolution_clock::now()-start).count();
+}
+
+int main(int argc, char * argv[]) {
+  if(argc < 2) {
+    cout << "Usage: " << argv[0] << " <configuration.xml>" << endl;
+    return -1;
+  }
+
+  HemoCell hemocell(argv[1],argc,argv);
+  Config * cfg = hemocell.cfg;
+
+  param::lbm_base_parameters(*cfg);
+
+  const T radius = (*cfg)["benchmark"]["radius"].read<T>()/param::dx;
+  const plint minNumTriangles = (*cfg)["benchmark"]["minNumTriangles"].read<plint>();
+  const unsigned int placements = (*cfg)["benchmark"]["placements"].read<unsigned int>();
+  const T displacement = (*cfg)["benchmark"]["displacement"].read<T>();
+
+  TriangleBoundary3D<T> boundary = constructMeshElement(RBC_FROM_SPHERE, radius, minNumTriangles, param::dx, string(""), plb::Array<T,3>(0.,0.,0.));
+  TriangularSurfaceMesh<T> & mesh = boundary.getMesh();
+  vector<hemo::Array<plint,3>> triangles;
+  for (plint iTriangle = 0; iTriangle < mesh.getNumTriangles(); iTriangle++) {
+    triangles.push_back({mesh.getVertexId(iTriangle,0), mesh.getVertexId(iTriangle,1), mesh.getVertexId(iTriangle,2)});
+  }
+
+  // The first placement is centered on a lattice site without rotation, so lines
+  // along x run through vertices and edges of the symmetric mesh
+  const plint n = 2*plint(radius) + 8;
+  std::mt19937 random(1);
+  std::uniform_real_distribution<T> uniform(0.,1.);
+  vector<vector<hemo::Array<T,3>>> vertices(placements);
+  for (unsigned int p = 0 ; p < placements ; p++) {
+    hemo::Array<T,3> center = {T(n/2), T(n/2), T(n/2)};
+    T q[4] = {1., 0., 0., 0.};
+    if (p) {
+      for (int d = 0 ; d < 3 ; d++) { center[d] += uniform(random); }
+      std::normal_distribution<T> normal;
+      T length = 0.;
+      for (int i = 0 ; i < 4 ; i++) { q[i] = normal(random); length += q[i]*q[i]; }
+      for (int i = 0 ; i < 4 ; i++) { q[i] /= sqrt(length); }
+    }
+    const T R[3][3] = {{1-2*(q[2]*q[2]+q[3]*q[3]), 2*(q[1]*q[2]-q[0]*q[3]), 2*(q[1]*q[3]+q[0]*q[2])},
+                       {2*(q[1]*q[2]+q[0]*q[3]), 1-2*(q[1]*q[1]+q[3]*q[3]), 2*(q[2]*q[3]-q[0]*q[1])},
+                       {2*(q[1]*q[3]-q[0]*q[2]), 2*(q[2]*q[3]+q[0]*q[1]), 1-2*(q[1]*q[1]+q[2]*q[2])}};
+    for (plint v = 0 ; v < mesh.getNumVertices() ; v++) {
+      const hemo::Array<T,3> vertex(mesh.getVertex(v));
+      hemo::Array<T,3> position = center;
+      for (int i = 0 ; i < 3 ; i++) {
+        for (int j = 0 ; j < 3 ; j++) { position[i] += R[i][j]*vertex[j]; }
+      }
+      vertices[p].push_back(position);
+    }
+  }
+
+  BlockLattice3D<FLUID_T,DESCRIPTOR> fluid(n, n, n, new NoDynamics<FLUID_T,DESCRIPTOR>());
+  CellBVH bvh;
+  bvh.vertices = vertices[0];
+  bvh.build(triangles);
+
+  pcout << "(InteriorBenchmark) RBC with " << triangles.size() << " triangles, radius " << radius << " lattice units, " << placements << " placements" << endl;
+
+  // Reference: every site of the bounding box against every triangle
+  InnerNodes reference(placements);
+  double time = timeSweep([&](unsigned int p) {
+    bvh.vertices = vertices[p];
+    bvh.refit();
+    const hemo::Array<T,6> bbox = bvh.boundingBox();
+    TrianglePacket packet;
+    T xCross[TrianglePacket::width];
+    for (plint x = ceil(bbox[0]) ; x <= floor(bbox[1]) ; x++) {
+      for (plint y = ceil(bbox[2]) ; y <= floor(bbox[3]) ; y++) {
+        for (plint z = ceil(bbox[4]) ; z <= floor(bbox[5]) ; z++) {
+          int crossedCounter = 0;
+          for (unsigned int t = 0 ; t < triangles.size() ; t++) {
+            packet.add(t, vertices[p][triangles[t][0]], vertices[p][triangles[t][1]], vertices[p][triangles[t][2]],
+                       triangles[t][0], triangles[t][1], triangles[t][2]);
+            if (packet.full() || t == triangles.size()-1) {
+              const unsigned int crossed = packet.cross(y, z, xCross);
+              for (int l = 0 ; l < packet.size ; l++) {
+                crossedCounter += (crossed >> l & 1) && xCross[l] < x;
+              }
+              packet.clear();
+            }
+          }
+          if (crossedCounter%2) {
+            reference[p].insert({x, y, z});
+          }
+        }
+      }
+    }
+  }, placements);
+  pcout << "(InteriorBenchmark) Every site against every triangle: " << 1e3*time/placements << " ms per cell" << endl;
+
+  unsigned long innerNodes = 0;
+  for (const auto & nodes : reference) { innerNodes += nodes.size(); }
+  pcout << "(InteriorBenchmark) " << double(innerNodes)/placements << " inner nodes per cell, " << reference[0].size() << " in the lattice aligned placement" << endl;
+
+  for (TrianglePacket::Isa isa : {TrianglePacket::Isa::generic, TrianglePacket::Isa::avx2, TrianglePacket::Isa::avx512}) {
+    if (!TrianglePacket::isaSupported(isa)) {
+      pcout << "(InteriorBenchmark) BVH sweep (" << TrianglePacket::isaName(isa) << "): not supported" << endl;
+      continue;
+    }
+    TrianglePacket::setIsa(isa);
+    InnerNodes found(placements);
+    time = timeSweep([&](unsigned int p) {
+      bvh.vertices = vertices[p];
+      bvh.refit();
+      bvh.findInnerNodes(&fluid, found[p]);
+    }, placements);
+    unsigned int mismatches = 0;
+    for (unsigned int p = 0 ; p < placements ; p++) {
+      mismatches += found[p] != reference[p];
+    }
+    pcout << "(InteriorBenchmark) BVH sweep (" << TrianglePacket::isaName(isa) << "): " << 1e3*time/placements << " ms per cell, "
+          << mismatches << " placements differ from the reference" << endl;
+  }
+
+  // Every placement moved and deformed by at most displacement: half of it as
+  // a shift of the whole cell, the rest per vertex
+  vector<vector<hemo::Array<T,3>>> moved(placements);
+  vector<T> maxDisplacement(placements, 0.);
+  for (unsigned int p = 0 ; p < placements ; p++) {
+    std::normal_distribution<T> normal;
+    hemo::Array<T,3> shift = {normal(random), normal(random), normal(random)};
+    shift *= 0.5*displacement/computeLength(shift);
+    for (const hemo::Array<T,3> & vertex : vertices[p]) {
+      hemo::Array<T,3> offset = shift;
+      for (int d = 0 ; d < 3 ; d++) { offset[d] += (2*uniform(random)-1)*0.5*displacement/sqrt(3.); }
+      moved[p].push_back(vertex + offset);
+      maxDisplacement[p] = std::max(maxDisplacement[p], computeLength(offset));
+    }
+  }
+  InnerNodes previous(placements), full(placements), incremental(placements);
+  for (unsigned int p = 0 ; p < placements ; p++) {
+    bvh.vertices = vertices[p];
+    bvh.refit();
+    bvh.findInnerNodes(&fluid, previous[p]);
+  }
+  const double fullTime = timeSweep([&](unsigned int p) {
+    bvh.vertices = moved[p];
+    bvh.refit();
+    bvh.findInnerNodes(&fluid, full[p]);
+  }, placements);
+  const double incrementalTime = timeSweep([&](unsigned int p) {
+    bvh.vertices = moved[p];
+    bvh.refit();
+    incremental[p] = previous[p];
+    bvh.updateInnerNodes(&fluid, vertices[p], maxDisplacement[p], incremental[p]);
+  }, placements);
+  unsigned int mismatches = 0;
+  for (unsigned int p = 0 ; p < placements ; p++) {
+    mismatches += incremental[p] != full[p];
+  }
+  pcout << "(InteriorBenchmark) Moved by at most " << displacement << " lattice units: full sweep " << 1e3*fullTime/placements
+        << " ms per cell, incremental " << 1e3*incrementalTime/placements << " ms per cell, "
+        << mismatches << " placements differ from the full sweep" << endl;
+
+  return 0;
+}
@@ -0,0 +1,107 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "hemocell.h"
+#include "leesEdwardsBC.h"
+
+// Fully periodic box sheared by a Lees-Edwards boundary on the planes normal
+// to <shear><normal>, along <shear><flow>. Starting from rest, the velocity
+// along flow, averaged over every plane normal to the shear plane, must reach
+// the linear profile between the plane velocities. The case fails when the
+// relative (L2) error is above <validation><tolerance>. Run it on at least two
+// processes, so the planes are exchanged between processes.
+
+int main(int argc, char * argv[]) {
+  if(argc < 2) {
+    cout << "Usage: " << argv[0] << " <configuration.xml>" << endl;
+    return -1;
+  }
+
+  HemoCell hemocell(argv[1],argc,argv);
+  Config * cfg = hemocell.cfg;
+
+  const plint n[3] = {(*cfg)["box"]["nx"].read<plint>(), (*cfg)["box"]["ny"].read<plint>(), (*cfg)["box"]["nz"].read<plint>()};
+  const unsigned int normal = (*cfg)["shear"]["normal"].read<unsigned int>();
+  const unsigned int flow = (*cfg)["shear"]["flow"].read<unsigned int>();
+  const unsigned int tmax = (*cfg)["sim"]["tmax"].read<unsigned int>();
+  const unsigned int tmeas = (*cfg)["sim"]["tmeas"].read<unsigned int>();
+  const T tolerance = (*cfg)["validation"]["tolerance"].read<T>();
+  if (global::mpi().getSize() < 2) {
+    hlog << "(LeesEdwardsShear) (Error) Run this case on at least 2 processes" << endl;
+    return -1;
+  }
+  if (normal > 2) {
+    hlog << "(LeesEdwardsShear) (Error) The shear plane normal must be 0, 1 or 2" << endl;
+    return -1;
+  }
+
+  param::lbm_LE_parameters(*cfg, n[normal]);
+  param::printParameters();
+
+  MultiBlockManagement3D management = defaultMultiBlockPolicy3D().getMultiBlockManagement(n[0], n[1], n[2], 2);
+  hemocell.initializeLattice(management);
+  hemocell.lattice->toggleInternalStatistics(false);
+  // The top plane moves n-1 times the shear rate faster than the bottom one,
+  // its displacement grows by that every time step
+  hemocell.leesEdwards = new LeesEdwardsBC(hemocell, param::shearrate_lbm, n[normal]-1, normal, flow);
+  hemocell.latticeEquilibrium(1.,plb::Array<double, 3>(0.,0.,0.));
+  hemocell.lattice->initialize();
+
+  hemocell.initializeCellfield();
+  hemocell.loadParticles();
+
+  // The bottom plane moves with +vHalf and the top plane with -vHalf
+  const T vHalf = (n[normal]-1)*param::shearrate_lbm*0.5;
+  auto validate = [&]() {
+    std::unique_ptr<MultiScalarField3D<FLUID_T>> velocity(computeVelocityComponent(*hemocell.lattice, hemocell.lattice->getBoundingBox(), flow));
+    T errorSqr = 0., normSqr = 0.;
+    for (plint c = 0 ; c < n[normal] ; c++) {
+      plint lower[3] = {0, 0, 0}, upper[3] = {n[0]-1, n[1]-1, n[2]-1};
+      lower[normal] = upper[normal] = c;
+      const T u = computeAverage(*velocity, Box3D(lower[0],upper[0],lower[1],upper[1],lower[2],upper[2]));
+      const T analytic = vHalf - param::shearrate_lbm*c;
+      errorSqr += (u-analytic)*(u-analytic);
+      normSqr += analytic*analytic;
+    }
+    return sqrt(errorSqr/normSqr);
+  };
+
+  hlog << "(LeesEdwardsShear) Box " << n[0] << "x" << n[1] << "x" << n[2] << " on " << global::mpi().getSize() << " processes, shear rate "
+       << param::shearrate_lbm << " (lbm units)" << endl;
+
+  while (hemocell.iter < tmax) {
+    hemocell.iterate();
+    if (hemocell.iter % tmeas == 0) {
+      hlog << "(LeesEdwardsShear) @ " << hemocell.iter << " displacement " << hemocell.leesEdwards->getDisplacement()
+           << ", relative L2 error of the velocity profile: " << validate() << endl;
+    }
+  }
+
+  const T error = validate();
+  if (error > tolerance) {
+    hlog << "(LeesEdwardsShear) (Error) The relative L2 error of the velocity profile, " << error << ", is above the tolerance " << tolerance << endl;
+    return 1;
+  }
+  hlog << "(LeesEdwardsShear) The velocity profile is linear between the sheared planes, relative L2 error " << error << endl;
+  return 0;
+}
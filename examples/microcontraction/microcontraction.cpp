@@ -185,29 +185,29 @@ int main(int argc, char *argv[]) {
 // ---------------------------------------------------------------------------------------------
   
   pcout << "(PipeFlow) (Fluid) Initializing Palabos Fluid Field" << endl;
-  hemocell.lattice = new MultiBlockLattice3D<double, DESCRIPTOR>(
+  hemocell.lattice = new MultiBlockLattice3D<FLUID_T, DESCRIPTOR>(
             defaultMultiBlockPolicy3D().getMultiBlockManagement(nx, ny, nz, extendedEnvelopeWidth),  //voxelizedDomain->getMultiBlockManagement(),
             defaultMultiBlockPolicy3D().getBlockCommunicator(),
             defaultMultiBlockPolicy3D().getCombinedStatistics(),
-            defaultMultiBlockPolicy3D().getMultiCellAccess<double, DESCRIPTOR>(),
-            new GuoExternalForceBGKdynamics<double, DESCRIPTOR>(1.0/param::tau));
+            defaultMultiBlockPolicy3D().getMultiCellAccess<FLUID_T, DESCRIPTOR>(),
+            new GuoExternalForceBGKdynamics<FLUID_T, DESCRIPTOR>(1.0/param::tau));
 
  // pcout << "(PipeFlow) (Fluid) Setting up boundaries in Palabos Fluid Field" << endl; 
- // defineDynamics(*hemocell.lattice, *flagMatrix, (*hemocell.lattice).getBoundingBox(), new BounceBack<T, DESCRIPTOR>(1.), 0);
+ // defineDynamics(*hemocell.lattice, *flagMatrix, (*hemocell.lattice).getBoundingBox(), new BounceBack<FLUID_T, DESCRIPTOR>(1.), 0);
 
   defineDynamics(*hemocell.lattice, (*hemocell.lattice).getBoundingBox(),
                 new StenosisShapeDomain3D<T>(xbottomL, xbottomR, xtopL, xtopR, xcircL, xcircR, ycirc, ybottom, ytop, radiusCyl, a, bL, bR, y),
-                new BounceBack<T, DESCRIPTOR> );
+                new BounceBack<FLUID_T, DESCRIPTOR> );
 
   Box3D topChannel(0, nx-1, 0, ny-1, nz-1, nz-1);
   Box3D bottomChannel( 0, nx-1, 0, ny-1, 0, 0);
   Box3D backChannel( 0, nx-1, ny-1, ny-1, 0, nz-1);
   Box3D frontChannel( 0, nx-1, 0, 0, 0, nz-1);
 
-  defineDynamics(*hemocell.lattice, topChannel, new BounceBack<T, DESCRIPTOR> );
-  defineDynamics(*hemocell.lattice, bottomChannel, new BounceBack<T, DESCRIPTOR> );
-  defineDynamics(*hemocell.lattice, backChannel, new BounceBack<T, DESCRIPTOR> );
-  defineDynamics(*hemocell.lattice, frontChannel, new BounceBack<T, DESCRIPTOR> );
+  defineDynamics(*hemocell.lattice, topChannel, new BounceBack<FLUID_T, DESCRIPTOR> );
+  defineDynamics(*hemocell.lattice, bottomChannel, new BounceBack<FLUID_T, DESCRIPTOR> );
+  defineDynamics(*hemocell.lattice, backChannel, new BounceBack<FLUID_T, DESCRIPTOR> );
+  defineDynamics(*hemocell.lattice, frontChannel, new BounceBack<FLUID_T, DESCRIPTOR> );
 
   hemocell.lattice->toggleInternalStatistics(false);
   hemocell.lattice->periodicity().toggleAll(false);
@@ -226,7 +226,7 @@ int main(int argc, char *argv[]) {
   double poiseuilleForce = dpdz_lbm; //u_max_lbm * 8 * param::nu_lbm / (lengthChannel*heightChannel ); //8 * param::nu_lbm * (param::u_lbm_max * 0.5) / rPipe / rPipe;
   setExternalVector(*hemocell.lattice, (*hemocell.lattice).getBoundingBox(),
                     DESCRIPTOR<double>::ExternalField::forceBeginsAt,
-                    plb::Array<double, DESCRIPTOR<double>::d>(poiseuilleForce, 0.0, 0.0));
+                    plb::Array<FLUID_T, DESCRIPTOR<FLUID_T>::d>(poiseuilleForce, 0.0, 0.0));
 
   pcout << "poiseuilleForce = " << poiseuilleForce << endl;
 
@@ -284,9 +284,9 @@ int main(int argc, char *argv[]) {
     //Set driving force as required after each iteration
     setExternalVector(*hemocell.lattice, hemocell.lattice->getBoundingBox(),
                 DESCRIPTOR<T>::ExternalField::forceBeginsAt,
-                plb::Array<T, DESCRIPTOR<T>::d>(poiseuilleForce, 0.0, 0.0));
+                plb::Array<FLUID_T, DESCRIPTOR<FLUID_T>::d>(poiseuilleForce, 0.0, 0.0));
     
-    // Only enable if PARMETIS build is available
+    // Only enable when there are more atomic blocks than processes
     // if (hemocell.iter % tbalance == 0) {
     //   if(hemocell.calculateFractionalLoadImbalance() > 3) {
     //    // hemocell.doLoadBalance();
@@ -308,7 +308,7 @@ int main(int argc, char *argv[]) {
       //Set force as required after this function;
       // setExternalVector(*hemocell.lattice, hemocell.lattice->getBoundingBox(),
       //           DESCRIPTOR<T>::ExternalField::forceBeginsAt,
-      //           plb::Array<T, DESCRIPTOR<T>::d>(poiseuilleForce, 0.0, 0.0));
+      //           plb::Array<FLUID_T, DESCRIPTOR<FLUID_T>::d>(poiseuilleForce, 0.0, 0.0));
       // pcout << "Fluid force, Minimum: " << finfo.min << " Maximum: " << finfo.max << " Average: " << finfo.avg << endl;
       // ParticleStatistics pinfo = ParticleInfo::calculateVelocityStatistics(&hemocell);
       // pcout << "Particle velocity, Minimum: " << pinfo.min << " Maximum: " << pinfo.max << " Average: " << pinfo.avg << endl;
@@ -53,14 +53,14 @@ int main(int argc, char *argv[]) {
   param::lbm_pipe_parameters((*cfg),flagMatrix.get());
   param::printParameters();
   
-  hemocell.lattice = new MultiBlockLattice3D<T, DESCRIPTOR>(
-            voxelizedDomain.get()->getMultiBlockManagement(),
+  hemocell.lattice = new MultiBlockLattice3D<FLUID_T, DESCRIPTOR>(
+            flagMatrix->getMultiBlockManagement(),
             defaultMultiBlockPolicy3D().getBlockCommunicator(),
             defaultMultiBlockPolicy3D().getCombinedStatistics(),
-            defaultMultiBlockPolicy3D().getMultiCellAccess<T, DESCRIPTOR>(),
-            new GuoExternalForceBGKdynamics<T, DESCRIPTOR>(1.0/param::tau));
+            defaultMultiBlockPolicy3D().getMultiCellAccess<FLUID_T, DESCRIPTOR>(),
+            new GuoExternalForceBGKdynamics<FLUID_T, DESCRIPTOR>(1.0/param::tau));
 
-  defineDynamics(*hemocell.lattice, *flagMatrix.get(), (*hemocell.lattice).getBoundingBox(), new BounceBack<T, DESCRIPTOR>(1.), 0);
+  defineDynamics(*hemocell.lattice, *flagMatrix.get(), (*hemocell.lattice).getBoundingBox(), new BounceBack<FLUID_T, DESCRIPTOR>(1.), 0);
 
   hemocell.lattice->toggleInternalStatistics(false);
   hemocell.lattice->periodicity().toggleAll(false);
@@ -70,7 +70,7 @@ int main(int argc, char *argv[]) {
   T poiseuilleForce =  8 * param::nu_lbm * (param::u_lbm_max * 0.5) / param::pipe_radius / param::pipe_radius;
   setExternalVector(*hemocell.lattice, (*hemocell.lattice).getBoundingBox(),
                     DESCRIPTOR<T>::ExternalField::forceBeginsAt,
-                    plb::Array<T, DESCRIPTOR<T>::d>(poiseuilleForce, 0.0, 0.0));
+                    plb::Array<FLUID_T, DESCRIPTOR<FLUID_T>::d>(poiseuilleForce, 0.0, 0.0));
 
   hemocell.lattice->initialize();   
 
@@ -128,7 +128,7 @@ int main(int argc, char *argv[]) {
     //Set driving force as required after each iteration
     setExternalVector(*hemocell.lattice, hemocell.lattice->getBoundingBox(),
                 DESCRIPTOR<T>::ExternalField::forceBeginsAt,
-                plb::Array<T, DESCRIPTOR<T>::d>(poiseuilleForce, 0.0, 0.0));
+                plb::Array<FLUID_T, DESCRIPTOR<FLUID_T>::d>(poiseuilleForce, 0.0, 0.0));
     
     if (hemocell.iter % tmeas == 0) {
         hlog << "(main) Stats. @ " <<  hemocell.iter << " (" << hemocell.iter * param::dt << " s):" << endl;
@@ -145,7 +145,7 @@ endl;
         //Set force as required after this function;
         // setExternalVector(*hemocell.lattice, hemocell.lattice->getBoundingBox(),
         //           DESCRIPTOR<T>::ExternalField::forceBeginsAt,
-        //           hemo::Array<T, DESCRIPTOR<T>::d>(poiseuilleForce, 0.0, 0.0));
+        //           hemo::Array<FLUID_T, DESCRIPTOR<FLUID_T>::d>(poiseuilleForce, 0.0, 0.0));
         // pcout << "Fluid force, Minimum: " << finfo.min << " Maximum: " << finfo.max << " Average: " << finfo.avg << endl;
         // ParticleStatistics pinfo = ParticleInfo::calculateVelocityStatistics(&hemocell);
         // pcout << "Particle velocity, Minimum: " << pinfo.min << " Maximum: " << pinfo.max << " Average: " << pinfo.avg << endl;
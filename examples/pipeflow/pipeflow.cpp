@@ -28,6 +28,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "fluidInfo.h"
 #include "particleInfo.h"
 #include "writeCellInfoCSV.h"
+#include "stokesInitializer.h"
 #include <fenv.h>
 
 int main(int argc, char *argv[]) {
@@ -54,14 +55,14 @@ int main(int argc, char *argv[]) {
   param::lbm_pipe_parameters((*cfg),flagMatrix.get());
   param::printParameters();
   
-  hemocell.lattice = new MultiBlockLattice3D<T, DESCRIPTOR>(
-            voxelizedDomain.get()->getMultiBlockManagement(),
+  hemocell.lattice = new MultiBlockLattice3D<FLUID_T, DESCRIPTOR>(
+            flagMatrix->getMultiBlockManagement(),
             defaultMultiBlockPolicy3D().getBlockCommunicator(),
             defaultMultiBlockPolicy3D().getCombinedStatistics(),
-            defaultMultiBlockPolicy3D().getMultiCellAccess<T, DESCRIPTOR>(),
-            new GuoExternalForceBGKdynamics<T, DESCRIPTOR>(1.0/param::tau));
+            defaultMultiBlockPolicy3D().getMultiCellAccess<FLUID_T, DESCRIPTOR>(),
+            new GuoExternalForceBGKdynamics<FLUID_T, DESCRIPTOR>(1.0/param::tau));
 
-  defineDynamics(*hemocell.lattice, *flagMatrix.get(), (*hemocell.lattice).getBoundingBox(), new BounceBack<T, DESCRIPTOR>(1.), 0);
+  defineDynamics(*hemocell.lattice, *flagMatrix.get(), (*hemocell.lattice).getBoundingBox(), new BounceBack<FLUID_T, DESCRIPTOR>(1.), 0);
 
   hemocell.lattice->toggleInternalStatistics(false);
   hemocell.lattice->periodicity().toggleAll(false);
@@ -71,6 +72,7 @@ int main(int argc, char *argv[]) {
   T poiseuilleForce =  8 * param::nu_lbm * (param::u_lbm_max * 0.5) / param::pipe_radius / param::pipe_radius;
   
   hemocell.lattice->initialize();   
+  hemocell.compactFluidStorage(*flagMatrix.get());
 
   //Adding all the cells
   hemocell.initializeCellfield();
@@ -101,8 +103,14 @@ int main(int argc, char *argv[]) {
   //hemocell.enableBoundaryParticles((*cfg)["domain"]["kRep"].read<T>(), (*cfg)["domain"]["BRepCutoff"].read<T>(),(*cfg)["ibm"]["stepMaterialEvery"].read<int>());
   
   //loading the cellfield
+  // A checkpoint at another resolution brings a developed flow with it, no initialization or warm-up is needed
+  const bool warmStart = !hemo::global.coarseCheckpoint.empty();
   if (not cfg->checkpointed) {
-    hemocell.loadParticles();
+    if (warmStart) {
+      hemocell.loadCoarseCheckPoint(hemo::global.coarseCheckpoint);
+    } else {
+      hemocell.loadParticles();
+    }
     hemocell.writeOutput();
   } else {
     hemocell.loadCheckPoint();
@@ -112,12 +120,24 @@ int main(int argc, char *argv[]) {
   //hemocell.doRestructure(false); // cause errors
   
   if (hemocell.iter == 0) {
-    hlog << "(PipeFlow) fresh start: warming up cell-free fluid domain for "  << (*cfg)["parameters"]["warmup"].read<plint>() << " iterations..." << endl;
 	setExternalVector(*hemocell.lattice, (*hemocell.lattice).getBoundingBox(),
                     DESCRIPTOR<T>::ExternalField::forceBeginsAt,
-                    plb::Array<T, DESCRIPTOR<T>::d>(poiseuilleForce, 0.0, 0.0));
-    for (plint itrt = 0; itrt < (*cfg)["parameters"]["warmup"].read<plint>(); ++itrt) { 
-      hemocell.lattice->collideAndStream(); 
+                    plb::Array<FLUID_T, DESCRIPTOR<FLUID_T>::d>(poiseuilleForce, 0.0, 0.0));
+    // Start from the Stokes flow instead of a fluid at rest, the residual tells whether the warm-up is still needed
+    plint warmupDone = 0;
+    if (hemo::global.stokesInitialization && !warmStart) {
+      StokesInitializer stokes(hemocell, hemo::global.stokesInitialization);
+      stokes.initialize({poiseuilleForce, 0.0, 0.0});
+      // The residual is measured by running the fluid, these iterations count towards the warm-up
+      const unsigned int residualWindow = 100;
+      stokes.residual({poiseuilleForce, 0.0, 0.0}, residualWindow);
+      warmupDone = residualWindow;
+    }
+    if (!warmStart) {
+      hlog << "(PipeFlow) fresh start: warming up cell-free fluid domain for "  << (*cfg)["parameters"]["warmup"].read<plint>() << " iterations..." << endl;
+      for (plint itrt = warmupDone; itrt < (*cfg)["parameters"]["warmup"].read<plint>(); ++itrt) { 
+        hemocell.lattice->collideAndStream(); 
+      }
     }
   }
 
@@ -126,6 +146,13 @@ int main(int argc, char *argv[]) {
   unsigned int tcheckpoint = (*cfg)["sim"]["tcheckpoint"].read<unsigned int>();
   unsigned int tcsv = (*cfg)["sim"]["tcsv"].read<unsigned int>();
 
+  // Pick the fastest atomic block size when parameters/tuneBlockSizes is given
+  hemocell.tuneDecomposition([&]() {
+    setExternalVector(*hemocell.lattice, hemocell.lattice->getBoundingBox(),
+                DESCRIPTOR<T>::ExternalField::forceBeginsAt,
+                plb::Array<FLUID_T, DESCRIPTOR<FLUID_T>::d>(poiseuilleForce, 0.0, 0.0));
+  });
+
   hlog << "(PipeFlow) Starting simulation..." << endl;
 
   while (hemocell.iter < tmax ) {
@@ -134,7 +161,7 @@ int main(int argc, char *argv[]) {
     //Set driving force as required after each iteration
     setExternalVector(*hemocell.lattice, hemocell.lattice->getBoundingBox(),
                 DESCRIPTOR<T>::ExternalField::forceBeginsAt,
-                plb::Array<T, DESCRIPTOR<T>::d>(poiseuilleForce, 0.0, 0.0));
+                plb::Array<FLUID_T, DESCRIPTOR<FLUID_T>::d>(poiseuilleForce, 0.0, 0.0));
 
     if (hemocell.iter % tmeas == 0) {
         hlog << "(main) Stats. @ " <<  hemocell.iter << " (" << hemocell.iter * param::dt << " s):" << endl;
@@ -151,7 +178,7 @@ int main(int argc, char *argv[]) {
         //Set force as required after this function;
         // setExternalVector(*hemocell.lattice, hemocell.lattice->getBoundingBox(),
         //           DESCRIPTOR<T>::ExternalField::forceBeginsAt,
-        //           hemo::Array<T, DESCRIPTOR<T>::d>(poiseuilleForce, 0.0, 0.0));
+        //           hemo::Array<FLUID_T, DESCRIPTOR<FLUID_T>::d>(poiseuilleForce, 0.0, 0.0));
         // pcout << "Fluid force, Minimum: " << finfo.min << " Maximum: " << finfo.max << " Average: " << finfo.avg << endl;
         // ParticleStatistics pinfo = ParticleInfo::calculateVelocityStatistics(&hemocell);
         // pcout << "Particle velocity, Minimum: " << pinfo.min << " Maximum: " << pinfo.max << " Average: " << pinfo.avg << endl;
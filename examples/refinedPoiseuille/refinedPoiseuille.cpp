@@ -0,0 +1,130 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "hemocell.h"
+#include "gridRefinement.h"
+
+// Plane Poiseuille flow through a two level grid: a fine patch in the middle of
+// a channel, periodic in x and z, with walls in y. The velocity across the
+// fine patch is compared with the analytic profile, the case fails when the
+// relative (L2) error is above <validation><tolerance>.
+
+int main(int argc, char * argv[]) {
+  if(argc < 2) {
+    cout << "Usage: " << argv[0] << " <configuration.xml>" << endl;
+    return -1;
+  }
+
+  HemoCell hemocell(argv[1],argc,argv);
+  Config * cfg = hemocell.cfg;
+
+  param::lbm_base_parameters(*cfg);
+  param::printParameters();
+
+  const plint nx = (*cfg)["channel"]["nx"].read<plint>();
+  const plint ny = (*cfg)["channel"]["ny"].read<plint>();
+  const plint nz = (*cfg)["channel"]["nz"].read<plint>();
+  const T uMax = (*cfg)["channel"]["uMax"].read<T>();
+  const unsigned int tmax = (*cfg)["sim"]["tmax"].read<unsigned int>();
+  const unsigned int tmeas = (*cfg)["sim"]["tmeas"].read<unsigned int>();
+  const T tolerance = (*cfg)["validation"]["tolerance"].read<T>();
+
+  // Walls on coarse nodes y = 0 and y = ny-1, the fine patch covers the middle
+  // half of the channel in x and y and three coarse nodes in z
+  const Dot3D origin(nx/4, ny/4, nz/2-1);
+  const plint nxFine = 2*(nx/2)+1, nyFine = 2*(ny-1-2*(ny/4))+1, nzFine = 5;
+  if (origin.y < 2 || nz < 4) {
+    hlog << "(RefinedPoiseuille) (Error) The channel must be at least 8 coarse nodes high and 4 wide" << endl;
+    return -1;
+  }
+
+  // Lattice units of the fine lattice: the walls (halfway bounce back) lie at
+  // coarse y = 0.5 and y = ny-1.5
+  const T width = 2.*(ny-2);
+  const T force = 8.*param::nu_lbm*uMax/(width*width);
+
+  MultiBlockManagement3D management = defaultMultiBlockPolicy3D().getMultiBlockManagement(nxFine, nyFine, nzFine, 1);
+  hemocell.initializeLattice(management);
+  hemocell.lattice->toggleInternalStatistics(false);
+  hemocell.lattice->periodicity().toggleAll(false);
+  hemocell.latticeEquilibrium(1.,plb::Array<double, 3>(0.,0.,0.));
+  hemocell.lattice->initialize();
+
+  MultiBlockLattice3D<FLUID_T,DESCRIPTOR> coarse(nx, ny, nz,
+            new GuoExternalForceBGKdynamics<FLUID_T,DESCRIPTOR>(1./GridRefinement::coarseTau()));
+  coarse.toggleInternalStatistics(false);
+  coarse.periodicity().toggle(0, true);
+  coarse.periodicity().toggle(2, true);
+  defineDynamics(coarse, Box3D(0,nx-1,0,0,0,nz-1), new BounceBack<FLUID_T,DESCRIPTOR>(1.));
+  defineDynamics(coarse, Box3D(0,nx-1,ny-1,ny-1,0,nz-1), new BounceBack<FLUID_T,DESCRIPTOR>(1.));
+  initializeAtEquilibrium(coarse, coarse.getBoundingBox(), FLUID_T(1.), plb::Array<FLUID_T,3>(0.,0.,0.));
+  coarse.initialize();
+  // The coarse lattice is not reset by HemoCell, so its force is set once
+  setExternalVector(coarse, coarse.getBoundingBox(),
+              DESCRIPTOR<T>::ExternalField::forceBeginsAt,
+              plb::Array<FLUID_T, DESCRIPTOR<FLUID_T>::d>(GridRefinement::coarseForce(force), 0.0, 0.0));
+
+  hemocell.initializeCellfield();
+  hemocell.gridRefinement = new GridRefinement(hemocell, coarse, origin);
+  hemocell.loadParticles();
+
+  setExternalVector(*hemocell.lattice, hemocell.lattice->getBoundingBox(),
+              DESCRIPTOR<T>::ExternalField::forceBeginsAt,
+              plb::Array<FLUID_T, DESCRIPTOR<FLUID_T>::d>(force, 0.0, 0.0));
+
+  // Streamwise velocity on the middle line of the fine patch against the
+  // analytic profile, fine node y lies at coarse y = origin.y + y/2
+  auto validate = [&]() {
+    std::unique_ptr<MultiScalarField3D<FLUID_T>> velocity(computeVelocityComponent(*hemocell.lattice, hemocell.lattice->getBoundingBox(), 0));
+    T errorSqr = 0., normSqr = 0.;
+    for (plint y = 0 ; y < nyFine ; y++) {
+      const plint x = nxFine/2, z = nzFine/2;
+      const T u = computeAverage(*velocity, Box3D(x,x,y,y,z,z));
+      const T distance = 2.*(origin.y + 0.5*y - 0.5);
+      const T analytic = force/(2.*param::nu_lbm)*distance*(width-distance);
+      errorSqr += (u-analytic)*(u-analytic);
+      normSqr += analytic*analytic;
+    }
+    return sqrt(errorSqr/normSqr);
+  };
+
+  hlog << "(RefinedPoiseuille) Coarse channel " << nx << "x" << ny << "x" << nz << ", fine patch " << nxFine << "x" << nyFine << "x" << nzFine << " at " << origin.x << "," << origin.y << "," << origin.z << endl;
+
+  while (hemocell.iter < tmax) {
+    hemocell.iterate();
+    setExternalVector(*hemocell.lattice, hemocell.lattice->getBoundingBox(),
+                DESCRIPTOR<T>::ExternalField::forceBeginsAt,
+                plb::Array<FLUID_T, DESCRIPTOR<FLUID_T>::d>(force, 0.0, 0.0));
+    if (hemocell.iter % tmeas == 0) {
+      hlog << "(RefinedPoiseuille) @ " << hemocell.iter << " relative L2 error of the velocity profile: " << validate() << endl;
+    }
+  }
+
+  const T error = validate();
+  if (error > tolerance) {
+    hlog << "(RefinedPoiseuille) (Error) The relative L2 error of the velocity profile, " << error << ", is above the tolerance " << tolerance << endl;
+    return 1;
+  }
+  hlog << "(RefinedPoiseuille) The velocity profile matches the analytic profile, relative L2 error " << error << endl;
+  return 0;
+}
@@ -32,10 +32,10 @@ int main (int argc, char * argv[]) {
   Box3D backChannel( 0, 49, 49, 49, 0, 49);
   Box3D frontChannel( 0, 49, 0, 0, 0, 49);
 
-  defineDynamics(*hemocell.lattice, topChannel, new BounceBack<T, DESCRIPTOR> );
-  defineDynamics(*hemocell.lattice, bottomChannel, new BounceBack<T, DESCRIPTOR> );
-  defineDynamics(*hemocell.lattice, backChannel, new BounceBack<T, DESCRIPTOR> );
-  defineDynamics(*hemocell.lattice, frontChannel, new BounceBack<T, DESCRIPTOR> );
+  defineDynamics(*hemocell.lattice, topChannel, new BounceBack<FLUID_T, DESCRIPTOR> );
+  defineDynamics(*hemocell.lattice, bottomChannel, new BounceBack<FLUID_T, DESCRIPTOR> );
+  defineDynamics(*hemocell.lattice, backChannel, new BounceBack<FLUID_T, DESCRIPTOR> );
+  defineDynamics(*hemocell.lattice, frontChannel, new BounceBack<FLUID_T, DESCRIPTOR> );
 
   hemocell.lattice->toggleInternalStatistics(false);
   hemocell.latticeEquilibrium(1.,plb::Array<double, 3>(0.,0.,0.));
@@ -81,7 +81,7 @@ int main (int argc, char * argv[]) {
     //Set driving force as required after each iteration
     setExternalVector(*hemocell.lattice, hemocell.lattice->getBoundingBox(),
                 DESCRIPTOR<T>::ExternalField::forceBeginsAt,
-                plb::Array<T, DESCRIPTOR<T>::d>(poiseuilleForce, 0.0, 0.0));
+                plb::Array<FLUID_T, DESCRIPTOR<FLUID_T>::d>(poiseuilleForce, 0.0, 0.0));
 
     // When we want to save
     if (hemocell.iter % tmeas == 0) {
@@ -0,0 +1,109 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "hemocell.h"
+
+// Sparse fluid storage through a redistribution: the fluid nodes of the tube
+// are counted on the dense lattice, after compacting the storage and after the
+// blocks were moved to the decompositions of <parameters><tuneBlockSizes> (and
+// back to the fastest one). Every count must be the same, the removed solid
+// nodes must stay solid on the way. Fails (exit code 1) when they differ.
+
+long countFluidNodes(MultiBlockLattice3D<FLUID_T,DESCRIPTOR> & lattice) {
+  long fluid = 0;
+  for (plint bid : lattice.getLocalInfo().getBlocks()) {
+    BlockLattice3D<FLUID_T,DESCRIPTOR> & block = lattice.getComponent(bid);
+    const Dot3D location = block.getLocation();
+    Box3D bulk;
+    lattice.getSparseBlockStructure().getBulk(bid,bulk);
+    for (plint x = bulk.x0 ; x <= bulk.x1 ; x++) {
+      for (plint y = bulk.y0 ; y <= bulk.y1 ; y++) {
+        for (plint z = bulk.z0 ; z <= bulk.z1 ; z++) {
+          if (!block.get(x-location.x,y-location.y,z-location.z).getDynamics().isBoundary()) {
+            fluid++;
+          }
+        }
+      }
+    }
+  }
+  MPI_Allreduce(MPI_IN_PLACE,&fluid,1,MPI_LONG,MPI_SUM,MPI_COMM_WORLD);
+  return fluid;
+}
+
+int main(int argc, char * argv[]) {
+  if(argc < 2) {
+    cout << "Usage: " << argv[0] << " <configuration.xml>" << endl;
+    return -1;
+  }
+
+  HemoCell hemocell(argv[1],argc,argv);
+  Config * cfg = hemocell.cfg;
+
+  if (!hemo::global.enableSparseFluidStorage || hemo::global.tuneBlockSizes.empty()) {
+    hlog << "(SparseStorageBalance) (Error) Set <parameters><sparseFluidStorage> and <parameters><tuneBlockSizes>" << endl;
+    return -1;
+  }
+
+  std::auto_ptr<MultiScalarField3D<int>> flagMatrix;
+  std::auto_ptr<VoxelizedDomain3D<T>> voxelizedDomain;
+  getFlagMatrixFromSTL((*cfg)["domain"]["geometry"].read<string>(),
+                       (*cfg)["domain"]["fluidEnvelope"].read<int>(),
+                       (*cfg)["domain"]["refDirN"].read<int>(),
+                       (*cfg)["domain"]["refDir"].read<int>(),
+                       voxelizedDomain, flagMatrix,
+                       (*cfg)["domain"]["blockSize"].read<int>(),
+                       (*cfg)["domain"]["particleEnvelope"].read<int>());
+
+  param::lbm_base_parameters(*cfg);
+  param::printParameters();
+
+  hemocell.lattice = new MultiBlockLattice3D<FLUID_T, DESCRIPTOR>(
+            flagMatrix->getMultiBlockManagement(),
+            defaultMultiBlockPolicy3D().getBlockCommunicator(),
+            defaultMultiBlockPolicy3D().getCombinedStatistics(),
+            defaultMultiBlockPolicy3D().getMultiCellAccess<FLUID_T, DESCRIPTOR>(),
+            new GuoExternalForceBGKdynamics<FLUID_T, DESCRIPTOR>(1.0/param::tau));
+  defineDynamics(*hemocell.lattice, *flagMatrix.get(), (*hemocell.lattice).getBoundingBox(), new BounceBack<FLUID_T, DESCRIPTOR>(1.), 0);
+  hemocell.lattice->toggleInternalStatistics(false);
+  hemocell.lattice->periodicity().toggleAll(false);
+  hemocell.latticeEquilibrium(1.,plb::Array<T, 3>(0.,0.,0.));
+  hemocell.lattice->initialize();
+
+  const long dense = countFluidNodes(*hemocell.lattice);
+  hemocell.compactFluidStorage(*flagMatrix.get());
+  const long compacted = countFluidNodes(*hemocell.lattice);
+
+  hemocell.initializeCellfield();
+  hemocell.setSystemPeriodicity(0, true);
+  hemocell.loadParticles();
+  hemocell.tuneDecomposition(std::function<void()>());
+  const long redistributed = countFluidNodes(*hemocell.lattice);
+
+  hlog << "(SparseStorageBalance) Fluid nodes, dense: " << dense << ", compacted: " << compacted << ", redistributed: " << redistributed << endl;
+  if (compacted != dense || redistributed != dense) {
+    hlog << "(SparseStorageBalance) (Error) The number of fluid nodes changed" << endl;
+    return 1;
+  }
+  hlog << "(SparseStorageBalance) The fluid nodes are kept through the compaction and the redistribution" << endl;
+  return 0;
+}
@@ -57,22 +57,22 @@ int main(int argc, char* argv[])
 
 	plint extendedEnvelopeWidth = 2;  // Because we might use ibmKernel with with 2.
 
-	hemocell.lattice = new MultiBlockLattice3D<T,DESCRIPTOR>(
+	hemocell.lattice = new MultiBlockLattice3D<FLUID_T,DESCRIPTOR>(
 			defaultMultiBlockPolicy3D().getMultiBlockManagement(nx, ny, nz, extendedEnvelopeWidth),
 			defaultMultiBlockPolicy3D().getBlockCommunicator(),
 			defaultMultiBlockPolicy3D().getCombinedStatistics(),
-			defaultMultiBlockPolicy3D().getMultiCellAccess<T, DESCRIPTOR>(),
-			new GuoExternalForceBGKdynamics<T, DESCRIPTOR>(1.0/param::tau));
+			defaultMultiBlockPolicy3D().getMultiCellAccess<FLUID_T, DESCRIPTOR>(),
+			new GuoExternalForceBGKdynamics<FLUID_T, DESCRIPTOR>(1.0/param::tau));
 
 
 	hemocell.lattice->toggleInternalStatistics(false);
   hemocell.lattice->periodicity().toggleAll(false);
 
-  OnLatticeBoundaryCondition3D<T,DESCRIPTOR>* boundaryCondition
-          = createLocalBoundaryCondition3D<T,DESCRIPTOR>();
+  OnLatticeBoundaryCondition3D<FLUID_T,DESCRIPTOR>* boundaryCondition
+          = createLocalBoundaryCondition3D<FLUID_T,DESCRIPTOR>();
 
   boundaryCondition->setVelocityConditionOnBlockBoundaries(*hemocell.lattice);
-  setBoundaryVelocity(*hemocell.lattice, hemocell.lattice->getBoundingBox(), plb::Array<T,3>(0.,0.,0.) );
+  setBoundaryVelocity(*hemocell.lattice, hemocell.lattice->getBoundingBox(), plb::Array<FLUID_T,3>(0.,0.,0.) );
 
   hemocell.latticeEquilibrium(1., hemo::Array<T, 3>({0.,0.,0.}));
 
@@ -134,4 +134,31 @@ namespace hemo {
       }
     }
   }
-}
\ No newline at end of file
+
+  void bindingFieldHelper::redistribute() {
+    plb::MultiScalarField3D<bool> * oldField = multiBindingField;
+    multiBindingField = new plb::MultiScalarField3D<bool>(
+            MultiBlockManagement3D (
+                *cellFields.hemocell.lattice->getSparseBlockStructure().clone(),
+                cellFields.hemocell.lattice->getMultiBlockManagement().getThreadAttribution().clone(),
+                cellFields.hemocell.lattice->getMultiBlockManagement().getEnvelopeWidth(),
+                cellFields.hemocell.lattice->getMultiBlockManagement().getRefinementLevel()),
+                defaultMultiBlockPolicy3D().getBlockCommunicator(),                
+                defaultMultiBlockPolicy3D().getCombinedStatistics(),
+                defaultMultiBlockPolicy3D().getMultiScalarAccess<bool>(),
+                0);
+    multiBindingField->periodicity().toggle(0,cellFields.hemocell.lattice->periodicity().get(0));
+    multiBindingField->periodicity().toggle(1,cellFields.hemocell.lattice->periodicity().get(1));
+    multiBindingField->periodicity().toggle(2,cellFields.hemocell.lattice->periodicity().get(2));
+
+    copyNonLocal(*oldField,*multiBindingField,oldField->getBoundingBox(),modif::staticVariables);
+    multiBindingField->duplicateOverlaps(modif::staticVariables);
+    delete oldField;
+
+    for (const plint & bId : multiBindingField->getLocalInfo().getBlocks()) {
+      HemoCellParticleField & pf = cellFields.immersedParticles->getComponent(bId);
+      pf.bindingField = &multiBindingField->getComponent(bId);
+    }
+    refillBindingSites();
+  }
+}
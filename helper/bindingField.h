@@ -37,6 +37,8 @@ namespace hemo {
       
     void checkpoint();
     static void restore(HemoCellFields & cellFields);
+    /// Move the field to the distribution of the (new) fluid lattice, used by the LoadBalancer
+    void redistribute();
     
     //Called within functional, from particlefield
     void add(HemoCellParticleField & pf, const Dot3D & bindingSite);
@@ -0,0 +1,106 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "blockCost.h"
+
+#include <algorithm>
+
+namespace hemo {
+
+const char * BlockCost::name(Entry entry) {
+  static const char * names[numEntries] = {
+    "collideAndStream",
+    "HemoFindInternalParticleGridPoints",
+    "HemoInternalGridPointsMembrane",
+    "HemoInterpolateFluidVelocity",
+    "HemoSyncEnvelopes",
+    "HemoAdvanceParticles",
+    "HemoSpreadParticleForce",
+    "HemoApplyConstitutiveModel",
+    "HemoUnifyForceVectors",
+    "HemoRepulsionForce",
+    "HemoBoundaryRepulsionForce",
+    "HemoPopulateBoundaryParticles",
+    "HemoPopulateBindingSites",
+    "HemoupdateResidenceTime",
+    "HemoSeperateForceVectors",
+    "HemoDeleteIncompleteCells",
+    "HemoGetParticles",
+    "HemoSetParticles",
+    "HemoDeleteNonLocalParticles",
+    "HemoSolidifyCells"
+  };
+  return names[entry];
+}
+
+void BlockCost::closeSample(unsigned int window) {
+  // As many iterations per slot as needed to fit the window in the ring, and
+  // as many slots as fit in the window. A small window uses one slot per iteration
+  window = std::max(window,1u);
+  const unsigned int perSlot = (window + slots - 1)/slots;
+  const unsigned int nSlots = window/perSlot;
+  if (head >= nSlots) { // The window shrunk
+    clear();
+  }
+
+  // Start a new slot when the current one is full, it replaces the oldest
+  if (ringSamples[head] >= perSlot) {
+    head = (head + 1) % nSlots;
+    Times & oldest = ring[head];
+    for (unsigned int e = 0 ; e < numEntries ; e++) {
+      windowSum[e] -= oldest[e];
+    }
+    oldest.fill(0.);
+    samples -= ringSamples[head];
+    ringSamples[head] = 0;
+  }
+
+  Times & slot = ring[head];
+  for (unsigned int e = 0 ; e < numEntries ; e++) {
+    slot[e] += current[e];
+    windowSum[e] += current[e];
+  }
+  current.fill(0.);
+  ringSamples[head]++;
+  samples++;
+}
+
+void BlockCost::clear() {
+  current.fill(0.);
+  windowSum.fill(0.);
+  for (Times & slot : ring) {
+    slot.fill(0.);
+  }
+  ringSamples.fill(0);
+  head = 0;
+  samples = 0;
+}
+
+double BlockCost::getTotalTime() const {
+  double total = 0.;
+  for (double time : windowSum) {
+    total += time;
+  }
+  return total;
+}
+}
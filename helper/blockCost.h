@@ -0,0 +1,110 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef HEMO_BLOCKCOST_H
+#define HEMO_BLOCKCOST_H
+
+#include <array>
+#include <chrono>
+
+namespace hemo {
+/**
+ * Cost counters of a single atomic block: the wall clock time per functional
+ * (and the share of the fluid step), summed over a sliding window of the last
+ * iterations. A sample is closed at the end of every HemoCell::iterate().
+ *
+ * The samples are kept in a ring buffer of a fixed number of slots with a
+ * running sum, a slot sums up to window/slots consecutive iterations. The
+ * window therefore moves in steps of a slot: it covers at most window and at
+ * least window minus two slots of iterations, with a few kB per block for any
+ * window.
+ */
+class BlockCost {
+public:
+  /// The functionals (and the fluid step) that are timed
+  enum Entry {
+    collideAndStream,
+    findInternalParticleGridPoints,
+    internalGridPointsMembrane,
+    interpolateFluidVelocity,
+    syncEnvelopes,
+    advanceParticles,
+    spreadParticleForce,
+    applyConstitutiveModel,
+    unifyForceVectors,
+    repulsionForce,
+    boundaryRepulsionForce,
+    populateBoundaryParticles,
+    populateBindingSites,
+    updateResidenceTime,
+    seperateForceVectors,
+    deleteIncompleteCells,
+    getParticles,
+    setParticles,
+    deleteNonLocalParticles,
+    solidifyCells,
+    numEntries
+  };
+  static const unsigned int slots = 32;
+
+  /// Name of an entry in the output
+  static const char * name(Entry entry);
+
+  /// Add time (s) to an entry of the current sample
+  void add(Entry entry, double seconds) { current[entry] += seconds; }
+  /// Close the current sample, samples older than window iterations are dropped
+  void closeSample(unsigned int window);
+  /// Forget all samples, e.g. after the block has been moved
+  void clear();
+
+  /// Time (s) of an entry over the window
+  double getTime(Entry entry) const { return windowSum[entry]; }
+  /// Time (s) of all entries over the window
+  double getTotalTime() const;
+  /// Number of samples (iterations) in the window
+  unsigned int getSamples() const { return samples; }
+
+private:
+  typedef std::array<double,numEntries> Times;
+  Times current{};
+  Times windowSum{};
+  std::array<Times,slots> ring{};
+  std::array<unsigned int,slots> ringSamples{};
+  unsigned int head = 0;
+  unsigned int samples = 0;
+};
+
+/// Adds the wall clock time of its scope to an entry of a BlockCost
+class BlockCostTimer {
+public:
+  BlockCostTimer(BlockCost & cost_, BlockCost::Entry entry_) : cost(cost_), entry(entry_) {}
+  ~BlockCostTimer() {
+    cost.add(entry,std::chrono::duration<double>(std::chrono::high_resolution_clock::now()-start_time).count());
+  }
+private:
+  BlockCost & cost;
+  const BlockCost::Entry entry;
+  const std::chrono::high_resolution_clock::time_point start_time = std::chrono::high_resolution_clock::now();
+};
+}
+#endif /* HEMO_BLOCKCOST_H */
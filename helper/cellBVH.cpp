@@ -0,0 +1,155 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "cellBVH.h"
+
+#include <map>
+
+namespace hemo {
+
+namespace {
+/// Triangles per leaf
+const int leafSize = 4;
+}
+
+CellBVH & CellBVH::forCell(const std::vector<hemo::Array<plint,3>> & triangles,
+                           std::vector<HemoCellParticle> & particles, const std::vector<int> & cell) {
+  // The triangle list of a cell type lives as long as the simulation
+  static thread_local std::map<const std::vector<hemo::Array<plint,3>>*,CellBVH> trees;
+  CellBVH & tree = trees[&triangles];
+  const bool built = tree.triangles.size() == triangles.size() && !tree.nodes.empty();
+  tree.vertices.resize(cell.size());
+  for (unsigned int i = 0; i < cell.size(); i++) {
+    tree.vertices[i] = particles[cell[i]].sv.position;
+  }
+  if (built) {
+    tree.refit();
+  } else {
+    tree.build(triangles);
+  }
+  return tree;
+}
+
+void CellBVH::build(const std::vector<hemo::Array<plint,3>> & triangles_) {
+  triangles = triangles_;
+  order.resize(triangles.size());
+  std::vector<hemo::Array<T,3>> centroids(triangles.size());
+  for (unsigned int t = 0; t < triangles.size(); t++) {
+    order[t] = t;
+    centroids[t] = (vertices[triangles[t][0]] + vertices[triangles[t][1]] + vertices[triangles[t][2]])/3.;
+  }
+  nodes.clear();
+  nodes.reserve(2*(triangles.size()/leafSize + 1));
+  if (!triangles.empty()) {
+    buildNode(0, triangles.size(), centroids);
+  }
+  refit();
+}
+
+int CellBVH::buildNode(int begin, int end, std::vector<hemo::Array<T,3>> const & centroids) {
+  const int index = nodes.size();
+  nodes.push_back(Node());
+  if (end - begin <= leafSize) {
+    nodes[index].index = begin;
+    nodes[index].count = end - begin;
+    return index;
+  }
+
+  // Median split along the longest axis of the centroids
+  hemo::Array<T,3> lower = centroids[order[begin]], upper = lower;
+  for (int i = begin + 1; i < end; i++) {
+    for (int d = 0; d < 3; d++) {
+      lower[d] = std::min(lower[d], centroids[order[i]][d]);
+      upper[d] = std::max(upper[d], centroids[order[i]][d]);
+    }
+  }
+  const hemo::Array<T,3> extent = upper - lower;
+  const int axis = extent[0] > extent[1] ? (extent[0] > extent[2] ? 0 : 2) : (extent[1] > extent[2] ? 1 : 2);
+  const int middle = (begin + end)/2;
+  std::nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end,
+                   [&](int a, int b) { return centroids[a][axis] < centroids[b][axis]; });
+
+  nodes[index].count = 0;
+  buildNode(begin, middle, centroids);
+  const int right = buildNode(middle, end, centroids);
+  nodes[index].index = right;
+  return index;
+}
+
+CellBVH::Node CellBVH::triangleBounds(int t) const {
+  Node bounds;
+  bounds.lower = bounds.upper = vertices[triangles[t][0]];
+  for (int v = 1; v < 3; v++) {
+    for (int d = 0; d < 3; d++) {
+      bounds.lower[d] = std::min(bounds.lower[d], vertices[triangles[t][v]][d]);
+      bounds.upper[d] = std::max(bounds.upper[d], vertices[triangles[t][v]][d]);
+    }
+  }
+  return bounds;
+}
+
+void CellBVH::refit(std::vector<HemoCellParticle> & particles, const std::vector<int> & cell) {
+  vertices.resize(cell.size());
+  for (unsigned int i = 0; i < cell.size(); i++) {
+    vertices[i] = particles[cell[i]].sv.position;
+  }
+  refit();
+}
+
+void CellBVH::refit() {
+  // Children come after their parent, so a reverse sweep visits them first
+  for (int n = nodes.size() - 1; n >= 0; n--) {
+    Node & node = nodes[n];
+    if (node.count) {
+      const Node first = triangleBounds(order[node.index]);
+      node.lower = first.lower;
+      node.upper = first.upper;
+      for (int i = node.index + 1; i < node.index + node.count; i++) {
+        const Node bounds = triangleBounds(order[i]);
+        for (int d = 0; d < 3; d++) {
+          node.lower[d] = std::min(node.lower[d], bounds.lower[d]);
+          node.upper[d] = std::max(node.upper[d], bounds.upper[d]);
+        }
+      }
+    } else {
+      const Node & left = nodes[n+1];
+      const Node & right = nodes[node.index];
+      for (int d = 0; d < 3; d++) {
+        node.lower[d] = std::min(left.lower[d], right.lower[d]);
+        node.upper[d] = std::max(left.upper[d], right.upper[d]);
+      }
+    }
+  }
+}
+
+hemo::Array<T,6> CellBVH::boundingBox() const {
+  const Node & root = nodes.front();
+  return {root.lower[0], root.upper[0], root.lower[1], root.upper[1], root.lower[2], root.upper[2]};
+}
+
+bool CellBVH::isInnerNode(hemo::Array<plint,3> latticeSite) const {
+  int crossedCounter = 0;
+  crossings(latticeSite[1], latticeSite[2], [&](T x) { crossedCounter += x < latticeSite[0]; });
+  return crossedCounter%2;
+}
+}
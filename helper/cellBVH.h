@@ -0,0 +1,224 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef HEMO_CELL_BVH_H
+#define HEMO_CELL_BVH_H
+
+#include "hemoCellParticle.h"
+#include "mollerTrumbore.h"
+#include "atomicBlock/blockLattice3D.h"
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+#include <vector>
+
+namespace hemo {
+
+/**
+ * Bounding volume hierarchy over the triangles of the membrane of one cell.
+ *
+ * The tree is stored flat: the nodes in depth first order, the left child of
+ * an inner node directly after it, and the triangles of the leaves as
+ * contiguous ranges of triangle indices. It is built once per cell type with a
+ * median split of the triangle centroids along the longest axis. Since all
+ * cells of a type share the mesh topology, every next cell only refits the
+ * node bounds to its own vertices, so nothing is allocated per cell.
+ */
+class CellBVH {
+public:
+  struct Node {
+    hemo::Array<T,3> lower, upper;
+    /// Leaf: first index in the triangle order. Inner node: index of the right child
+    int index;
+    /// Number of triangles of a leaf, 0 for an inner node
+    int count;
+  };
+
+  /// Tree of the cell type with this triangle list, shared by the cells of the
+  /// type on this thread, refitted to the vertices of cell (complete cells only)
+  static CellBVH & forCell(const std::vector<hemo::Array<plint,3>> & triangles,
+                           std::vector<HemoCellParticle> & particles, const std::vector<int> & cell);
+
+  /// Build the tree for the triangles over the current vertices
+  void build(const std::vector<hemo::Array<plint,3>> & triangles_);
+  /// Copy the vertex positions of a cell and recompute the node bounds, the topology is kept
+  void refit(std::vector<HemoCellParticle> & particles, const std::vector<int> & cell);
+  /// Recompute the node bounds after the vertices changed
+  void refit();
+
+  /// Bounding box of the membrane: x0,x1,y0,y1,z0,z1
+  hemo::Array<T,6> boundingBox() const;
+
+  /// Even-odd crossing test of a lattice site (global coordinates) along the x axis
+  bool isInnerNode(hemo::Array<plint,3> latticeSite) const;
+
+  /// Lattice sites (local coordinates of fluid) within the membrane, found with
+  /// one line along x per (y,z) column of the bounding box
+  template<typename S, template<typename U> class Descriptor>
+  void findInnerNodes(plb::BlockLattice3D<S,Descriptor> * fluid, std::set<hemo::Array<plint,3>> & innerNodes) const {
+    innerNodes.clear();
+    if (nodes.empty()) { return; }
+    const plb::Dot3D & location = fluid->getLocation();
+    const hemo::Array<T,6> bbox = boundingBox();
+    const plint x0 = std::max(plint(std::ceil(bbox[0])), location.x), x1 = std::min(plint(std::floor(bbox[1])), location.x + fluid->getNx()-1);
+    const plint y0 = std::max(plint(std::ceil(bbox[2])), location.y), y1 = std::min(plint(std::floor(bbox[3])), location.y + fluid->getNy()-1);
+    const plint z0 = std::max(plint(std::ceil(bbox[4])), location.z), z1 = std::min(plint(std::floor(bbox[5])), location.z + fluid->getNz()-1);
+    std::vector<T> xs;
+    for (plint y = y0; y <= y1; y++) {
+      for (plint z = z0; z <= z1; z++) {
+        xs.clear();
+        crossings(y, z, [&](T x) { xs.push_back(x); });
+        if (xs.empty()) { continue; }
+        std::sort(xs.begin(), xs.end());
+        unsigned int passed = 0;
+        for (plint x = x0; x <= x1; x++) {
+          while (passed < xs.size() && xs[passed] < x) { passed++; }
+          if (passed%2) {
+            innerNodes.insert({x-location.x, y-location.y, z-location.z});
+          }
+        }
+      }
+    }
+  }
+
+  /// Update the lattice sites (local coordinates of fluid) within the membrane,
+  /// innerNodes holds the sites within it when its vertices were at previous.
+  /// A site can only change side when the membrane passed it, so only the band
+  /// of sites within displacement (the largest vertex displacement) of the
+  /// previous triangles is classified again, one line along x per (y,z) column
+  template<typename S, template<typename U> class Descriptor>
+  void updateInnerNodes(plb::BlockLattice3D<S,Descriptor> * fluid, const std::vector<hemo::Array<T,3>> & previous,
+                        T displacement, std::set<hemo::Array<plint,3>> & innerNodes) const {
+    if (nodes.empty()) { return; }
+    const plb::Dot3D & location = fluid->getLocation();
+    const plint offset[3] = {location.x, location.y, location.z};
+    const plint n[3] = {fluid->getNx(), fluid->getNy(), fluid->getNz()};
+    const T margin = displacement + 1e-6;
+    auto range = [&](T lower, T upper, int d, plint & lo, plint & hi) {
+      lo = std::max(plint(std::ceil(lower - margin)) - offset[d], plint(0));
+      hi = std::min(plint(std::floor(upper + margin)) - offset[d], n[d]-1);
+    };
+
+    // Band as x ranges per (y,z) column
+    hemo::Array<T,3> lower = previous[0], upper = previous[0];
+    for (const hemo::Array<T,3> & position : previous) {
+      for (int d = 0; d < 3; d++) {
+        lower[d] = std::min(lower[d], position[d]);
+        upper[d] = std::max(upper[d], position[d]);
+      }
+    }
+    plint lo[3], hi[3];
+    for (int d = 0; d < 3; d++) { range(lower[d], upper[d], d, lo[d], hi[d]); }
+    if (lo[1] > hi[1] || lo[2] > hi[2]) { return; }
+    const plint nz = hi[2] - lo[2] + 1;
+    std::vector<std::vector<std::pair<plint,plint>>> columns((hi[1] - lo[1] + 1)*nz);
+    for (const hemo::Array<plint,3> & t : triangles) {
+      plint tlo[3], thi[3];
+      for (int d = 0; d < 3; d++) {
+        range(std::min(previous[t[0]][d], std::min(previous[t[1]][d], previous[t[2]][d])),
+              std::max(previous[t[0]][d], std::max(previous[t[1]][d], previous[t[2]][d])), d, tlo[d], thi[d]);
+      }
+      if (tlo[0] > thi[0]) { continue; }
+      for (plint y = tlo[1]; y <= thi[1]; y++) {
+        for (plint z = tlo[2]; z <= thi[2]; z++) {
+          columns[(y - lo[1])*nz + z - lo[2]].push_back({tlo[0], thi[0]});
+        }
+      }
+    }
+
+    std::vector<T> xs;
+    for (plint y = lo[1]; y <= hi[1]; y++) {
+      for (plint z = lo[2]; z <= hi[2]; z++) {
+        std::vector<std::pair<plint,plint>> & ranges = columns[(y - lo[1])*nz + z - lo[2]];
+        if (ranges.empty()) { continue; }
+        std::sort(ranges.begin(), ranges.end());
+        xs.clear();
+        crossings(y + location.y, z + location.z, [&](T x) { xs.push_back(x); });
+        std::sort(xs.begin(), xs.end());
+        unsigned int passed = 0;
+        plint next = ranges.front().first;
+        for (const std::pair<plint,plint> & r : ranges) {
+          for (plint x = std::max(r.first, next); x <= r.second; x++) {
+            while (passed < xs.size() && xs[passed] < x + location.x) { passed++; }
+            const hemo::Array<plint,3> site = {x, y, z};
+            if (passed%2) {
+              innerNodes.insert(site);
+            } else {
+              innerNodes.erase(site);
+            }
+          }
+          next = std::max(next, r.second + 1);
+        }
+      }
+    }
+  }
+
+  /// Call visit(x) for every crossing of the membrane with the line through
+  /// (yLine,zLine) parallel to the x axis, see TrianglePacket
+  template<typename F>
+  void crossings(T yLine, T zLine, F visit) const {
+    if (nodes.empty()) { return; }
+    TrianglePacket packet;
+    T xCross[TrianglePacket::width];
+    auto flush = [&]() {
+      const unsigned int crossed = packet.cross(yLine, zLine, xCross);
+      for (int l = 0; l < packet.size; l++) {
+        if (crossed >> l & 1) { visit(xCross[l]); }
+      }
+      packet.clear();
+    };
+    int stack[64];
+    int top = 0;
+    stack[top++] = 0;
+    while (top) {
+      const Node & node = nodes[stack[--top]];
+      if (yLine < node.lower[1] || yLine > node.upper[1] || zLine < node.lower[2] || zLine > node.upper[2]) { continue; }
+      if (node.count) {
+        for (int i = node.index; i < node.index + node.count; i++) {
+          const hemo::Array<plint,3> & t = triangles[order[i]];
+          packet.add(order[i], vertices[t[0]], vertices[t[1]], vertices[t[2]], t[0], t[1], t[2]);
+          if (packet.full()) { flush(); }
+        }
+      } else {
+        stack[top++] = node.index;
+        stack[top++] = &node - nodes.data() + 1;
+      }
+    }
+    if (!packet.empty()) { flush(); }
+  }
+
+  /// Vertices of the cell (refit) and the triangles of the cell type (build)
+  std::vector<hemo::Array<T,3>> vertices;
+  std::vector<hemo::Array<plint,3>> triangles;
+
+private:
+  int buildNode(int begin, int end, std::vector<hemo::Array<T,3>> const & centroids);
+  Node triangleBounds(int t) const;
+
+  std::vector<Node> nodes;
+  /// Triangle indices in leaf order
+  std::vector<int> order;
+};
+}
+#endif
@@ -0,0 +1,396 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab
+in the University of Amsterdam. Any questions or remarks regarding this library
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "coarseCheckpoint.h"
+#include "hemocell.h"
+#include "interiorViscosity.h"
+#include "palabos3D.h"
+#include "palabos3D.hh"
+
+#include <cmath>
+#include <mpi.h>
+
+namespace hemo {
+using namespace plb;
+
+typedef DESCRIPTOR<T> D;
+
+namespace {
+const int nPi = SymmetricTensor<T,DESCRIPTOR>::n;
+
+/// Checkpoint nodes [first,last] along an axis that go to the fine nodes [x0,x1]:
+/// the ones closest to them, and all remaining ones on the faces of the domain
+void project(plint x0, plint x1, plint fineLast, plint coarseLast, T ratio, T origin, plint & first, plint & last) {
+  first = (x0 == 0) ? 0 : (plint)std::ceil((x0 - 0.5 - origin)/ratio);
+  last = (x1 == fineLast) ? coarseLast : (plint)std::ceil((x1 + 0.5 - origin)/ratio) - 1;
+  first = std::max(first, (plint)0);
+  last = std::min(last, coarseLast);
+}
+}
+
+CoarseCheckpoint::CoarseCheckpoint(HemoCell & hemocell_, std::string directory_) :
+  hemocell(hemocell_), directory(directory_)
+{
+  if (!hemocell.lattice) {
+    hlog << "(CoarseCheckpoint) (Error) The lattice must be initialized before a checkpoint can be loaded into it" << endl;
+    exit(1);
+  }
+  if (hemocell.preInlet) {
+    hlog << "(CoarseCheckpoint) (Error) Cases with a preinlet cannot be started from a checkpoint at another resolution" << endl;
+    exit(1);
+  }
+  if (directory.empty()) {
+    hlog << "(CoarseCheckpoint) (Error) No checkpoint directory given" << endl;
+    exit(1);
+  }
+  if (directory.back() != '/') {
+    directory += "/";
+  }
+  if (!file_exists(directory + "checkpoint.xml")) {
+    hlog << "(CoarseCheckpoint) (Error) No checkpoint.xml found in " << directory << endl;
+    exit(1);
+  }
+
+  XMLreader xml(directory + "checkpoint.xml");
+  T nu_p;
+  xml["Checkpoint"]["hemocell"]["domain"]["dx"].read(dx);
+  xml["Checkpoint"]["hemocell"]["domain"]["dt"].read(dt);
+  xml["Checkpoint"]["hemocell"]["domain"]["nuP"].read(nu_p);
+  if (dt < 0.) { // As in Parameters::lbm_base_parameters, tau is 1
+    dt = 1.0/3.0*(1.0 - 0.5)/nu_p*(dx*dx);
+  }
+  ratio = dx/param::dx;
+  velocityFactor = (param::dt/dt)*ratio;
+  densityFactor = velocityFactor*velocityFactor;
+  origin = {1. - ratio, 1. - ratio, 1. - ratio};
+
+  try {
+    xml["Checkpoint"]["General"]["LatticeSize"]["nx"].read(n[0]);
+    xml["Checkpoint"]["General"]["LatticeSize"]["ny"].read(n[1]);
+    xml["Checkpoint"]["General"]["LatticeSize"]["nz"].read(n[2]);
+  } catch (PlbIOException & e) { // Checkpoints written before the lattice size was stored
+    const plint fine[3] = {hemocell.lattice->getNx(), hemocell.lattice->getNy(), hemocell.lattice->getNz()};
+    for (int d = 0; d < 3; d++) {
+      n[d] = (plint)std::round((fine[d] - 1 - origin[d])/ratio) + 1;
+    }
+    hlog << "(CoarseCheckpoint) (Warning) The checkpoint does not contain its lattice size, assuming "
+         << n[0] << "x" << n[1] << "x" << n[2] << " from the voxelized geometry" << endl;
+  }
+
+  hlog << "(CoarseCheckpoint) Checkpoint in " << directory << ": " << n[0] << "x" << n[1] << "x" << n[2]
+       << " nodes, dx " << dx << " dt " << dt << ", " << ratio << " times the dx of this run" << endl;
+}
+
+CoarseCheckpoint::~CoarseCheckpoint() {
+  delete shadowParticles;
+  delete shadow;
+}
+
+void CoarseCheckpoint::setOrigin(hemo::Array<T,3> origin_) {
+  origin = origin_;
+  delete shadowParticles;
+  shadowParticles = 0;
+  delete shadow;
+  shadow = 0;
+}
+
+void CoarseCheckpoint::createShadow() {
+  MultiBlockLattice3D<FLUID_T,DESCRIPTOR> & lattice = *hemocell.lattice;
+  MultiBlockManagement3D const & fineManagement = lattice.getMultiBlockManagement();
+  const Box3D coarseBox(0, n[0]-1, 0, n[1]-1, 0, n[2]-1);
+  const plint fineLast[3] = {lattice.getNx()-1, lattice.getNy()-1, lattice.getNz()-1};
+
+  SparseBlockStructure3D structure(coarseBox);
+  map<plint,plint> blockToMpi;
+  for (auto const & bulk : lattice.getSparseBlockStructure().getBulks()) {
+    const Box3D & b = bulk.second;
+    plint first[3], last[3];
+    project(b.x0, b.x1, fineLast[0], n[0]-1, ratio, origin[0], first[0], last[0]);
+    project(b.y0, b.y1, fineLast[1], n[1]-1, ratio, origin[1], first[1], last[1]);
+    project(b.z0, b.z1, fineLast[2], n[2]-1, ratio, origin[2], first[2], last[2]);
+    if (first[0] > last[0] || first[1] > last[1] || first[2] > last[2]) {
+      hlog << "(CoarseCheckpoint) (Error) Atomic block " << bulk.first << " contains no checkpoint node, use larger atomic blocks" << endl;
+      exit(1);
+    }
+    Box3D projected(first[0], last[0], first[1], last[1], first[2], last[2]);
+    structure.addBlock(projected, projected, bulk.first);
+    blockToMpi[bulk.first] = fineManagement.getThreadAttribution().getMpiProcess(bulk.first);
+  }
+
+  shadow = new MultiBlockLattice3D<FLUID_T,DESCRIPTOR>(
+            MultiBlockManagement3D(structure,
+                                   new ExplicitThreadAttribution(blockToMpi),
+                                   1,
+                                   fineManagement.getRefinementLevel()),
+            defaultMultiBlockPolicy3D().getBlockCommunicator(),
+            defaultMultiBlockPolicy3D().getCombinedStatistics(),
+            defaultMultiBlockPolicy3D().getMultiCellAccess<FLUID_T, DESCRIPTOR>(),
+            new GuoExternalForceBGKdynamics<FLUID_T, DESCRIPTOR>(1.0/param::tau));
+  shadow->toggleInternalStatistics(false);
+  shadowParticles = new MultiParticleField3D<HEMOCELL_PARTICLE_FIELD>(
+            MultiBlockManagement3D(structure,
+                                   new ExplicitThreadAttribution(blockToMpi),
+                                   hemocell.cellfields ? hemocell.cellfields->envelopeSize : 1,
+                                   fineManagement.getRefinementLevel()),
+            defaultMultiBlockPolicy3D().getCombinedStatistics());
+  shadowParticles->toggleInternalStatistics(false);
+  for (int d = 0; d < 3; d++) {
+    shadow->periodicity().toggle(d, lattice.periodicity().get(d));
+    shadowParticles->periodicity().toggle(d, lattice.periodicity().get(d));
+  }
+}
+
+void CoarseCheckpoint::loadFluid() {
+  if (!(file_exists(directory + "lattice.dat") && file_exists(directory + "lattice.plb"))) {
+    hlog << "(CoarseCheckpoint) (Error) No lattice found in " << directory << endl;
+    exit(1);
+  }
+  hlog << "(CoarseCheckpoint) Interpolating the fluid from " << directory << endl;
+  global.statistics.getCurrent()["coarseCheckpointFluid"].start();
+  if (!shadow) {
+    createShadow();
+  }
+
+  // The checkpoint is read with the default distribution, the dynamics (walls) come with it
+  {
+    MultiBlockLattice3D<FLUID_T,DESCRIPTOR> coarse(n[0], n[1], n[2], new GuoExternalForceBGKdynamics<FLUID_T, DESCRIPTOR>(1.0/param::tau));
+    coarse.toggleInternalStatistics(false);
+    plb::parallelIO::load(directory + "lattice", coarse, true);
+    copyNonLocal(coarse, *shadow, shadow->getBoundingBox(), modif::dataStructure);
+  }
+  shadow->duplicateOverlaps(modif::dataStructure);
+
+  // The interior nodes of the cells in the checkpoint were saved with the omega of the node
+  // collided last, their own relaxation times are in the interior viscosity field
+  MultiScalarField3D<T> * shadowTau = 0;
+  if (file_exists(directory + "internalViscosity.dat") && file_exists(directory + "internalViscosity.plb")) {
+    MultiScalarField3D<T> coarseTau(n[0], n[1], n[2]);
+    plb::parallelIO::load(directory + "internalViscosity", coarseTau, true);
+    shadowTau = new MultiScalarField3D<T>(shadow->getMultiBlockManagement(),
+            defaultMultiBlockPolicy3D().getBlockCommunicator(),
+            defaultMultiBlockPolicy3D().getCombinedStatistics(),
+            defaultMultiBlockPolicy3D().getMultiScalarAccess<T>(),
+            0);
+    copyNonLocal(coarseTau, *shadowTau, shadowTau->getBoundingBox(), modif::staticVariables);
+    shadowTau->duplicateOverlaps(modif::staticVariables);
+  }
+
+  MultiBlockLattice3D<FLUID_T,DESCRIPTOR> & lattice = *hemocell.lattice;
+  const T dtRatio = param::dt/dt;
+  long unresolved = 0;
+  for (plint bid : lattice.getLocalInfo().getBlocks()) {
+    BlockLattice3D<FLUID_T,DESCRIPTOR> & block = lattice.getComponent(bid);
+    BlockLattice3D<FLUID_T,DESCRIPTOR> & shadowBlock = shadow->getComponent(bid);
+    ScalarField3D<T> * tauBlock = shadowTau ? &shadowTau->getComponent(bid) : 0;
+    const Dot3D fl = block.getLocation(), sl = shadowBlock.getLocation();
+    const Box3D shadowBox = shadowBlock.getBoundingBox();
+    Box3D bulk;
+    lattice.getSparseBlockStructure().getBulk(bid, bulk);
+    for (plint x = bulk.x0; x <= bulk.x1; x++) {
+    for (plint y = bulk.y0; y <= bulk.y1; y++) {
+    for (plint z = bulk.z0; z <= bulk.z1; z++) {
+      Cell<FLUID_T,DESCRIPTOR> & cell = block.get(x-fl.x, y-fl.y, z-fl.z);
+      if (cell.getDynamics().isBoundary()) { continue; }
+
+      const T position[3] = {(x-origin[0])/ratio, (y-origin[1])/ratio, (z-origin[2])/ratio};
+      plint c0[3];
+      T t[3];
+      for (int d = 0; d < 3; d++) {
+        c0[d] = (plint)std::floor(position[d]);
+        t[d] = position[d] - c0[d];
+      }
+
+      // Trilinear interpolation of rhoBar, j and omega*PiNeq of the fluid checkpoint nodes around the node
+      T rhoBar = 0., weightSum = 0.;
+      plb::Array<T,3> j(0.,0.,0.);
+      plb::Array<T,nPi> strain;
+      strain.resetToZero();
+      for (int i = 0; i < 8; i++) {
+        const plint c[3] = {c0[0] + (i&1), c0[1] + ((i>>1)&1), c0[2] + ((i>>2)&1)};
+        const T weight = ((i&1) ? t[0] : 1.-t[0])*(((i>>1)&1) ? t[1] : 1.-t[1])*(((i>>2)&1) ? t[2] : 1.-t[2]);
+        if (weight == 0.) { continue; }
+        const plint lx = c[0]-sl.x, ly = c[1]-sl.y, lz = c[2]-sl.z;
+        if (!contained(lx, ly, lz, shadowBox)) { continue; }
+        Cell<FLUID_T,DESCRIPTOR> & coarseCell = shadowBlock.get(lx, ly, lz);
+        if (coarseCell.getDynamics().isBoundary()) { continue; }
+        const T cTau = tauBlock ? tauBlock->get(lx, ly, lz) : 0.;
+        const T cOmega = cTau > 0. ? 1./cTau : coarseCell.getDynamics().getOmega();
+
+        T cRhoBar = 0.;
+        plb::Array<T,3> cj(0.,0.,0.);
+        plb::Array<T,nPi> pi;
+        pi.resetToZero();
+        for (plint iPop = 0; iPop < D::q; iPop++) {
+          const T f = coarseCell[iPop];
+          cRhoBar += f;
+          int k = 0;
+          for (int a = 0; a < 3; a++) {
+            cj[a] += D::c[iPop][a]*f;
+            for (int b = a; b < 3; b++) {
+              pi[k++] += D::c[iPop][a]*D::c[iPop][b]*f;
+            }
+          }
+        }
+        // Populations are stored shifted by their weight, PiNeq = sum c c f - rhoBar cs2 I - j j / rho
+        const T cInvRho = D::invRho(cRhoBar);
+        int k = 0;
+        for (int a = 0; a < 3; a++) {
+          for (int b = a; b < 3; b++) {
+            pi[k] -= cj[a]*cj[b]*cInvRho + (a == b ? cRhoBar*D::cs2 : 0.);
+            strain[k] += weight*pi[k]*cOmega;
+            k++;
+          }
+        }
+        rhoBar += weight*cRhoBar;
+        for (int a = 0; a < 3; a++) {
+          j[a] += weight*cj[a]*cInvRho;
+        }
+        weightSum += weight;
+      }
+      if (weightSum == 0.) {
+        unresolved++;
+        continue;
+      }
+
+      // To the lattice units of this run, the velocity is interpolated and multiplied by the density again
+      rhoBar *= densityFactor/weightSum;
+      const T invRho = D::invRho(rhoBar);
+      const T rho = D::fullRho(rhoBar);
+      for (int a = 0; a < 3; a++) {
+        j[a] *= rho*velocityFactor/weightSum;
+      }
+      const T jSqr = j[0]*j[0] + j[1]*j[1] + j[2]*j[2];
+      // PiNeq = -2 rho cs2 S / omega, with the strain rate S per time step
+      const T piFactor = dtRatio/omegaOf(cell)/weightSum;
+      for (int k = 0; k < nPi; k++) {
+        strain[k] *= piFactor;
+      }
+      for (plint iPop = 0; iPop < D::q; iPop++) {
+        cell[iPop] = dynamicsTemplates<T,DESCRIPTOR>::bgk_ma2_equilibrium(iPop, rhoBar, invRho, j, jSqr)
+                   + offEquilibriumTemplates<T,DESCRIPTOR>::fromPiToFneq(iPop, strain);
+      }
+    }}}
+  }
+  lattice.getBlockCommunicator().duplicateOverlaps(lattice, modif::staticVariables);
+  delete shadowTau;
+
+  MPI_Allreduce(MPI_IN_PLACE, &unresolved, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+  if (unresolved) {
+    hlog << "(CoarseCheckpoint) (Warning) " << unresolved << " fluid nodes have no fluid checkpoint node around them and keep their initial value" << endl;
+  }
+  global.statistics.getCurrent().stop();
+}
+
+void CoarseCheckpoint::loadCells() {
+  if (!hemocell.cellfields) {
+    hlog << "(CoarseCheckpoint) (Error) The cellfields must be initialized before the cells can be loaded" << endl;
+    exit(1);
+  }
+  if (!(file_exists(directory + "particleField.dat") && file_exists(directory + "particleField.plb"))) {
+    hlog << "(CoarseCheckpoint) (Error) No particle field found in " << directory << endl;
+    exit(1);
+  }
+  hlog << "(CoarseCheckpoint) Loading the cells from " << directory << endl;
+  global.statistics.getCurrent()["coarseCheckpointCells"].start();
+  if (!shadow) {
+    createShadow();
+  }
+  HemoCellFields & cellfields = *hemocell.cellfields;
+
+  // Prepared as HemoCellFields::InitAfterLoadCheckpoint does, the particles are added while they are read
+  for (plint bid : shadowParticles->getLocalInfo().getBlocks()) {
+    HEMOCELL_PARTICLE_FIELD & pf = shadowParticles->getComponent(bid);
+    Box3D bulk;
+    shadowParticles->getSparseBlockStructure().getBulk(bid, bulk);
+    pf.setlocalDomain(bulk);
+    pf.cellFields = &cellfields;
+    pf.atomicBlockId = bid;
+    pf.atomicLattice = &shadow->getComponent(bid);
+    pf.envelopeSize = cellfields.envelopeSize;
+  }
+  plb::parallelIO::load(directory + "particleField", *shadowParticles, true);
+  // The bulks of both levels differ by up to ratio/2 at the faces, so the
+  // particles of a fine bulk can come from the envelope of the shadow block
+  for (plint bid : shadowParticles->getLocalInfo().getBlocks()) {
+    HEMOCELL_PARTICLE_FIELD & coarsePf = shadowParticles->getComponent(bid);
+    coarsePf.removeParticles_inverse(coarsePf.localDomain);
+  }
+  shadowParticles->getBlockCommunicator().duplicateOverlaps(*shadowParticles, modif::hemocell);
+
+  MultiParticleField3D<HEMOCELL_PARTICLE_FIELD> & particles = *cellfields.immersedParticles;
+  long maxCellId = -1;
+  long loaded = 0;
+  for (plint bid : shadowParticles->getLocalInfo().getBlocks()) {
+    HEMOCELL_PARTICLE_FIELD & coarsePf = shadowParticles->getComponent(bid);
+    HEMOCELL_PARTICLE_FIELD & pf = particles.getComponent(bid);
+    for (HemoCellParticle & particle : coarsePf.particles) {
+      HemoCellParticle::serializeValues_t sv = particle.sv;
+      for (int d = 0; d < 3; d++) {
+        sv.position[d] = ratio*sv.position[d] + origin[d];
+      }
+      // Every particle is taken by the one fine block whose bulk it lies in, periodic images fall outside all of them
+      if (!pf.isContainedABS(sv.position, pf.localDomain)) { continue; }
+      if (sv.celltype >= cellfields.size() || sv.vertexId >= cellfields[sv.celltype]->numVertex) {
+        cout << "(CoarseCheckpoint) (Error) Particle of cell " << sv.cellId << " does not fit the cell types of this run, "
+             << "they must have the same meshes as in the checkpoint" << endl;
+        exit(1);
+      }
+      sv.v *= velocityFactor;
+#if HEMOCELL_MATERIAL_INTEGRATION == 2
+      sv.vPrevious *= velocityFactor;
+#endif
+      sv.force = {0.,0.,0.};
+      sv.force_repulsion = {0.,0.,0.};
+      pf.addParticle(sv);
+      maxCellId = std::max(maxCellId, (long)sv.cellId);
+      loaded++;
+    }
+  }
+  delete shadowParticles;
+  shadowParticles = 0;
+
+  // The periodic images of the cells get ids beyond number_of_cells, which is counted from the .pos files otherwise
+  MPI_Allreduce(MPI_IN_PLACE, &maxCellId, 1, MPI_LONG, MPI_MAX, MPI_COMM_WORLD);
+  cellfields.number_of_cells = std::max(cellfields.number_of_cells, (int)(maxCellId + 1));
+
+  cellfields.syncEnvelopes();
+  cellfields.deleteIncompleteCells(true);
+
+  // Cells cut by the faces of the domain (or with vertices beyond them after the mapping) are incomplete and dropped
+  long kept = 0;
+  for (plint bid : particles.getLocalInfo().getBlocks()) {
+    HEMOCELL_PARTICLE_FIELD & pf = particles.getComponent(bid);
+    for (HemoCellParticle & particle : pf.particles) {
+      if (pf.isContainedABS(particle.sv.position, pf.localDomain)) { kept++; }
+    }
+  }
+  long counts[2] = {loaded, kept};
+  MPI_Allreduce(MPI_IN_PLACE, counts, 2, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+  hlog << "(CoarseCheckpoint) Loaded " << counts[1] << " particles";
+  if (counts[0] != counts[1]) {
+    hlog << ", (Warning) " << counts[0]-counts[1] << " particles of incomplete cells were dropped";
+  }
+  hlog << endl;
+  global.statistics.getCurrent().stop();
+}
+}
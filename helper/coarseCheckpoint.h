@@ -0,0 +1,100 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab
+in the University of Amsterdam. Any questions or remarks regarding this library
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef HEMO_COARSE_CHECKPOINT_H
+#define HEMO_COARSE_CHECKPOINT_H
+
+#include "constant_defaults.h"
+#include "array.h"
+
+#include "multiBlock/multiBlockLattice3D.h"
+#include "particles/multiParticleField3D.h"
+
+#include <string>
+
+namespace hemo {
+class HemoCell;
+
+/**
+ * Starts a case from the checkpoint of the same case at another resolution
+ * (usually a converged run at a larger dx), instead of from a fluid at rest and
+ * freshly packed cells. Used by HemoCell::loadCoarseCheckPoint().
+ *
+ * The checkpoint is read from its own directory, with the dx and dt it was run
+ * with (from its checkpoint.xml). Checkpoint node i lies at lattice position
+ * ratio*i + origin, with ratio = dx_checkpoint/dx. The default origin, 1 - ratio
+ * on every axis, is that of geometries voxelized with getFlagMatrixFromSTL,
+ * where node 1 lies on the lower bound of the STL file at any resolution.
+ *
+ * Fluid: the density, momentum and non equilibrium stress (times the relaxation
+ * frequency, so the strain rate) of the fluid checkpoint nodes around a fluid
+ * node are interpolated trilinearly, converted to the lattice units of this run
+ * and the node is set to the equilibrium plus the non equilibrium part. Solid
+ * checkpoint nodes are left out of the interpolation. The relaxation times of
+ * the interior nodes of the cells are read from the interior viscosity field of
+ * the checkpoint, when it has one.
+ *
+ * Cells: the particles keep their cell and vertex ids, their positions are
+ * mapped as the nodes and their velocities converted. The cell types must have
+ * the same meshes (number of vertices) as in the checkpoint run, the cells keep
+ * their shape and (physical) size, which the material model of this run then
+ * sees at its own resolution.
+ *
+ * The checkpoint is brought to the blocks of the lattice through a lattice and
+ * particle field at checkpoint resolution with the same block ids and mpi ranks
+ * as the lattice, so the interpolation is local to every block.
+ */
+class CoarseCheckpoint {
+public:
+  CoarseCheckpoint(HemoCell & hemocell_, std::string directory_);
+  ~CoarseCheckpoint();
+
+  /// Position of checkpoint node (0,0,0) on the lattice of this run
+  void setOrigin(hemo::Array<T,3> origin_);
+
+  /// Set the fluid nodes of the lattice from the checkpoint, the dynamics of the lattice must be defined
+  void loadFluid();
+  /// Add the cells of the checkpoint to the cellfields, the cell types must be added
+  void loadCells();
+
+  /// dx_checkpoint/dx
+  T getRatio() const { return ratio; }
+
+private:
+  void createShadow();
+
+  HemoCell & hemocell;
+  std::string directory;
+  /// Size, dx and dt of the checkpoint lattice
+  plb::plint n[3];
+  T dx, dt;
+  T ratio;
+  hemo::Array<T,3> origin;
+  /// Velocity and density (deviation) of the checkpoint in lattice units of this run
+  T velocityFactor, densityFactor;
+  /// Checkpoint lattice and particle field on the blocks (ids and ranks) of the lattice
+  plb::MultiBlockLattice3D<FLUID_T,DESCRIPTOR> * shadow = 0;
+  plb::MultiParticleField3D<HEMOCELL_PARTICLE_FIELD> * shadowParticles = 0;
+};
+}
+#endif
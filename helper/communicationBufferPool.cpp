@@ -0,0 +1,66 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "communicationBufferPool.h"
+
+namespace hemo {
+
+void CommunicationBufferPool::updateHighWater(std::size_t size, std::size_t & highWater) {
+  if (size > highWater) {
+    highWater = size;
+  }
+}
+
+std::vector<NoInitChar> & CommunicationBufferPool::getSendBuffer(int neighbour, std::size_t size) {
+  std::vector<NoInitChar> & buffer = buffers[neighbour].send;
+  buffer.resize(size);
+  updateHighWater(size, sendHighWater);
+  return buffer;
+}
+
+std::vector<NoInitChar> & CommunicationBufferPool::getRecvBuffer(int neighbour, std::size_t size) {
+  std::vector<NoInitChar> & buffer = buffers[neighbour].recv;
+  buffer.resize(size);
+  updateHighWater(size, recvHighWater);
+  return buffer;
+}
+
+char * CommunicationBufferPool::appendSendBuffer(int neighbour, std::size_t size) {
+  std::vector<NoInitChar> & buffer = buffers[neighbour].send;
+  std::size_t offset = buffer.size();
+  buffer.resize(offset + size);
+  updateHighWater(buffer.size(), sendHighWater);
+  return reinterpret_cast<char*>(&buffer[offset]);
+}
+
+void CommunicationBufferPool::reportStatistics(Profiler & profiler) {
+  std::size_t capacity = 0;
+  for (std::pair<const int,Buffers> & buffer_pair : buffers) {
+    capacity += buffer_pair.second.send.capacity() + buffer_pair.second.recv.capacity();
+  }
+  profiler.countMax(name + "SendHighWater", sendHighWater);
+  profiler.countMax(name + "RecvHighWater", recvHighWater);
+  profiler.countMax(name + "Capacity", capacity);
+}
+
+}
@@ -0,0 +1,82 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef HEMO_COMMUNICATION_BUFFER_POOL_H
+#define HEMO_COMMUNICATION_BUFFER_POOL_H
+
+#include "constant_defaults.h"
+#include "profiler.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace hemo {
+/**
+ * Persistent send and receive buffers, one pair per neighbour (usually the
+ * MPI rank, but any integer key works). The buffers are resized on every
+ * request, but their capacity only ever grows, so after the first iterations
+ * the communication does not touch the allocator anymore.
+ *
+ * The largest buffer sizes (high-water marks) can be written to a Profiler
+ * with reportStatistics().
+ */
+class CommunicationBufferPool {
+public:
+  CommunicationBufferPool(std::string name_) : name(name_) {}
+
+  /// Send buffer of a neighbour, resized to size bytes (content is not initialized)
+  std::vector<NoInitChar> & getSendBuffer(int neighbour, std::size_t size);
+  /// Receive buffer of a neighbour, resized to size bytes (content is not initialized)
+  std::vector<NoInitChar> & getRecvBuffer(int neighbour, std::size_t size);
+  /// Current buffers of a neighbour, as they were left by the last call
+  std::vector<NoInitChar> & getSendBuffer(int neighbour) { return buffers[neighbour].send; }
+  std::vector<NoInitChar> & getRecvBuffer(int neighbour) { return buffers[neighbour].recv; }
+  /// Grow the send buffer of a neighbour with size bytes, returns a pointer to the new part
+  char * appendSendBuffer(int neighbour, std::size_t size);
+
+  /// Typed access for non-character data (e.g. cellIds), size is in elements
+  template<typename D>
+  D * getSendBufferAs(int neighbour, std::size_t size) {
+    return reinterpret_cast<D*>(getSendBuffer(neighbour, size*sizeof(D)).data());
+  }
+  template<typename D>
+  D * getRecvBufferAs(int neighbour, std::size_t size) {
+    return reinterpret_cast<D*>(getRecvBuffer(neighbour, size*sizeof(D)).data());
+  }
+
+  /// Write the high-water marks (in bytes) and the total capacity as counters to the profiler
+  void reportStatistics(Profiler & profiler);
+
+private:
+  struct Buffers {
+    std::vector<NoInitChar> send, recv;
+  };
+  void updateHighWater(std::size_t size, std::size_t & highWater);
+
+  std::string name;
+  std::map<int,Buffers> buffers;
+  std::size_t sendHighWater = 0, recvHighWater = 0;
+};
+}
+#endif
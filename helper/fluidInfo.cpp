@@ -31,9 +31,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 namespace hemo {
 
 void GatherFluidVelocity::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
-    BlockLattice3D<T,DESCRIPTOR>* ff = dynamic_cast<BlockLattice3D<T,DESCRIPTOR>*>(blocks[0]);
+    BlockLattice3D<FLUID_T,DESCRIPTOR>* ff = dynamic_cast<BlockLattice3D<FLUID_T,DESCRIPTOR>*>(blocks[0]);
     HEMOCELL_PARTICLE_FIELD* pf = dynamic_cast<HEMOCELL_PARTICLE_FIELD*>(blocks[1]);
-    plb::Array<T,3> vel_vec;
+    plb::Array<FLUID_T,3> vel_vec;
     T vel;
     T min=0,max=0,avg=0.;
     
@@ -64,7 +64,7 @@ void GatherFluidVelocity::processGenericBlocks(Box3D domain, std::vector<AtomicB
     gatherValues[pf->atomicBlockId].ncells = ncells;
 }
 void GatherFluidForce::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
-    BlockLattice3D<T,DESCRIPTOR>* ff = dynamic_cast<BlockLattice3D<T,DESCRIPTOR>*>(blocks[0]);
+    BlockLattice3D<FLUID_T,DESCRIPTOR>* ff = dynamic_cast<BlockLattice3D<FLUID_T,DESCRIPTOR>*>(blocks[0]);
     HEMOCELL_PARTICLE_FIELD* pf = dynamic_cast<HEMOCELL_PARTICLE_FIELD*>(blocks[1]);
     hemo::Array<T,3> vel_vec;
     T vel;
@@ -152,7 +152,7 @@ FluidStatistics FluidInfo::calculateForceStatistics(HemoCell* hemocell) {
 
   plb::setExternalVector(*hemocell->lattice, (*hemocell->lattice).getBoundingBox(),
           DESCRIPTOR<T>::ExternalField::forceBeginsAt,
-          plb::Array<T, DESCRIPTOR<T>::d>(0.0, 0.0, 0.0));
+          plb::Array<FLUID_T, DESCRIPTOR<FLUID_T>::d>(0.0, 0.0, 0.0));
   
   return result;
 }
@@ -135,13 +135,13 @@ void printHeader()
 #include "palabos3D.hh"
 
 namespace hemo {
-void boundaryFromFlagMatrix(plb::MultiBlockLattice3D<T,DESCRIPTOR> * fluid, plb::MultiScalarField3D<int> * flagMatrix, bool partOfpreInlet) {
+void boundaryFromFlagMatrix(plb::MultiBlockLattice3D<FLUID_T,DESCRIPTOR> * fluid, plb::MultiScalarField3D<int> * flagMatrix, bool partOfpreInlet) {
   plb::Box3D domain2 = flagMatrix->getBoundingBox();
   for (int x  = domain2.x0-1 ; x <= domain2.x1+1 ; x++) {
    for (int y  = domain2.y0-1 ; y <= domain2.y1+1 ; y++) {
     for (int z  = domain2.z0-1 ; z <= domain2.z1+1 ; z++) {
       if ((x == domain2.x0-1 || y == domain2.y0-1 || z == domain2.z0-1 || x == domain2.x1+1 || y == domain2.y1+1 || z == domain2.z1+1) && !partOfpreInlet ) {
-        defineDynamics(*fluid,x,y,z,new plb::BounceBack<T,DESCRIPTOR>(1.));
+        defineDynamics(*fluid,x,y,z,new plb::BounceBack<FLUID_T,DESCRIPTOR>(1.));
       }
     }
    }
@@ -151,7 +151,7 @@ void boundaryFromFlagMatrix(plb::MultiBlockLattice3D<T,DESCRIPTOR> * fluid, plb:
    for (int y  = domain2.y0 ; y <= domain2.y1 ; y++) {
     for (int z  = domain2.z0 ; z <= domain2.z1 ; z++) {
       if (flagMatrix->get(x,y,z) == 0 && !partOfpreInlet) {
-        defineDynamics(*fluid,x,y,z,new plb::BounceBack<T,DESCRIPTOR>(1.));
+        defineDynamics(*fluid,x,y,z,new plb::BounceBack<FLUID_T,DESCRIPTOR>(1.));
       }
     }
    }
@@ -0,0 +1,340 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "gridRefinement.h"
+#include "hemocell.h"
+#include "palabos3D.h"
+#include "palabos3D.hh"
+
+#include <set>
+
+namespace hemo {
+using namespace plb;
+
+typedef DESCRIPTOR<T> D;
+
+namespace {
+inline bool isBounceBack(Cell<FLUID_T,DESCRIPTOR> & cell) {
+  static const int bbId = BounceBack<FLUID_T,DESCRIPTOR>().getId();
+  return cell.getDynamics().getId() == bbId;
+}
+
+/// Write f into cell with the non equilibrium part scaled by factor
+inline void rescaleNonEquilibrium(T (&f)[D::q], T factor, Cell<FLUID_T,DESCRIPTOR> & cell) {
+  T rhoBar = 0.;
+  plb::Array<T,3> j(0.,0.,0.);
+  for (plint iPop = 0 ; iPop < D::q ; iPop++) {
+    rhoBar += f[iPop];
+    j[0] += D::c[iPop][0]*f[iPop];
+    j[1] += D::c[iPop][1]*f[iPop];
+    j[2] += D::c[iPop][2]*f[iPop];
+  }
+  const T invRho = D::invRho(rhoBar);
+  const T jSqr = j[0]*j[0] + j[1]*j[1] + j[2]*j[2];
+  for (plint iPop = 0 ; iPop < D::q ; iPop++) {
+    const T feq = dynamicsTemplates<T,DESCRIPTOR>::bgk_ma2_equilibrium(iPop, rhoBar, invRho, j, jSqr);
+    cell[iPop] = feq + factor*(f[iPop] - feq);
+  }
+}
+
+inline plint flatIndex(BlockLattice3D<FLUID_T,DESCRIPTOR> const & block, plint x, plint y, plint z) {
+  return (x*block.getNy() + y)*block.getNz() + z;
+}
+}
+
+GridRefinement::GridRefinement(HemoCell & hemocell_, MultiBlockLattice3D<FLUID_T,DESCRIPTOR> & coarse_, Dot3D origin_) :
+  hemocell(hemocell_), coarse(coarse_), origin(origin_)
+{
+  if (!hemocell.lattice) {
+    hlog << "(GridRefinement) (Error) The fine lattice must be initialized before the grid refinement is set up" << endl;
+    exit(1);
+  }
+  Box3D fine = hemocell.lattice->getBoundingBox();
+  if (fine.getNx()%2 == 0 || fine.getNy()%2 == 0 || fine.getNz()%2 == 0) {
+    hlog << "(GridRefinement) (Error) Every dimension of the fine lattice must be odd, so its faces lie on coarse nodes" << endl;
+    exit(1);
+  }
+  if (fine.getNx() < 5 || fine.getNy() < 5 || fine.getNz() < 5) {
+    hlog << "(GridRefinement) (Error) The fine lattice must be at least 5 nodes wide in every direction" << endl;
+    exit(1);
+  }
+  for (int axis = 0 ; axis < 3 ; axis++) {
+    if (hemocell.lattice->periodicity().get(axis)) {
+      hlog << "(GridRefinement) (Error) The fine lattice cannot be periodic (axis " << axis << ")" << endl;
+      exit(1);
+    }
+  }
+  const plint kx = fine.getNx()/2, ky = fine.getNy()/2, kz = fine.getNz()/2;
+  Box3D patch(origin.x, origin.x + kx, origin.y, origin.y + ky, origin.z, origin.z + kz);
+  if (!contained(patch, coarse.getBoundingBox())) {
+    hlog << "(GridRefinement) (Error) The fine lattice does not fit in the coarse lattice at the given origin" << endl;
+    exit(1);
+  }
+  restrictionRegion = patch.enlarge(-1);
+
+  hlog << "(GridRefinement) Fine lattice covers coarse nodes (" << patch.x0 << "," << patch.y0 << "," << patch.z0
+       << ") - (" << patch.x1 << "," << patch.y1 << "," << patch.z1 << "), coarse tau: " << coarseTau() << endl;
+  createShadow();
+}
+
+GridRefinement::~GridRefinement() {
+  delete shadow;
+}
+
+T GridRefinement::coarseTau() {
+  return (param::tau - 0.5)/2. + 0.5;
+}
+
+T GridRefinement::coarseForce(T fineForce) {
+  // F = dx/dt^2 in lattice units, both are doubled
+  return 2.*fineForce;
+}
+
+Box3D GridRefinement::toCoarse(Box3D fineBox) const {
+  return Box3D(origin.x + (fineBox.x0 + 1)/2, origin.x + fineBox.x1/2,
+               origin.y + (fineBox.y0 + 1)/2, origin.y + fineBox.y1/2,
+               origin.z + (fineBox.z0 + 1)/2, origin.z + fineBox.z1/2);
+}
+
+void GridRefinement::createShadow() {
+  delete shadow;
+  previous.clear();
+
+  MultiBlockManagement3D const & fineManagement = hemocell.lattice->getMultiBlockManagement();
+  SparseBlockStructure3D structure(coarse.getBoundingBox());
+  map<plint,plint> blockToMpi;
+  for (auto const & bulk : hemocell.lattice->getSparseBlockStructure().getBulks()) {
+    Box3D projected = toCoarse(bulk.second);
+    if (projected.getNx() < 1 || projected.getNy() < 1 || projected.getNz() < 1) {
+      hlog << "(GridRefinement) (Error) Atomic block " << bulk.first << " of the fine lattice contains no coarse node, use larger atomic blocks" << endl;
+      exit(1);
+    }
+    structure.addBlock(projected, projected, bulk.first);
+    blockToMpi[bulk.first] = fineManagement.getThreadAttribution().getMpiProcess(bulk.first);
+  }
+  shadow = new MultiBlockLattice3D<FLUID_T,DESCRIPTOR>(
+            MultiBlockManagement3D(structure,
+                                   new ExplicitThreadAttribution(blockToMpi),
+                                   fineManagement.getEnvelopeWidth(),
+                                   coarse.getMultiBlockManagement().getRefinementLevel()),
+            defaultMultiBlockPolicy3D().getBlockCommunicator(),
+            defaultMultiBlockPolicy3D().getCombinedStatistics(),
+            defaultMultiBlockPolicy3D().getMultiCellAccess<FLUID_T, DESCRIPTOR>(),
+            new GuoExternalForceBGKdynamics<FLUID_T, DESCRIPTOR>(1.0/coarseTau()));
+  shadow->toggleInternalStatistics(false);
+
+  // The dynamics are only needed to recognize the solid nodes of the coarse lattice
+  copyNonLocal(coarse, *shadow, shadow->getBoundingBox(), modif::dataStructure);
+  shadow->duplicateOverlaps(modif::dataStructure);
+}
+
+void GridRefinement::refreshShadow() {
+  copyNonLocal(coarse, *shadow, shadow->getBoundingBox(), modif::staticVariables);
+  shadow->duplicateOverlaps(modif::staticVariables);
+}
+
+void GridRefinement::beforeFineStep() {
+  if (hemocell.iter % 2 != 0) {
+    return;
+  }
+  global.statistics.getCurrent()["coarseCollideAndStream"].start();
+  for (plint bid : shadow->getLocalInfo().getBlocks()) {
+    BlockLattice3D<FLUID_T,DESCRIPTOR> & block = shadow->getComponent(bid);
+    const plint nCells = block.getNx()*block.getNy()*block.getNz();
+    Cell<FLUID_T,DESCRIPTOR> * cells = &block.get(0,0,0);
+    vector<T> & populations = previous[bid];
+    populations.resize(nCells*D::q);
+    for (plint i = 0 ; i < nCells ; i++) {
+      for (plint iPop = 0 ; iPop < D::q ; iPop++) {
+        populations[i*D::q + iPop] = cells[i][iPop];
+      }
+    }
+  }
+  coarse.collideAndStream();
+  refreshShadow();
+  global.statistics.getCurrent().stop();
+}
+
+void GridRefinement::afterFineStep() {
+  global.statistics.getCurrent()["gridRefinement"].start();
+  // Time of the fine lattice within the current coarse time step
+  const T s = (hemocell.iter % 2 == 0) ? 0.5 : 1.;
+  const T factor = param::tau/(2.*coarseTau());
+  for (plint bid : hemocell.lattice->getLocalInfo().getBlocks()) {
+    prolongate(bid, s, factor);
+  }
+  if (hemocell.iter % 2 != 0) {
+    restrictToCoarse();
+  }
+  global.statistics.getCurrent().stop();
+}
+
+void GridRefinement::prolongate(plint blockId, T s, T factor) {
+  BlockLattice3D<FLUID_T,DESCRIPTOR> & fineBlock = hemocell.lattice->getComponent(blockId);
+  BlockLattice3D<FLUID_T,DESCRIPTOR> & shadowBlock = shadow->getComponent(blockId);
+  const Dot3D fl = fineBlock.getLocation(), sl = shadowBlock.getLocation();
+  const Box3D shadowBox = shadowBlock.getBoundingBox();
+  const Box3D fineBox = hemocell.lattice->getBoundingBox();
+  // The block including its envelope, so the envelopes stay consistent with the bulk
+  const Box3D blockBox = fineBlock.getBoundingBox().shift(fl.x,fl.y,fl.z);
+  // Right after a redistribution the start of the coarse step is not known, the end is used
+  const bool interpolateInTime = s < 1. && previous.count(blockId);
+  const T * populations = interpolateInTime ? previous[blockId].data() : 0;
+
+  const Box3D faces[6] = {
+    Box3D(fineBox.x0,fineBox.x0,fineBox.y0,fineBox.y1,fineBox.z0,fineBox.z1),
+    Box3D(fineBox.x1,fineBox.x1,fineBox.y0,fineBox.y1,fineBox.z0,fineBox.z1),
+    Box3D(fineBox.x0,fineBox.x1,fineBox.y0,fineBox.y0,fineBox.z0,fineBox.z1),
+    Box3D(fineBox.x0,fineBox.x1,fineBox.y1,fineBox.y1,fineBox.z0,fineBox.z1),
+    Box3D(fineBox.x0,fineBox.x1,fineBox.y0,fineBox.y1,fineBox.z0,fineBox.z0),
+    Box3D(fineBox.x0,fineBox.x1,fineBox.y0,fineBox.y1,fineBox.z1,fineBox.z1)
+  };
+  for (const Box3D & face : faces) {
+    Box3D domain;
+    if (!intersect(face, blockBox, domain)) { continue; }
+    for (plint x = domain.x0 ; x <= domain.x1 ; x++) {
+    for (plint y = domain.y0 ; y <= domain.y1 ; y++) {
+    for (plint z = domain.z0 ; z <= domain.z1 ; z++) {
+      Cell<FLUID_T,DESCRIPTOR> & cell = fineBlock.get(x-fl.x,y-fl.y,z-fl.z);
+      if (isBounceBack(cell)) { continue; }
+
+      // Trilinear interpolation from the fluid coarse nodes around the fine node
+      T f[D::q] = {};
+      T weightSum = 0.;
+      for (plint cx = origin.x + x/2 ; cx <= origin.x + (x+1)/2 ; cx++) {
+      for (plint cy = origin.y + y/2 ; cy <= origin.y + (y+1)/2 ; cy++) {
+      for (plint cz = origin.z + z/2 ; cz <= origin.z + (z+1)/2 ; cz++) {
+        const plint lx = cx-sl.x, ly = cy-sl.y, lz = cz-sl.z;
+        if (!contained(lx,ly,lz,shadowBox)) { continue; }
+        Cell<FLUID_T,DESCRIPTOR> & coarseCell = shadowBlock.get(lx,ly,lz);
+        if (isBounceBack(coarseCell)) { continue; }
+        const T weight = (x%2 ? 0.5 : 1.)*(y%2 ? 0.5 : 1.)*(z%2 ? 0.5 : 1.);
+        if (interpolateInTime) {
+          const T * before = populations + flatIndex(shadowBlock,lx,ly,lz)*D::q;
+          for (plint iPop = 0 ; iPop < D::q ; iPop++) {
+            f[iPop] += weight*((1.-s)*before[iPop] + s*coarseCell[iPop]);
+          }
+        } else {
+          for (plint iPop = 0 ; iPop < D::q ; iPop++) {
+            f[iPop] += weight*coarseCell[iPop];
+          }
+        }
+        weightSum += weight;
+      }}}
+      if (weightSum == 0.) { continue; }
+      for (plint iPop = 0 ; iPop < D::q ; iPop++) {
+        f[iPop] /= weightSum;
+      }
+      rescaleNonEquilibrium(f, factor, cell);
+    }}}
+  }
+}
+
+void GridRefinement::restrictToCoarse() {
+  const T factor = 2.*coarseTau()/param::tau;
+  for (plint bid : shadow->getLocalInfo().getBlocks()) {
+    BlockLattice3D<FLUID_T,DESCRIPTOR> & shadowBlock = shadow->getComponent(bid);
+    BlockLattice3D<FLUID_T,DESCRIPTOR> & fineBlock = hemocell.lattice->getComponent(bid);
+    const Dot3D fl = fineBlock.getLocation(), sl = shadowBlock.getLocation();
+    Box3D domain;
+    if (!intersect(shadow->getSparseBlockStructure().getBulks().at(bid), restrictionRegion, domain)) { continue; }
+    for (plint cx = domain.x0 ; cx <= domain.x1 ; cx++) {
+    for (plint cy = domain.y0 ; cy <= domain.y1 ; cy++) {
+    for (plint cz = domain.z0 ; cz <= domain.z1 ; cz++) {
+      Cell<FLUID_T,DESCRIPTOR> & coarseCell = shadowBlock.get(cx-sl.x,cy-sl.y,cz-sl.z);
+      Cell<FLUID_T,DESCRIPTOR> & fineCell = fineBlock.get(2*(cx-origin.x)-fl.x,2*(cy-origin.y)-fl.y,2*(cz-origin.z)-fl.z);
+      if (isBounceBack(coarseCell) || isBounceBack(fineCell)) { continue; }
+      T f[D::q];
+      for (plint iPop = 0 ; iPop < D::q ; iPop++) {
+        f[iPop] = fineCell[iPop];
+      }
+      rescaleNonEquilibrium(f, factor, coarseCell);
+    }}}
+  }
+  copyNonLocal(*shadow, coarse, restrictionRegion, modif::staticVariables);
+  coarse.duplicateOverlaps(modif::staticVariables);
+  shadow->duplicateOverlaps(modif::staticVariables);
+}
+
+void GridRefinement::removeCellsInCouplingBand() {
+  global.statistics.getCurrent()["gridRefinementCellBand"].start();
+  const Box3D fineBox = hemocell.lattice->getBoundingBox();
+  const T lower[3] = {fineBox.x0 + couplingBand, fineBox.y0 + couplingBand, fineBox.z0 + couplingBand};
+  const T upper[3] = {fineBox.x1 - couplingBand, fineBox.y1 - couplingBand, fineBox.z1 - couplingBand};
+  plint removed = 0;
+  for (plint bid : hemocell.cellfields->immersedParticles->getLocalInfo().getBlocks()) {
+    HemoCellParticleField & pf = hemocell.cellfields->immersedParticles->getComponent(bid);
+    // Every block holding a part of a cell holds all of its vertices in its envelope, so all of them remove the cell
+    std::set<plint> cellsInBand;
+    for (const HemoCellParticle & particle : pf.particles) {
+      for (int axis = 0 ; axis < 3 ; axis++) {
+        if (particle.sv.position[axis] < lower[axis] || particle.sv.position[axis] > upper[axis]) {
+          if (cellsInBand.insert(particle.sv.cellId).second && pf.isContainedABS(particle.sv.position,pf.localDomain)) {
+            cout << "(GridRefinement) (Warning) Cell " << particle.sv.cellId << " entered the coupling band of the fine lattice and is removed" << endl;
+            removed++;
+          }
+          break;
+        }
+      }
+    }
+    if (cellsInBand.empty()) { continue; }
+    for (HemoCellParticle & particle : pf.particles) {
+      if (cellsInBand.count(particle.sv.cellId)) {
+        particle.setTag(1);
+      }
+    }
+    pf.removeParticles(1);
+  }
+  if (removed) {
+    global.statistics.getCurrent().count("cellsRemovedAtCouplingBand",removed);
+  }
+  global.statistics.getCurrent().stop();
+}
+
+void GridRefinement::redistribute() {
+  createShadow();
+  refreshShadow();
+}
+
+void GridRefinement::checkpoint() {
+  std::string & outDir = hemo::global.checkpointDirectory;
+  mkpath(outDir.c_str(), 0777);
+  if (global::mpi().isMainProcessor()) {
+    renameFileToDotOld(outDir + "coarse_lattice.dat");
+    renameFileToDotOld(outDir + "coarse_lattice.plb");
+  }
+  global::mpi().barrier();
+  plb::parallelIO::save(coarse, outDir + "coarse_lattice", true);
+}
+
+void GridRefinement::restore() {
+  std::string & outDir = hemo::global.checkpointDirectory;
+  if (!(file_exists(outDir + "coarse_lattice.dat") && file_exists(outDir + "coarse_lattice.plb"))) {
+    hlog << "(GridRefinement) (Error) No coarse lattice found in the checkpoint directory" << endl;
+    exit(1);
+  }
+  plb::parallelIO::load(outDir + "coarse_lattice", coarse, true);
+  previous.clear();
+  refreshShadow();
+}
+}
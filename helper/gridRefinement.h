@@ -0,0 +1,113 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef HEMO_GRID_REFINEMENT_H
+#define HEMO_GRID_REFINEMENT_H
+
+#include "constant_defaults.h"
+
+#include "multiBlock/multiBlockLattice3D.h"
+
+#include <map>
+#include <vector>
+
+namespace hemo {
+class HemoCell;
+
+/**
+ * Static two level grid refinement: HemoCell::lattice is a fine patch (where the
+ * cells live) embedded in a coarse lattice of half the resolution that covers
+ * the rest of the domain. The coarse lattice is created by the case with
+ * coarseTau() as relaxation time and coarseForce() as body force, the fine
+ * lattice keeps the parameters of the config file.
+ *
+ * Acoustic scaling is used (dx and dt are doubled on the coarse lattice), so
+ * density and velocity are the same on both levels and the coarse lattice does
+ * one time step for every two fine time steps. Fine node (x,y,z) coincides with
+ * coarse node origin + (x,y,z)/2 when all of x,y,z are even. The faces of the
+ * fine lattice must be on coarse nodes, so every dimension has to be odd, and
+ * the fine lattice cannot be periodic.
+ *
+ * Coupling, called from HemoCell::iterate():
+ *   - beforeFineStep(): every second fine step, the coarse lattice is advanced
+ *   - afterFineStep(): the outer layer of fine nodes is set from the coarse
+ *     populations, interpolated in space (trilinear) and time (linear), with the
+ *     non equilibrium part rescaled by tau_f/(2 tau_c). After the second fine
+ *     step the coarse nodes inside the patch are set from the fine nodes on top
+ *     of them, with the non equilibrium part rescaled by 2 tau_c/tau_f.
+ *   - removeCellsInCouplingBand(): cells with a vertex closer than couplingBand
+ *     to the faces of the fine lattice are removed, so the IBM kernel never
+ *     reaches the interface nodes that are overwritten from the coarse lattice.
+ *
+ * The coarse populations are brought to the fine blocks through a shadow
+ * lattice at coarse resolution with the same block ids and mpi ranks as the
+ * fine lattice, so the interpolation itself is local to every block.
+ */
+class GridRefinement {
+public:
+  /// origin is the coarse node that coincides with fine node (0,0,0)
+  GridRefinement(HemoCell & hemocell_, plb::MultiBlockLattice3D<FLUID_T,DESCRIPTOR> & coarse_, plb::Dot3D origin_);
+  ~GridRefinement();
+
+  /// Relaxation time of the coarse lattice for param::tau on the fine lattice
+  static T coarseTau();
+  /// Body force (lbm units) on the coarse lattice for a force of fineForce on the fine lattice
+  static T coarseForce(T fineForce);
+
+  /// Advance the coarse lattice when the fine lattice starts a new pair of time steps
+  void beforeFineStep();
+  /// Set the fine interface from the coarse lattice and, at the end of a pair, the coarse patch from the fine lattice
+  void afterFineStep();
+
+  /// Remove the cells that entered the coupling band, after the particles are synced
+  void removeCellsInCouplingBand();
+
+  /// Distance (fine lattice units) from the faces of the fine lattice that the vertices of the cells must keep
+  static constexpr T couplingBand = 2.;
+
+  /// The fine lattice was redistributed, rebuild the shadow lattice
+  void redistribute();
+  /// Save/load the coarse lattice next to the fine lattice in the checkpoint directory
+  void checkpoint();
+  void restore();
+
+  plb::MultiBlockLattice3D<FLUID_T,DESCRIPTOR> & getCoarseLattice() { return coarse; }
+
+private:
+  void createShadow();
+  void refreshShadow();
+  plb::Box3D toCoarse(plb::Box3D fineBox) const;
+  void prolongate(plb::plint blockId, T s, T factor);
+  void restrictToCoarse();
+
+  HemoCell & hemocell;
+  plb::MultiBlockLattice3D<FLUID_T,DESCRIPTOR> & coarse;
+  plb::Dot3D origin;
+  /// Coarse nodes inside the patch that are restricted from the fine lattice
+  plb::Box3D restrictionRegion;
+  plb::MultiBlockLattice3D<FLUID_T,DESCRIPTOR> * shadow = 0;
+  /// Populations of the shadow blocks at the start of the current coarse time step
+  std::map<plb::plint,std::vector<T>> previous;
+};
+}
+#endif
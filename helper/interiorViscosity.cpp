@@ -27,6 +27,20 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "palabos3D.hh"
 
 namespace hemo {
+  InteriorViscosityDynamics::InteriorViscosityDynamics(BlockLattice3D<FLUID_T,DESCRIPTOR> & block) :
+    GuoExternalForceBGKdynamics<FLUID_T,DESCRIPTOR>(block.getBackgroundDynamics().getOmega())
+  {
+    // Start of the cell storage, dense or indirect (SparseFluidStorage)
+    ImplicitGrid3D<FLUID_T,DESCRIPTOR> const & grid = block.getImplicitGrid();
+    storage = &block.get(0,0,0) - (grid.indirection ? grid.indirection[0] : 0);
+    omegas.resize(grid.indirection ? grid.numCells : block.getNx()*block.getNy()*block.getNz(), this->getOmega());
+  }
+
+  void InteriorViscosityDynamics::collide(Cell<FLUID_T,DESCRIPTOR> & cell, BlockStatistics & statistics) {
+    this->setOmega(omegas[&cell - storage]);
+    GuoExternalForceBGKdynamics<FLUID_T,DESCRIPTOR>::collide(cell,statistics);
+  }
+
   InteriorViscosityHelper::InteriorViscosityHelper(HemoCellFields & cellFields_) : cellFields(cellFields_) {
     //Create bindingfield with same properties as fluid field underlying the particleField.
     multiInteriorViscosityField = new plb::MultiScalarField3D<T>(
@@ -50,10 +64,27 @@ namespace hemo {
       HemoCellParticleField & pf = cellFields.immersedParticles->getComponent(bId);
       pf.interiorViscosityField = &multiInteriorViscosityField->getComponent(bId);
     }
+    createDynamics();
   }
   
   InteriorViscosityHelper::~InteriorViscosityHelper() {
     delete multiInteriorViscosityField;
+    for (InteriorViscosityDynamics * dynamics : blockDynamics) {
+      delete dynamics;
+    }
+  }
+
+  void InteriorViscosityHelper::createDynamics() {
+    releaseDynamics();
+    for (InteriorViscosityDynamics * dynamics : blockDynamics) {
+      delete dynamics;
+    }
+    blockDynamics.clear();
+    for (const plint & bId : cellFields.immersedParticles->getLocalInfo().getBlocks()) {
+      HemoCellParticleField & pf = cellFields.immersedParticles->getComponent(bId);
+      pf.interiorViscosityDynamics = new InteriorViscosityDynamics(*pf.atomicLattice);
+      blockDynamics.push_back(pf.interiorViscosityDynamics);
+    }
   }
     
   void InteriorViscosityHelper::checkpoint() {
@@ -86,12 +117,16 @@ namespace hemo {
     }
     
     plb::parallelIO::load(outDir + "internalViscosity",*get(cellFields).multiInteriorViscosityField,true);
+    get(cellFields).createDynamics();
     get(cellFields).refillBindingSites();
   }  
   
   void InteriorViscosityHelper::add(HemoCellParticleField & pf, const Dot3D & internalPoint, T tau) {
       pf.internalPoints.insert(internalPoint);
       pf.interiorViscosityField->get(internalPoint.x,internalPoint.y,internalPoint.z) = tau;
+      Cell<FLUID_T,DESCRIPTOR> & cell = pf.atomicLattice->get(internalPoint.x,internalPoint.y,internalPoint.z);
+      pf.interiorViscosityDynamics->setTau(cell,tau);
+      cell.attributeDynamics(pf.interiorViscosityDynamics);
   }
   
   void InteriorViscosityHelper::add(HemoCellParticleField & pf, const vector<Dot3D> & internalPoints, T tau) {
@@ -103,6 +138,7 @@ namespace hemo {
   void InteriorViscosityHelper::remove(HemoCellParticleField & pf, const Dot3D & internalPoint) {
     pf.internalPoints.erase(internalPoint);
     pf.interiorViscosityField->get(internalPoint.x,internalPoint.y,internalPoint.z) = 0;
+    pf.atomicLattice->get(internalPoint.x,internalPoint.y,internalPoint.z).attributeDynamics(&pf.atomicLattice->getBackgroundDynamics());
   }
   
   void InteriorViscosityHelper::remove(HemoCellParticleField & pf, const vector<Dot3D> & internalPoints) {
@@ -114,9 +150,21 @@ namespace hemo {
   void InteriorViscosityHelper::empty(HemoCellParticleField & pf) {
     for (const Dot3D & internalPoint: pf.internalPoints) {
       pf.interiorViscosityField->get(internalPoint.x,internalPoint.y,internalPoint.z) = 0;
+      pf.atomicLattice->get(internalPoint.x,internalPoint.y,internalPoint.z).attributeDynamics(&pf.atomicLattice->getBackgroundDynamics());
     }
     pf.internalPoints.clear();
   }
+
+  void InteriorViscosityHelper::releaseDynamics() {
+    // The field keeps the interior nodes, redistribute() finds them again
+    for (const plint & bId : cellFields.immersedParticles->getLocalInfo().getBlocks()) {
+      HemoCellParticleField & pf = cellFields.immersedParticles->getComponent(bId);
+      for (const Dot3D & internalPoint: pf.internalPoints) {
+        pf.atomicLattice->get(internalPoint.x,internalPoint.y,internalPoint.z).attributeDynamics(&pf.atomicLattice->getBackgroundDynamics());
+      }
+      pf.internalPoints.clear();
+    }
+  }
   
   void InteriorViscosityHelper::refillBindingSites() {
     for (const plint & bId : cellFields.immersedParticles->getLocalInfo().getBlocks()) {
@@ -127,16 +175,45 @@ namespace hemo {
         for (int y = domain.y0; y <= domain.y1; y++) {
           for (int z = domain.z0; z <= domain.z1; z++) {
             if(bf.get(x,y,z)) {
-              pf.internalPoints.insert({x,y,z});
-              
-              //WARNING this _can_ memory leak, so you should be ok if this is only called one time (from checkpointing)
-              plb::Dynamics<T,DESCRIPTOR>* dynamic = cellFields.lattice->getBackgroundDynamics().clone();
-              dynamic->setOmega(1.0/bf.get(x,y,z));
-              pf.atomicLattice->get(x,y,z).attributeDynamics(dynamic);
+              // After loading or moving the lattice every node owns a copy of its dynamics
+              Dynamics<FLUID_T,DESCRIPTOR> * previous = &pf.atomicLattice->get(x,y,z).getDynamics();
+              if (previous != &pf.atomicLattice->getBackgroundDynamics() && previous != pf.interiorViscosityDynamics) {
+                delete previous;
+              }
+              add(pf,{x,y,z},bf.get(x,y,z));
             }
           }
         }
       }
     }
   }
+
+  void InteriorViscosityHelper::redistribute() {
+    plb::MultiScalarField3D<T> * oldField = multiInteriorViscosityField;
+    multiInteriorViscosityField = new plb::MultiScalarField3D<T>(
+            MultiBlockManagement3D (
+                *cellFields.hemocell.lattice->getSparseBlockStructure().clone(),
+                cellFields.hemocell.lattice->getMultiBlockManagement().getThreadAttribution().clone(),
+                cellFields.hemocell.lattice->getMultiBlockManagement().getEnvelopeWidth(),
+                cellFields.hemocell.lattice->getMultiBlockManagement().getRefinementLevel()),
+                defaultMultiBlockPolicy3D().getBlockCommunicator(),                
+                defaultMultiBlockPolicy3D().getCombinedStatistics(),
+                defaultMultiBlockPolicy3D().getMultiScalarAccess<T>(),
+                0);
+    multiInteriorViscosityField->periodicity().toggle(0,cellFields.hemocell.lattice->periodicity().get(0));
+    multiInteriorViscosityField->periodicity().toggle(1,cellFields.hemocell.lattice->periodicity().get(1));
+    multiInteriorViscosityField->periodicity().toggle(2,cellFields.hemocell.lattice->periodicity().get(2));
+
+    copyNonLocal(*oldField,*multiInteriorViscosityField,oldField->getBoundingBox(),modif::staticVariables);
+    multiInteriorViscosityField->duplicateOverlaps(modif::staticVariables);
+    delete oldField;
+
+    for (const plint & bId : multiInteriorViscosityField->getLocalInfo().getBlocks()) {
+      HemoCellParticleField & pf = cellFields.immersedParticles->getComponent(bId);
+      pf.interiorViscosityField = &multiInteriorViscosityField->getComponent(bId);
+    }
+    //The interior nodes were released before the lattice was moved, attribute them again
+    createDynamics();
+    refillBindingSites();
+  }
 }
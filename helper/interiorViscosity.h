@@ -26,8 +26,49 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "hemoCellParticleField.h"
 #include "multiBlock/multiDataField3D.h"
+#include "basicDynamics/externalForceDynamics.h"
 
 namespace hemo {
+  /**
+   * Guo forced BGK dynamics with a relaxation time per node, shared by the
+   * interior nodes of one atomic block of the fluid lattice.
+   *
+   * The relaxation times are the ones of the interior viscosity field, stored
+   * again as omega in the order of the cell storage of the block (dense or
+   * indirect), so collide() finds the omega of a cell from its address. Marking
+   * a node as interior therefore only writes the field and points the cell to
+   * this object, no dynamics are allocated or deleted while the cells move.
+   *
+   * The object points into the storage of its block, so it must not be copied
+   * to another block: InteriorViscosityHelper releases the interior nodes before
+   * the lattice is redistributed and attributes them again afterwards.
+   */
+  class InteriorViscosityDynamics : public plb::GuoExternalForceBGKdynamics<FLUID_T,DESCRIPTOR> {
+  public:
+    InteriorViscosityDynamics(plb::BlockLattice3D<FLUID_T,DESCRIPTOR> & block);
+    InteriorViscosityDynamics * clone() const {
+      return new InteriorViscosityDynamics(*this);
+    }
+    void collide(plb::Cell<FLUID_T,DESCRIPTOR> & cell, plb::BlockStatistics & statistics);
+    /// Relaxation time of a cell of the block
+    void setTau(plb::Cell<FLUID_T,DESCRIPTOR> const & cell, T tau) {
+      omegas[&cell - storage] = 1.0/tau;
+    }
+    /// Relaxation frequency of a cell of the block, getOmega() only holds the one of the cell collided last
+    T omegaOf(plb::Cell<FLUID_T,DESCRIPTOR> const & cell) const {
+      return omegas[&cell - storage];
+    }
+  private:
+    plb::Cell<FLUID_T,DESCRIPTOR> const * storage;
+    std::vector<T> omegas;
+  };
+
+  /// Relaxation frequency of any cell of the fluid lattice, including the interior nodes of the cells
+  inline T omegaOf(plb::Cell<FLUID_T,DESCRIPTOR> const & cell) {
+    InteriorViscosityDynamics const * interior = dynamic_cast<InteriorViscosityDynamics const *>(&cell.getDynamics());
+    return interior ? interior->omegaOf(cell) : cell.getDynamics().getOmega();
+  }
+
   class InteriorViscosityHelper {
   public:
     static InteriorViscosityHelper& get(HemoCellFields & cellFields) {
@@ -37,6 +78,10 @@ namespace hemo {
       
     void checkpoint();
     static void restore(HemoCellFields & cellFields);
+    /// Give the interior nodes the background dynamics again, before the fluid lattice is redistributed
+    void releaseDynamics();
+    /// Move the field to the distribution of the (new) fluid lattice, used by the LoadBalancer
+    void redistribute();
     
     //Called within functional, from particlefield
     void add(HemoCellParticleField & pf, const Dot3D & bindingSite, T tau);
@@ -48,11 +93,14 @@ namespace hemo {
   private:
     HemoCellFields & cellFields;
     plb::MultiScalarField3D<T> * multiInteriorViscosityField = 0;
+    std::vector<InteriorViscosityDynamics*> blockDynamics;
     
     InteriorViscosityHelper(HemoCellFields & cellFields);
     ~InteriorViscosityHelper();
     
     void refillBindingSites();
+    /// (Re)create the interior viscosity dynamics of the local blocks
+    void createDynamics();
     
     //Singleton Behaviour
   public:
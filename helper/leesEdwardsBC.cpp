@@ -0,0 +1,280 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab
+in the University of Amsterdam. Any questions or remarks regarding this library
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "leesEdwardsBC.h"
+#include "hemocell.h"
+#include "palabos3D.h"
+#include "palabos3D.hh"
+
+#include <mpi.h>
+
+namespace hemo {
+using namespace plb;
+
+typedef DESCRIPTOR<T> D;
+
+LeesEdwardsBC::LeesEdwardsBC(HemoCell & hemocell_, T shearRate, T dt, unsigned int normal_, unsigned int flow_) :
+  hemocell(hemocell_), normal(normal_), flow(flow_), displacementStep(shearRate*dt)
+{
+  if (normal > 2 || flow > 2 || normal == flow) {
+    hlog << "(LeesEdwardsBC) (Error) The shear plane normal (" << normal << ") and flow direction (" << flow << ") must be two different axes" << endl;
+    exit(1);
+  }
+  span = 3 - normal - flow;
+
+  // Uses the default periodicity because otherwise a form of bounceback boundary will be initialized per default
+  MultiBlockLattice3D<FLUID_T,DESCRIPTOR> & lattice = *hemocell.lattice;
+  lattice.periodicity().toggleAll(true);
+  const plint n[3] = {lattice.getNx(), lattice.getNy(), lattice.getNz()};
+  nFlow = n[flow];
+  const T vHalf = (n[normal] - 1)*shearRate*0.5;
+
+  for (int p = 0; p < 2; p++) {
+    Plane & plane = planes[p];
+    plane.sign = p ? 1 : -1;
+    plane.coordinate = p ? n[normal] - 1 : 0;
+    plane.velocity = p ? -vHalf : vHalf;
+    for (plint iPop = 0; iPop < D::q; iPop++) {
+      if (D::c[iPop][normal] == -plane.sign) {
+        plane.populations.push_back(iPop);
+      }
+    }
+    for (plint iPop : plane.populations) {
+      for (unsigned int j = 0; j < plane.populations.size(); j++) {
+        const plint jPop = plane.populations[j];
+        if (D::c[jPop][flow] == -D::c[iPop][flow] && D::c[jPop][span] == D::c[iPop][span]) {
+          plane.sources.push_back(j);
+        }
+      }
+    }
+  }
+  setupPlanes();
+
+  hlog << "(LeesEdwardsBC) Shearing the planes normal to axis " << normal << " along axis " << flow
+       << ", plane velocities " << vHalf << " and " << -vHalf << " (lbm units)" << endl;
+}
+
+void LeesEdwardsBC::setupPlanes() {
+  MultiBlockLattice3D<FLUID_T,DESCRIPTOR> & lattice = *hemocell.lattice;
+  for (Plane & plane : planes) {
+    plane.blocks.clear();
+    plane.transfers.clear();
+    plane.windows.clear();
+    plane.planned = false;
+  }
+  for (auto const & bulk : lattice.getSparseBlockStructure().getBulks()) {
+    const Box3D & box = bulk.second;
+    const plint lower[3] = {box.x0, box.y0, box.z0}, upper[3] = {box.x1, box.y1, box.z1};
+    const PlaneBlock planeBlock = {bulk.first, lattice.getMultiBlockManagement().getThreadAttribution().getMpiProcess(bulk.first),
+                                   lower[flow], upper[flow], lower[span], upper[span]};
+    for (Plane & plane : planes) {
+      if (lower[normal] <= plane.coordinate && plane.coordinate <= upper[normal]) {
+        plane.blocks.push_back(planeBlock);
+      }
+    }
+  }
+}
+
+void LeesEdwardsBC::redistribute() {
+  setupPlanes();
+}
+
+void LeesEdwardsBC::plan(Plane & plane, plint shift) {
+  const int rank = global::mpi().getRank();
+  const plint q = plane.populations.size();
+  plane.transfers.clear();
+  plane.windows.clear();
+  for (unsigned int r = 0; r < plane.blocks.size(); r++) {
+    const PlaneBlock & receiver = plane.blocks[r];
+    // The window of a block starts at the displaced position of its first node
+    const plint start = receiver.flow0 + shift;
+    const plint length = receiver.flow1 - receiver.flow0 + 2;
+    if (receiver.rank == rank) {
+      plane.windows[receiver.blockId].assign(length*(receiver.span1 - receiver.span0 + 1)*q, 0.);
+    }
+    for (unsigned int s = 0; s < plane.blocks.size(); s++) {
+      const PlaneBlock & source = plane.blocks[s];
+      if (receiver.rank != rank && source.rank != rank) {
+        continue;
+      }
+      const plint span0 = std::max(receiver.span0, source.span0), span1 = std::min(receiver.span1, source.span1);
+      if (span0 > span1) {
+        continue;
+      }
+      Transfer transfer = {int(r), int(s), {}};
+      for (plint k = 0; k < length; k++) {
+        const plint f = ((start + k)%nFlow + nFlow)%nFlow;
+        if (source.flow0 <= f && f <= source.flow1) {
+          transfer.runs.push_back({k, f, span0, span1});
+        }
+      }
+      if (!transfer.runs.empty()) {
+        plane.transfers.push_back(transfer);
+      }
+    }
+  }
+  plane.shift = shift;
+  plane.planned = true;
+}
+
+BlockLattice3D<FLUID_T,DESCRIPTOR> & LeesEdwardsBC::block(plint blockId) {
+  return hemocell.lattice->getComponent(blockId);
+}
+
+Dot3D LeesEdwardsBC::local(BlockLattice3D<FLUID_T,DESCRIPTOR> & lattice, plint coordinate, plint f, plint s) const {
+  plint global[3];
+  global[normal] = coordinate;
+  global[flow] = f;
+  global[span] = s;
+  const Dot3D & location = lattice.getLocation();
+  return Dot3D(global[0] - location.x, global[1] - location.y, global[2] - location.z);
+}
+
+void LeesEdwardsBC::apply() {
+  global.statistics.getCurrent()["leesEdwards"].start();
+  const int rank = global::mpi().getRank();
+  displacement = std::fmod(displacementStep*hemocell.iter, double(nFlow));
+  for (Plane & plane : planes) {
+    const plint shift = plint(std::floor(plane.sign*displacement));
+    if (!plane.planned || shift != plane.shift) {
+      plan(plane, shift);
+    }
+  }
+
+  // 1. Fill the windows from the local blocks and pack the parts other ranks
+  //    need, both planes in transfer order in one buffer per rank
+  std::map<int,std::vector<T>> sendBuffers;
+  std::map<int,plint> recvSizes;
+  for (Plane & plane : planes) {
+    const plint q = plane.populations.size();
+    for (const Transfer & transfer : plane.transfers) {
+      const PlaneBlock & receiver = plane.blocks[transfer.receiver];
+      const PlaneBlock & source = plane.blocks[transfer.source];
+      if (source.rank != rank) {
+        for (const Run & run : transfer.runs) {
+          recvSizes[source.rank] += (run.span1 - run.span0 + 1)*q;
+        }
+        continue;
+      }
+      BlockLattice3D<FLUID_T,DESCRIPTOR> & from = block(source.blockId);
+      const plint nSpan = receiver.span1 - receiver.span0 + 1;
+      for (const Run & run : transfer.runs) {
+        for (plint s = run.span0; s <= run.span1; s++) {
+          const Dot3D node = local(from, plane.coordinate, run.f, s);
+          Cell<FLUID_T,DESCRIPTOR> const & cell = from.get(node.x, node.y, node.z);
+          if (receiver.rank == rank) {
+            T * window = &plane.windows[receiver.blockId][(run.k*nSpan + s - receiver.span0)*q];
+            for (plint p = 0; p < q; p++) {
+              window[p] = cell[plane.populations[p]];
+            }
+          } else {
+            std::vector<T> & buffer = sendBuffers[receiver.rank];
+            for (plint p = 0; p < q; p++) {
+              buffer.push_back(cell[plane.populations[p]]);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  // 2. Exchange
+  std::map<int,std::vector<T>> recvBuffers;
+  std::vector<MPI_Request> recvRequests, sendRequests;
+  for (auto const & size : recvSizes) {
+    std::vector<T> & buffer = recvBuffers[size.first];
+    buffer.resize(size.second);
+    recvRequests.emplace_back();
+    MPI_Irecv(buffer.data(),buffer.size()*sizeof(T),MPI_CHAR,size.first,44,MPI_COMM_WORLD,&recvRequests.back());
+  }
+  for (auto & send : sendBuffers) {
+    sendRequests.emplace_back();
+    MPI_Isend(send.second.data(),send.second.size()*sizeof(T),MPI_CHAR,send.first,44,MPI_COMM_WORLD,&sendRequests.back());
+  }
+  MPI_Waitall(recvRequests.size(),recvRequests.data(),MPI_STATUSES_IGNORE);
+
+  std::map<int,plint> unpacked;
+  for (Plane & plane : planes) {
+    const plint q = plane.populations.size();
+    for (const Transfer & transfer : plane.transfers) {
+      const PlaneBlock & receiver = plane.blocks[transfer.receiver];
+      const PlaneBlock & source = plane.blocks[transfer.source];
+      if (source.rank == rank) {
+        continue;
+      }
+      const T * buffer = recvBuffers[source.rank].data();
+      plint & position = unpacked[source.rank];
+      const plint nSpan = receiver.span1 - receiver.span0 + 1;
+      for (const Run & run : transfer.runs) {
+        for (plint s = run.span0; s <= run.span1; s++) {
+          T * window = &plane.windows[receiver.blockId][(run.k*nSpan + s - receiver.span0)*q];
+          for (plint p = 0; p < q; p++) {
+            window[p] = buffer[position++];
+          }
+        }
+      }
+    }
+  }
+
+  // 3. Impose the plane velocity and set the populations that crossed the
+  //    boundary from the window, interpolated at the displaced position
+  plb::Array<FLUID_T,3> velocity(0.,0.,0.);
+  for (Plane & plane : planes) {
+    const plint q = plane.populations.size();
+    const T weight = plane.sign*displacement - plane.shift;
+    velocity[flow] = plane.velocity;
+    for (const PlaneBlock & planeBlock : plane.blocks) {
+      if (planeBlock.rank != rank) {
+        continue;
+      }
+      BlockLattice3D<FLUID_T,DESCRIPTOR> & to = block(planeBlock.blockId);
+      const std::vector<T> & window = plane.windows[planeBlock.blockId];
+      const plint nSpan = planeBlock.span1 - planeBlock.span0 + 1;
+      for (plint f = planeBlock.flow0; f <= planeBlock.flow1; f++) {
+        for (plint s = planeBlock.span0; s <= planeBlock.span1; s++) {
+          const Dot3D node = local(to, plane.coordinate, f, s);
+          Cell<FLUID_T,DESCRIPTOR> & cell = to.get(node.x, node.y, node.z);
+          Cell<FLUID_T,DESCRIPTOR> imposed(cell);
+          FLUID_T rhoBar;
+          plb::Array<FLUID_T,3> j;
+          imposed.getDynamics().computeRhoBarJ(imposed, rhoBar, j);
+          imposed.getDynamics().collideExternal(imposed, rhoBar, velocity, FLUID_T(), to.getInternalStatistics());
+
+          const T * lower = &window[((f - planeBlock.flow0)*nSpan + s - planeBlock.span0)*q];
+          const T * upper = lower + nSpan*q;
+          for (plint p = 0; p < q; p++) {
+            imposed[plane.populations[p]] = (1. - weight)*lower[plane.sources[p]] + weight*upper[plane.sources[p]];
+          }
+          for (plint iPop = 0; iPop < D::q; iPop++) {
+            cell[iPop] = imposed[iPop];
+          }
+        }
+      }
+    }
+  }
+  MPI_Waitall(sendRequests.size(),sendRequests.data(),MPI_STATUSES_IGNORE);
+
+  hemocell.lattice->getBlockCommunicator().duplicateOverlaps(*hemocell.lattice,modif::staticVariables);
+  global.statistics.getCurrent().stop();
+}
+}
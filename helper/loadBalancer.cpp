@@ -0,0 +1,442 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "loadBalancer.h"
+#include "bindingField.h"
+#include "interiorViscosity.h"
+#include "fluidHaloExchange.h"
+#include "fusedFluidKernel.h"
+#include "gridRefinement.h"
+#include "leesEdwardsBC.h"
+#include "sparseFluidStorage.h"
+#include "palabos3D.h"
+#include "palabos3D.hh"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace hemo {
+
+LoadBalancer::LoadBalancer(HemoCell & hemocell_) : hemocell(hemocell_) {
+  original_block_structure = hemocell.domain_lattice->getSparseBlockStructure().clone();
+}
+
+LoadBalancer::~LoadBalancer() {
+  if (original_block_structure) {
+    delete original_block_structure;
+  }
+}
+
+void LoadBalancer::GatherTimeOfAtomicBlocks::processGenericBlocks(Box3D domain, vector<AtomicBlock3D*> blocks) {
+  HEMOCELL_PARTICLE_FIELD * pf = dynamic_cast<HEMOCELL_PARTICLE_FIELD*>(blocks[0]);
+  TOAB_t toab;
+  toab.fluid_time = pf->cost.getTime(BlockCost::collideAndStream);
+  toab.particle_time = pf->cost.getTotalTime() - toab.fluid_time;
+  toab.n_lsp = pf->get_lpc().size();
+  toab.mpi_proc = global::mpi().getRank();
+  toab.n_fluid_cells = pf->nFluidCells;
+  gatherValues[pf->atomicBlockId] = toab;
+}
+
+LoadBalancer::GatherTimeOfAtomicBlocks * LoadBalancer::GatherTimeOfAtomicBlocks::clone() const {
+  return new GatherTimeOfAtomicBlocks(*this);
+}
+
+T LoadBalancer::calculateFractionalLoadImbalance() {
+  if (hemocell.preInlet) {
+    hlog << "(LoadBalancer) Load balancing is not supported in combination with a PreInlet, returning 0" << endl;
+    return 0.;
+  }
+  gatherValues.clear();
+  vector<MultiBlock3D*> wrapper;
+  wrapper.push_back(hemocell.cellfields->immersedParticles);
+  applyProcessingFunctional(new GatherTimeOfAtomicBlocks(gatherValues),hemocell.cellfields->immersedParticles->getBoundingBox(),wrapper);
+  HemoCellGatheringFunctional<TOAB_t>::gather(gatherValues);
+  FLI_iscalled = true;
+
+  vector<double> cost(global::mpi().getSize(),0.);
+  for (auto const & block : gatherValues) {
+    cost[block.second.mpi_proc] += block.second.fluid_time + block.second.particle_time;
+  }
+  const double max = *std::max_element(cost.begin(),cost.end());
+  double avg = 0.;
+  for (double c : cost) { avg += c; }
+  avg /= cost.size();
+  if (avg == 0.) {
+    return 0.;
+  }
+  return (max-avg)/avg;
+}
+
+/// Index of a point on a 3D Hilbert curve with 2^bits points per axis (Skilling, AIP Conf. Proc. 707, 2004)
+static uint64_t hilbertIndex(unsigned int x, unsigned int y, unsigned int z, int bits) {
+  unsigned int X[3] = {x,y,z};
+  const unsigned int M = 1u << (bits-1);
+  for (unsigned int Q = M ; Q > 1 ; Q >>= 1) {
+    const unsigned int P = Q-1;
+    for (int i = 0 ; i < 3 ; i++) {
+      if (X[i] & Q) {
+        X[0] ^= P;
+      } else {
+        const unsigned int t = (X[0]^X[i]) & P;
+        X[0] ^= t;
+        X[i] ^= t;
+      }
+    }
+  }
+  for (int i = 1 ; i < 3 ; i++) {
+    X[i] ^= X[i-1];
+  }
+  unsigned int t = 0;
+  for (unsigned int Q = M ; Q > 1 ; Q >>= 1) {
+    if (X[2] & Q) { t ^= Q-1; }
+  }
+  for (int i = 0 ; i < 3 ; i++) {
+    X[i] ^= t;
+  }
+  uint64_t index = 0;
+  for (int b = bits-1 ; b >= 0 ; b--) {
+    for (int i = 0 ; i < 3 ; i++) {
+      index = (index << 1) | ((X[i] >> b) & 1);
+    }
+  }
+  return index;
+}
+
+/// Cut the blocks, sorted along a curve, in pieces of equal cost, a block goes to the piece containing its cost midpoint
+static map<plint,plint> partitionCurve(vector<std::pair<uint64_t,plint>> & curve, map<plint,double> const & cost, int nProcs) {
+  std::sort(curve.begin(),curve.end());
+  double total = 0.;
+  for (auto const & point : curve) {
+    total += cost.at(point.second);
+  }
+  map<plint,plint> blockToMpi;
+  const double share = total/nProcs;
+  double passed = 0.;
+  for (auto const & point : curve) {
+    const double c = cost.at(point.second);
+    plint proc = share > 0. ? (plint)((passed + c/2.)/share) : 0;
+    blockToMpi[point.second] = std::min(proc,(plint)nProcs-1);
+    passed += c;
+  }
+  return blockToMpi;
+}
+
+map<plint,plint> LoadBalancer::partitionAlongHilbertCurve(SparseBlockStructure3D const & structure, map<plint,double> const & cost, int nProcs) {
+  const int bits = 10;
+  const Box3D bb = structure.getBoundingBox();
+  const plint extent = std::max(std::max(bb.getNx(),bb.getNy()),bb.getNz());
+
+  vector<std::pair<uint64_t,plint>> curve;
+  for (auto const & bulk : structure.getBulks()) {
+    const Box3D & box = bulk.second;
+    unsigned int c[3] = {
+      (unsigned int)(((box.x0+box.x1)/2 - bb.x0)*((1<<bits)-1)/extent),
+      (unsigned int)(((box.y0+box.y1)/2 - bb.y0)*((1<<bits)-1)/extent),
+      (unsigned int)(((box.z0+box.z1)/2 - bb.z0)*((1<<bits)-1)/extent)};
+    curve.emplace_back(hilbertIndex(c[0],c[1],c[2],bits),bulk.first);
+  }
+  return partitionCurve(curve,cost,nProcs);
+}
+
+map<plint,plint> LoadBalancer::partitionInSlabs(SparseBlockStructure3D const & structure, map<plint,double> const & cost, int nProcs) {
+  const Box3D bb = structure.getBoundingBox();
+  const plint n[3] = {bb.getNx(),bb.getNy(),bb.getNz()};
+  const plint origin[3] = {bb.x0,bb.y0,bb.z0};
+  // Row major order with the longest axis slowest, so every process gets a slab across it
+  int axes[3] = {0,1,2};
+  std::sort(axes,axes+3,[&](int a, int b) { return n[a] > n[b]; });
+
+  vector<std::pair<uint64_t,plint>> curve;
+  for (auto const & bulk : structure.getBulks()) {
+    const Box3D & box = bulk.second;
+    const plint center[3] = {(box.x0+box.x1)/2,(box.y0+box.y1)/2,(box.z0+box.z1)/2};
+    uint64_t index = 0;
+    for (int axis : axes) {
+      index = index*n[axis] + (center[axis]-origin[axis]);
+    }
+    curve.emplace_back(index,bulk.first);
+  }
+  return partitionCurve(curve,cost,nProcs);
+}
+
+void LoadBalancer::doLoadBalance() {
+  if (hemocell.preInlet) {
+    hlog << "(LoadBalancer) Load balancing is not supported in combination with a PreInlet, skipping" << endl;
+    return;
+  }
+  if (!FLI_iscalled) {
+    calculateFractionalLoadImbalance();
+  }
+  FLI_iscalled = false;
+
+  // Without any timings yet (e.g. right after the start), the fluid cells are the best estimate
+  bool timed = false;
+  for (auto const & block : gatherValues) {
+    if (block.second.fluid_time + block.second.particle_time > 0.) { timed = true; }
+  }
+  map<plint,double> cost;
+  for (auto const & bulk : original_block_structure->getBulks()) {
+    TOAB_t const & toab = gatherValues[bulk.first];
+    cost[bulk.first] = timed ? toab.fluid_time + toab.particle_time : toab.n_fluid_cells;
+  }
+  map<plint,plint> blockToMpi = partitionAlongHilbertCurve(*original_block_structure,cost,global::mpi().getSize());
+  int moved = 0;
+  for (auto const & block : blockToMpi) {
+    if (gatherValues[block.first].mpi_proc != block.second) { moved++; }
+  }
+  hlog << "(LoadBalancer) Moving " << moved << " of " << blockToMpi.size() << " atomic blocks to another process" << endl;
+  if (moved == 0) {
+    resetBlockTimings();
+    return;
+  }
+
+  migrateBlocks(*original_block_structure,blockToMpi);
+}
+
+void LoadBalancer::migrateBlocks(SparseBlockStructure3D const & structure, map<plint,plint> const & blockToMpi) {
+  global.statistics.getCurrent()["migrateBlocks"].start();
+  HemoCellFields & cellfields = *hemocell.cellfields;
+  if (hemocell.fluidHalo) {
+    delete hemocell.fluidHalo;
+    hemocell.fluidHalo = 0;
+  }
+  if (hemocell.fusedFluid) {
+    delete hemocell.fusedFluid;
+    hemocell.fusedFluid = 0;
+  }
+
+  // 1. Fluid lattice, the dynamics objects are serialized along (modif::dataStructure)
+  if (global.enableInteriorViscosity) {
+    InteriorViscosityHelper::get(cellfields).releaseDynamics();
+  }
+  MultiBlockLattice3D<FLUID_T,DESCRIPTOR> * old_lattice = hemocell.lattice;
+  MultiBlockManagement3D management(structure,
+                                    new ExplicitThreadAttribution(blockToMpi),
+                                    cellfields.envelopeSize,
+                                    old_lattice->getMultiBlockManagement().getRefinementLevel());
+  hemocell.lattice = new MultiBlockLattice3D<FLUID_T,DESCRIPTOR>(management,
+            defaultMultiBlockPolicy3D().getBlockCommunicator(),
+            defaultMultiBlockPolicy3D().getCombinedStatistics(),
+            defaultMultiBlockPolicy3D().getMultiCellAccess<FLUID_T, DESCRIPTOR>(),
+            new GuoExternalForceBGKdynamics<FLUID_T, DESCRIPTOR>(1.0/param::tau));
+  for (int axis = 0 ; axis < 3 ; axis++) {
+    hemocell.lattice->periodicity().toggle(axis,old_lattice->periodicity().get(axis));
+  }
+  hemocell.lattice->toggleInternalStatistics(old_lattice->isInternalStatisticsOn());
+  copyNonLocal(*old_lattice,*hemocell.lattice,old_lattice->getBoundingBox(),modif::dataStructure);
+  if (global.enableFusedFluidKernel) {
+    FusedFluidKernel::shareBackgroundDynamics(*hemocell.lattice);
+  }
+  if (global.enableSparseFluidStorage) {
+    SparseFluidStorage::compact(*hemocell.lattice);
+  }
+  hemocell.domain_lattice = hemocell.lattice;
+  cellfields.lattice = hemocell.lattice;
+
+  // 2. CEPAC field, has uniform dynamics so only the populations are moved
+  if (cellfields.CEPACfield) {
+    MultiBlockLattice3D<CEPAC_T,CEPAC_DESCRIPTOR> * old_CEPACfield = cellfields.CEPACfield;
+    cellfields.createCEPACfield();
+    copyNonLocal(*old_CEPACfield,*cellfields.CEPACfield,old_CEPACfield->getBoundingBox(),modif::staticVariables);
+    delete old_CEPACfield;
+  }
+  delete old_lattice;
+
+  // 3. Particles, only the bulk is moved (HemoCellParticleDataTransfer), the envelopes are synced afterwards
+  MultiParticleField3D<HEMOCELL_PARTICLE_FIELD> * old_particles = cellfields.immersedParticles;
+  cellfields.createParticleField();
+  copyNonLocal(*old_particles,*cellfields.immersedParticles,old_particles->getBoundingBox(),modif::hemocell);
+  delete old_particles;
+  cellfields.InitAfterLoadCheckpoint();
+
+  hemocell.lattice->getMultiBlockManagement().changeEnvelopeWidth(1);
+  hemocell.lattice->signalPeriodicity();
+
+  // 4. Auxiliary scalar fields
+  if (global.enableSolidifyMechanics) {
+    bindingFieldHelper::get(cellfields).redistribute();
+  }
+  if (global.enableInteriorViscosity) {
+    InteriorViscosityHelper::get(cellfields).redistribute();
+  }
+  if (hemocell.gridRefinement) {
+    hemocell.gridRefinement->redistribute();
+  }
+  if (hemocell.leesEdwards) {
+    hemocell.leesEdwards->redistribute();
+  }
+
+  cellfields.calculateCommunicationStructure();
+  cellfields.syncEnvelopes();
+  cellfields.deleteIncompleteCells(false);
+
+  if (&structure != original_block_structure) {
+    delete original_block_structure;
+    original_block_structure = structure.clone();
+  }
+  global.statistics.getCurrent().stop();
+}
+
+SparseBlockStructure3D * LoadBalancer::createFluidBlockStructure(plint blockSize, map<plint,double> & fluidCells) {
+  const Box3D bb = hemocell.lattice->getBoundingBox();
+  const plint nBlocks[3] = {(bb.getNx()+blockSize-1)/blockSize,
+                            (bb.getNy()+blockSize-1)/blockSize,
+                            (bb.getNz()+blockSize-1)/blockSize};
+
+  // Fluid cells per candidate block, including the layer around it, which is needed for the bounceback
+  vector<long> count(nBlocks[0]*nBlocks[1]*nBlocks[2],0);
+  for (plint bId : hemocell.lattice->getLocalInfo().getBlocks()) {
+    BlockLattice3D<FLUID_T,DESCRIPTOR> & block = hemocell.lattice->getComponent(bId);
+    const Dot3D location = block.getLocation();
+    Box3D bulk;
+    hemocell.lattice->getSparseBlockStructure().getBulk(bId,bulk);
+    for (plint x = bulk.x0 ; x <= bulk.x1 ; x++) {
+      for (plint y = bulk.y0 ; y <= bulk.y1 ; y++) {
+        for (plint z = bulk.z0 ; z <= bulk.z1 ; z++) {
+          if (block.get(x-location.x,y-location.y,z-location.z).getDynamics().isBoundary()) { continue; }
+          for (plint bx = std::max((plint)0,(x-1-bb.x0)/blockSize) ; bx <= std::min(nBlocks[0]-1,(x+1-bb.x0)/blockSize) ; bx++) {
+            for (plint by = std::max((plint)0,(y-1-bb.y0)/blockSize) ; by <= std::min(nBlocks[1]-1,(y+1-bb.y0)/blockSize) ; by++) {
+              for (plint bz = std::max((plint)0,(z-1-bb.z0)/blockSize) ; bz <= std::min(nBlocks[2]-1,(z+1-bb.z0)/blockSize) ; bz++) {
+                count[(bx*nBlocks[1]+by)*nBlocks[2]+bz]++;
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+  MPI_Allreduce(MPI_IN_PLACE,count.data(),count.size(),MPI_LONG,MPI_SUM,MPI_COMM_WORLD);
+
+  SparseBlockStructure3D * structure = new SparseBlockStructure3D(bb);
+  for (plint bx = 0 ; bx < nBlocks[0] ; bx++) {
+    for (plint by = 0 ; by < nBlocks[1] ; by++) {
+      for (plint bz = 0 ; bz < nBlocks[2] ; bz++) {
+        const plint id = (bx*nBlocks[1]+by)*nBlocks[2]+bz;
+        if (!count[id]) { continue; }
+        Box3D bulk(bb.x0+bx*blockSize,std::min(bb.x0+(bx+1)*blockSize-1,bb.x1),
+                   bb.y0+by*blockSize,std::min(bb.y0+(by+1)*blockSize-1,bb.y1),
+                   bb.z0+bz*blockSize,std::min(bb.z0+(bz+1)*blockSize-1,bb.z1));
+        structure->addBlock(bulk,bulk,id);
+        fluidCells[id] = count[id];
+      }
+    }
+  }
+  return structure;
+}
+
+void LoadBalancer::tuneDecomposition(std::function<void()> afterIteration) {
+  if (hemocell.preInlet) {
+    hlog << "(Tuner) Decomposition tuning is not supported in combination with a PreInlet, skipping" << endl;
+    return;
+  }
+  if (global.tuneBlockSizes.empty() || !global.tuneIterations) {
+    return;
+  }
+  hlog << "(Tuner) Timing " << 2*global.tuneBlockSizes.size()+1 << " decompositions for " << global.tuneIterations << " iterations each" << endl;
+
+  // Wall clock time per iteration of the slowest process, the first iteration warms up the new structure
+  auto timeIterations = [&]() {
+    hemocell.iterate();
+    if (afterIteration) { afterIteration(); }
+    MPI_Barrier(MPI_COMM_WORLD);
+    double start = MPI_Wtime();
+    for (unsigned int i = 0 ; i < global.tuneIterations ; i++) {
+      hemocell.iterate();
+      if (afterIteration) { afterIteration(); }
+    }
+    double elapsed = MPI_Wtime() - start;
+    MPI_Allreduce(MPI_IN_PLACE,&elapsed,1,MPI_DOUBLE,MPI_MAX,MPI_COMM_WORLD);
+    return elapsed/global.tuneIterations;
+  };
+
+  SparseBlockStructure3D * best = original_block_structure->clone();
+  map<plint,plint> bestBlockToMpi;
+  for (auto const & bulk : best->getBulks()) {
+    bestBlockToMpi[bulk.first] = hemocell.lattice->getMultiBlockManagement().getThreadAttribution().getMpiProcess(bulk.first);
+  }
+  plint bestSize = 0;
+  std::string bestPartition;
+  bool currentIsBest = true;
+  double bestTime = timeIterations();
+  hlog << "(Tuner) Initial decomposition (" << best->getNumBlocks() << " blocks): " << bestTime << " s per iteration" << endl;
+
+  // Every block size is distributed along a Hilbert curve (compact pieces) and
+  // in slabs across the longest axis (fewer neighbours per process)
+  typedef map<plint,plint> (*Partition)(SparseBlockStructure3D const &, map<plint,double> const &, int);
+  const std::pair<std::string,Partition> partitions[2] = {{"hilbert",partitionAlongHilbertCurve},{"slabs",partitionInSlabs}};
+  for (int blockSize : global.tuneBlockSizes) {
+    if (blockSize <= 0) {
+      hlog << "(Tuner) (Warning) Skipping invalid block size " << blockSize << endl;
+      continue;
+    }
+    map<plint,double> fluidCells;
+    SparseBlockStructure3D * candidate = createFluidBlockStructure(blockSize,fluidCells);
+    for (auto const & partition : partitions) {
+      map<plint,plint> blockToMpi = partition.second(*candidate,fluidCells,global::mpi().getSize());
+      migrateBlocks(*candidate,blockToMpi);
+      const double time = timeIterations();
+      hlog << "(Tuner) Block size " << blockSize << ", " << partition.first << " (" << candidate->getNumBlocks() << " blocks): " << time << " s per iteration" << endl;
+      if (time < bestTime) {
+        delete best;
+        best = candidate->clone();
+        bestBlockToMpi = blockToMpi;
+        bestSize = blockSize;
+        bestPartition = partition.first;
+        bestTime = time;
+        currentIsBest = true;
+      } else {
+        currentIsBest = false;
+      }
+    }
+    delete candidate;
+  }
+
+  if (!currentIsBest) {
+    migrateBlocks(*best,bestBlockToMpi);
+  }
+  if (bestSize) {
+    hlog << "(Tuner) Continuing with block size " << bestSize << ", " << bestPartition << " (" << best->getNumBlocks() << " blocks, " << bestTime << " s per iteration)" << endl;
+    hlog << "(Tuner) Set <domain><blockSize>" << bestSize << "</blockSize> to reuse the block size, the " << bestPartition
+         << " distribution is not read from the config: list only " << bestSize << " in <tuneBlockSizes> to get this layout again" << endl;
+  } else {
+    hlog << "(Tuner) Continuing with the initial decomposition (" << bestTime << " s per iteration)" << endl;
+  }
+  delete best;
+}
+
+void LoadBalancer::reloadCheckpoint() {
+  // The checkpoint holds this iteration, but loading from a checkpointed config would rewind to its iteration
+  const unsigned int iter = hemocell.iter;
+  hemocell.loadCheckPoint();
+  hemocell.iter = iter;
+  hemocell.cellfields->calculateCommunicationStructure();
+}
+
+void LoadBalancer::resetBlockTimings() {
+  for (plint lbid : hemocell.cellfields->immersedParticles->getLocalInfo().getBlocks()) {
+    HEMOCELL_PARTICLE_FIELD & pf = hemocell.cellfields->immersedParticles->getComponent(lbid);
+    pf.cost.clear();
+  }
+}
+}
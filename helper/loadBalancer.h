@@ -27,25 +27,58 @@ namespace hemo {
   class LoadBalancer;
 }
 #include "hemocell.h"
+
+#include <functional>
 namespace hemo {
+/**
+ * Balances the atomic blocks over the mpi processes. The cost of a block is the
+ * measured wall clock time of its fluid and particle work over the BlockCost
+ * window (HemoCellParticleField::cost). The blocks are
+ * ordered along a Hilbert curve through their centers and this curve is cut in
+ * pieces of equal cost, so only MPI is needed (no ParMETIS).
+ */
 class LoadBalancer {  
   public:
-#ifdef HEMO_PARMETIS
   LoadBalancer(HemoCell & hemocell_);
+  ~LoadBalancer();
+  /// Gather the block timings and return (max-avg)/avg of the cost per process
   T calculateFractionalLoadImbalance();
+#ifdef HEMO_PARMETIS
   /**
    * Restructure blocks to reduce communication on one processor
    * Set checkpoint_available to false if not called in the same iteration right after doLoadBalance()
    */
   void restructureBlocks(bool checkpoint_available=true);
 #else
-  LoadBalancer(HemoCell & hemocell_):hemocell(hemocell_){};
-  double calculateFractionalLoadImbalance() {return 0.0;}
   void restructureBlocks(bool checkpoint_available=true) {}
 #endif
 
+  /**
+   * Redistribute the atomic blocks with the Hilbert curve partitioning, the
+   * blocks are moved between the processes in memory (migrateBlocks). Data
+   * processors that the case added to the lattice (e.g. boundary conditions)
+   * are not transferred and must be added again.
+   */
   void doLoadBalance();
 
+  /**
+   * Partition the blocks of a structure over nProcs processes along a Hilbert
+   * curve, with an equal cost per process. Returns a blockId -> mpi rank map
+   */
+  static map<plint,plint> partitionAlongHilbertCurve(SparseBlockStructure3D const & structure, map<plint,double> const & cost, int nProcs);
+  /// Same, along the blocks in row major order with the longest axis slowest (slabs across it)
+  static map<plint,plint> partitionInSlabs(SparseBlockStructure3D const & structure, map<plint,double> const & cost, int nProcs);
+
+  /**
+   * Startup tuning (parameters/tuneBlockSizes): for every candidate edge size
+   * of the atomic blocks the domain is decomposed in blocks of that size
+   * (without the solid ones) and distributed along a Hilbert curve and in
+   * slabs, for each parameters/tuneIterations iterations are timed. The
+   * fastest decomposition is kept. These are normal iterations of the simulation, afterIteration is
+   * called after each of them (e.g. to set the driving force again)
+   */
+  void tuneDecomposition(std::function<void()> afterIteration);
+
   /**
    * used to reload a checkpoint, but first reload the config file
    */
@@ -57,6 +90,7 @@ class LoadBalancer {
     double particle_time;
     int n_lsp;
     int mpi_proc;
+    int n_fluid_cells;
   };
   struct Box3D_simple {
     plint x0,x1,y0,y1,z0,z1;
@@ -81,6 +115,16 @@ class LoadBalancer {
     GatherTimeOfAtomicBlocks * clone() const;
   };
   private:
+  /**
+   * Move the atomic blocks of the fluid lattice, CEPAC field, particle field
+   * and the binding/interior viscosity fields directly to their new process
+   * through MPI (copyNonLocal), instead of through a checkpoint
+   */
+  void migrateBlocks(SparseBlockStructure3D const & structure, map<plint,plint> const & blockToMpi);
+  /// Regular decomposition of the domain in blocks with edge blockSize, only the blocks with fluid, cost is their number of fluid cells
+  SparseBlockStructure3D * createFluidBlockStructure(plint blockSize, map<plint,double> & fluidCells);
+  /// Start a new measurement window, the recreated blocks after a balancing start at zero already
+  void resetBlockTimings();
   bool FLI_iscalled = false;
   map<int,TOAB_t> gatherValues;
   HemoCell & hemocell;
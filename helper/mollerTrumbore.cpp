@@ -0,0 +1,167 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "mollerTrumbore.h"
+#include "logfile.h"
+
+#include <cstdlib>
+
+namespace hemo {
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HEMO_TRIANGLE_PACKET_X86
+#endif
+
+namespace {
+typedef unsigned int (*CrossLanes)(const TrianglePacket &, T, T, T *);
+
+/// Every loop over the lanes is innermost and branch free, it is compiled once
+/// per instruction set below
+__attribute__((always_inline)) inline unsigned int crossLanes(const TrianglePacket & p, T yLine, T zLine, T * xCross) {
+  const int w = TrianglePacket::width;
+  T e[3][w], det[w], orientation[w];
+  int inside[w];
+  for (int k = 0; k < 3; k++) {
+    const int k1 = (k+1)%3, k2 = (k+2)%3;
+    for (int l = 0; l < w; l++) {
+      // Edge function of the edge in ascending vertex id order
+      const bool ascending = p.sign[k][l] > 0.;
+      const T py = (ascending ? p.y[k1][l] : p.y[k2][l]) - yLine;
+      const T pz = (ascending ? p.z[k1][l] : p.z[k2][l]) - zLine;
+      const T qy = (ascending ? p.y[k2][l] : p.y[k1][l]) - yLine;
+      const T qz = (ascending ? p.z[k2][l] : p.z[k1][l]) - zLine;
+      e[k][l] = p.sign[k][l]*(py*qz - pz*qy);
+    }
+  }
+  for (int l = 0; l < w; l++) {
+    det[l] = e[0][l] + e[1][l] + e[2][l];
+    orientation[l] = det[l] > 0. ? 1. : -1.;
+    inside[l] = det[l] != 0.;
+  }
+  for (int k = 0; k < 3; k++) {
+    const int k1 = (k+1)%3, k2 = (k+2)%3;
+    for (int l = 0; l < w; l++) {
+      // Top-left rule on the edge direction in the counter clockwise orientation
+      const T s = orientation[l]*p.sign[k][l];
+      const T dy = s*(p.sign[k][l] > 0. ? p.y[k2][l] - p.y[k1][l] : p.y[k1][l] - p.y[k2][l]);
+      const T dz = s*(p.sign[k][l] > 0. ? p.z[k2][l] - p.z[k1][l] : p.z[k1][l] - p.z[k2][l]);
+      const bool topLeft = dz > 0. || (dz == 0. && dy < 0.);
+      inside[l] &= orientation[l]*e[k][l] > 0. || (e[k][l] == 0. && topLeft);
+    }
+  }
+  unsigned int mask = 0;
+  for (int l = 0; l < w; l++) {
+    xCross[l] = (e[0][l]*p.x[0][l] + e[1][l]*p.x[1][l] + e[2][l]*p.x[2][l])/(inside[l] ? det[l] : 1.);
+    mask |= (unsigned int)inside[l] << l;
+  }
+  return mask;
+}
+
+unsigned int crossLanesGeneric(const TrianglePacket & p, T yLine, T zLine, T * xCross) {
+  return crossLanes(p,yLine,zLine,xCross);
+}
+#ifdef HEMO_TRIANGLE_PACKET_X86
+__attribute__((target("avx2,fma"))) unsigned int crossLanesAVX2(const TrianglePacket & p, T yLine, T zLine, T * xCross) {
+  return crossLanes(p,yLine,zLine,xCross);
+}
+__attribute__((target("avx512f"))) unsigned int crossLanesAVX512(const TrianglePacket & p, T yLine, T zLine, T * xCross) {
+  return crossLanes(p,yLine,zLine,xCross);
+}
+#endif
+
+TrianglePacket::Isa bestIsa() {
+  if (TrianglePacket::isaSupported(TrianglePacket::Isa::avx512)) {
+    return TrianglePacket::Isa::avx512;
+  }
+  if (TrianglePacket::isaSupported(TrianglePacket::Isa::avx2)) {
+    return TrianglePacket::Isa::avx2;
+  }
+  return TrianglePacket::Isa::generic;
+}
+
+TrianglePacket::Isa isa = TrianglePacket::Isa::generic;
+CrossLanes crossLanesIsa = 0;
+}
+
+void TrianglePacket::clear() {
+  for (int k = 0; k < 3; k++) {
+    for (int l = 0; l < width; l++) {
+      x[k][l] = y[k][l] = z[k][l] = 0.;
+      sign[k][l] = 1.;
+    }
+  }
+  size = 0;
+}
+
+unsigned int TrianglePacket::cross(T yLine, T zLine, T xCross[width]) const {
+  if (!crossLanesIsa) {
+    setIsa(bestIsa());
+  }
+  return crossLanesIsa(*this,yLine,zLine,xCross);
+}
+
+bool TrianglePacket::isaSupported(Isa isa_) {
+#ifdef HEMO_TRIANGLE_PACKET_X86
+  __builtin_cpu_init();
+  switch (isa_) {
+    case Isa::avx512: return __builtin_cpu_supports("avx512f");
+    case Isa::avx2: return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    case Isa::generic: return true;
+  }
+  return false;
+#else
+  return isa_ == Isa::generic;
+#endif
+}
+
+std::string TrianglePacket::isaName(Isa isa_) {
+  switch (isa_) {
+    case Isa::avx512: return "AVX-512";
+    case Isa::avx2: return "AVX2";
+    case Isa::generic: return "generic";
+  }
+  return "unknown";
+}
+
+TrianglePacket::Isa TrianglePacket::getIsa() {
+  if (!crossLanesIsa) {
+    setIsa(bestIsa());
+  }
+  return isa;
+}
+
+void TrianglePacket::setIsa(Isa isa_) {
+  if (!isaSupported(isa_)) {
+    hlog << "(TrianglePacket) (Error) The " << isaName(isa_) << " ray-triangle test is not supported on this processor" << std::endl;
+    exit(1);
+  }
+  isa = isa_;
+  switch (isa) {
+#ifdef HEMO_TRIANGLE_PACKET_X86
+    case Isa::avx512: crossLanesIsa = crossLanesAVX512; break;
+    case Isa::avx2: crossLanesIsa = crossLanesAVX2; break;
+#endif
+    default: crossLanesIsa = crossLanesGeneric; break;
+  }
+}
+}
@@ -26,52 +26,72 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "array.h" // Need to make pointers to particle object
 
-namespace hemo {
-  inline int MollerTrumbore(const hemo::Array<T,3> & v0, const hemo::Array<T,3> & v1,
-	  const hemo::Array<T,3> & v2, hemo::Array<plint, 3> & rayPoint) {
-    const T EPSILON = 0.0000001;
-    T det,invDet,u,v; // Some floats
-    hemo::Array<T, 3> edge1, edge2, pvec, svec, qvec;
-    hemo::Array<T, 3> rayVector = {(T)-40,(T)-40,(T)-40};
-    hemo::Array<plint,3> & rayOrigin = rayPoint;
-
-    // Define edges
-    edge1 = v1 - v0;  
-    edge2 = v2 - v0; 
-
-    pvec = hemo::crossProduct(rayVector, edge2);
-    det = hemo::dot(edge1, pvec);
-
-    if (det > -EPSILON && det < EPSILON) {
-      return 0;
-    }
-
-    invDet = 1/det;
-
-    // Construct s
-    svec = rayOrigin - v0;
-    u = invDet*hemo::dot(svec, pvec);
-
-    if (u < 0.0 || u > 1.0) {
-      return 0;
-    }
-
-    qvec = hemo::crossProduct(svec, edge1);
-    v = invDet * hemo::dot(rayVector, qvec);
-
-    if (v < 0.0 || u + v > 1.0) {
-      return 0;
-    }
+#include <string>
 
-    // Check where the intersection point is
-    float t = invDet*hemo::dot(edge2, qvec);
-
-    if (t > EPSILON) {
-      return 1;
+namespace hemo {
+/**
+ * Crossings of a line parallel to the x axis with a packet of eight triangles.
+ *
+ * For a ray along an axis the barycentric coordinates u and v of Moller-Trumbore
+ * reduce to the 2D edge functions of the triangle projected on the yz plane,
+ * with the vertices translated to the line. Every edge function is evaluated
+ * with the edge vertices ordered by vertex id, so two triangles sharing an edge
+ * compute exactly the same value for it. A line through an edge or a vertex is
+ * then counted for exactly one of the triangles around it with the top-left
+ * rule, and a line touching the membrane without passing it is counted zero or
+ * two times. This makes the even-odd inner node test exact for closed meshes,
+ * where the fixed (-40,-40,-40) ray direction could count an edge twice or not
+ * at all and misclassify the node.
+ *
+ * The lanes are compiled for AVX-512, AVX2 and the baseline of the processor
+ * family (mollerTrumbore.cpp is built without -march=native), the best one the
+ * processor supports is chosen at runtime.
+ */
+class TrianglePacket {
+public:
+  static const int width = 8;
+  enum class Isa { generic, avx2, avx512 };
+
+  TrianglePacket() { clear(); }
+
+  /// Add triangle t with vertices a,b,c and vertex ids ia,ib,ic, the packet must not be full
+  void add(int t, const hemo::Array<T,3> & a, const hemo::Array<T,3> & b, const hemo::Array<T,3> & c,
+           plint ia, plint ib, plint ic) {
+    const hemo::Array<T,3> * v[3] = {&a, &b, &c};
+    const plint id[3] = {ia, ib, ic};
+    for (int k = 0; k < 3; k++) {
+      x[k][size] = (*v[k])[0];
+      y[k][size] = (*v[k])[1];
+      z[k][size] = (*v[k])[2];
+      // Edge k runs from vertex k+1 to vertex k+2
+      sign[k][size] = id[(k+1)%3] < id[(k+2)%3] ? 1. : -1.;
     }
-
-    return 0;
+    triangle[size++] = t;
   }
+
+  /// Reset to an empty packet, the unused lanes are degenerate triangles
+  void clear();
+  bool full() const { return size == width; }
+  bool empty() const { return size == 0; }
+
+  /// Test the line through (yLine,zLine) parallel to the x axis, returns the
+  /// bit mask of the crossed lanes, with the x of the crossing in xCross
+  unsigned int cross(T yLine, T zLine, T xCross[width]) const;
+
+  static void setIsa(Isa isa_);
+  static Isa getIsa();
+  static bool isaSupported(Isa isa_);
+  static std::string isaName(Isa isa_);
+
+  alignas(64) T x[3][width];
+  alignas(64) T y[3][width];
+  alignas(64) T z[3][width];
+  /// 1 if the vertex ids of edge k are ascending, -1 otherwise
+  alignas(64) T sign[3][width];
+  /// Triangle of every lane, as given to add()
+  int triangle[width];
+  int size;
+};
 }
 
 #endif
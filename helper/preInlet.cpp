@@ -129,12 +129,10 @@ void PreInlet::applyPreInletParticleBoundary() {
     hemocell->cellfields->deleteIncompleteCells(false);   
   }
   vector<MPI_Request> requests;
-  vector<vector<char>> buffers;
   MPI_Barrier(MPI_COMM_WORLD);
   if (partOfpreInlet) {
     if(particleSendMpi.find(global::mpi().getRank()) != particleSendMpi.end()) {
       for (plint bid : communicationBlocks) {
-        buffers.push_back(vector<char>());
         Box3D domain = fluidInlet;
         if (direction == Direction::Xneg) {
           domain.x0 = domain.x0 - preinlet_length;
@@ -163,11 +161,14 @@ void PreInlet::applyPreInletParticleBoundary() {
 
         Dot3D shift = hemocell->cellfields->immersedParticles->getComponent(bid).getLocation();
         domain = domain.shift(-shift.x,-shift.y,-shift.z);
-        hemocell->cellfields->immersedParticles->getComponent(bid).particleDataTransfer.send_preinlet(domain,buffers.back(),modif::hemocell);
+        //send_preinlet casts back to NoInitChar internally, so the pooled buffer can be passed directly
+        vector<char> & buffer = reinterpret_cast<vector<char>&>(particleBuffers.getSendBuffer(bid));
+        hemocell->cellfields->immersedParticles->getComponent(bid).particleDataTransfer.send_preinlet(domain,buffer,modif::hemocell);
+        particleBuffers.getSendBuffer(bid,buffer.size()); //Register the size in the high-water mark
         for (auto & pair : particleReceiveMpi) {
           const int & pid = pair.first;
           requests.push_back(MPI_Request());
-          MPI_Isend(&buffers.back()[0],buffers.back().size(),MPI_CHAR,pid,0,MPI_COMM_WORLD,&requests.back());
+          MPI_Isend(buffer.data(),buffer.size(),MPI_CHAR,pid,0,MPI_COMM_WORLD,&requests.back());
         }
       }
     }
@@ -179,8 +180,8 @@ void PreInlet::applyPreInletParticleBoundary() {
         int count;
         MPI_Probe(MPI_ANY_SOURCE,0,MPI_COMM_WORLD,&status);
         MPI_Get_count(&status,MPI_CHAR,&count);
-        buffers.push_back(vector<char>(count));
-        MPI_Recv(&buffers.back()[0],count,MPI_CHAR,status.MPI_SOURCE,0,MPI_COMM_WORLD,MPI_STATUS_IGNORE);
+        char * buffer = (char*)particleBuffers.getRecvBuffer(status.MPI_SOURCE,count).data();
+        MPI_Recv(buffer,count,MPI_CHAR,status.MPI_SOURCE,0,MPI_COMM_WORLD,MPI_STATUS_IGNORE);
         Dot3D offset(0,0,0);
         if (direction == Direction::Xneg) {
           offset.x = preinlet_length;
@@ -202,7 +203,7 @@ void PreInlet::applyPreInletParticleBoundary() {
         }
         for (int bId : hemocell->cellfields->immersedParticles->getLocalInfo().getBlocks()) {
   
-          hemocell->cellfields->immersedParticles->getComponent(bId).particleDataTransfer.receivePreInlet(&buffers.back()[0],buffers.back().size(),modif::hemocell,offset);
+          hemocell->cellfields->immersedParticles->getComponent(bId).particleDataTransfer.receivePreInlet(buffer,count,modif::hemocell,offset);
           hemocell->cellfields->immersedParticles->getComponent(bId).invalidate_ppc();
           hemocell->cellfields->immersedParticles->getComponent(bId).invalidate_lpc();
           hemocell->cellfields->immersedParticles->getComponent(bId).invalidate_pg();
@@ -210,53 +211,117 @@ void PreInlet::applyPreInletParticleBoundary() {
       }
     }
   }
+  particleBuffers.reportStatistics(global.statistics.getCurrent());
   MPI_Barrier(MPI_COMM_WORLD);
   global.statistics.getCurrent().stop();
 }
-void PreInlet::applyPreInletVelocityBoundary() {
-  global.statistics.getCurrent()["applyPreInletVelocityBoundary"].start();
-  MPI_Barrier(MPI_COMM_WORLD);
-  vector<MPI_Request> reqs;
-  Box3D & domain = fluidInlet;
-  Box3D result;
-  int z_o = domain.getNz();
-  int y_o = domain.getNy();
-  int tag;
-  plb::Array<T,3> vel;
-  for (int bId : hemocell->lattice->getLocalInfo().getBlocks()) {
+void PreInlet::mapVelocityExchange() {
+  const bool sender = hemocell->partOfpreInlet;
+  MultiBlockManagement3D & other = sender ? *hemocell->domain_lattice_management : *hemocell->preinlet_lattice_management;
+  // Nodes of the inlet plane in the local blocks, per rank that has them on the other side.
+  // Every rank pair that shares a node has an entry on both sides, the fluid nodes are chosen by the domain
+  map<int,vector<plint>> shared;
+  for (plint bId : hemocell->lattice->getLocalInfo().getBlocks()) {
     Box3D bulk = hemocell->lattice->getMultiBlockManagement().getBulk(bId);
-    if (!intersect(domain,bulk,result)) { continue; }
-  
-    const Dot3D & loc = hemocell->lattice->getComponent(bId).getLocation();
-    result = result.shift(-loc.x,-loc.y,-loc.z);
-    
-    for (int x  = result.x0 ; x <= result.x1 ; x++) {
-     for (int y  = result.y0 ; y <= result.y1 ; y++) {
-      for (int z  = result.z0 ; z <= result.z1 ; z++) {
-        tag = ((z_o * ((z + loc.z) - domain.z0)) + ( y + loc.y ) - domain.y0) * y_o + x + loc.x - domain.x0;
-        if (!hemocell->lattice->get(x,y,z).getDynamics().isBoundary()) {
-          if (hemocell->partOfpreInlet) {
-            hemocell->lattice->getComponent(bId).get(x,y,z).computeVelocity(vel);
-            int dest = hemocell->domain_lattice_management->getThreadAttribution().getMpiProcess(hemocell->domain_lattice_management->getSparseBlockStructure().locate(x+loc.x,y+loc.y,z+loc.z));
-            reqs.emplace_back();
-            MPI_Isend(&vel[0],3*sizeof(T),MPI_CHAR,dest,tag,MPI_COMM_WORLD,&reqs.back());
-          } else {
-            Box3D point(x,x,y,y,z,z);
-            int source = hemocell->preinlet_lattice_management->getThreadAttribution().getMpiProcess(hemocell->preinlet_lattice_management->getSparseBlockStructure().locate(x+loc.x,y+loc.y,z+loc.z));
-            MPI_Recv(&vel[0],3*sizeof(T),MPI_CHAR,source,tag,MPI_COMM_WORLD,MPI_STATUS_IGNORE);
-            setBoundaryVelocity(hemocell->lattice->getComponent(bId),point,vel);
-          }
-        }
+    Box3D result;
+    if (!intersect(fluidInlet,bulk,result)) { continue; }
+    BlockLattice3D<FLUID_T,DESCRIPTOR> & block = hemocell->lattice->getComponent(bId);
+    const Dot3D & loc = block.getLocation();
+    for (plint x = result.x0 ; x <= result.x1 ; x++) {
+     for (plint y = result.y0 ; y <= result.y1 ; y++) {
+      for (plint z = result.z0 ; z <= result.z1 ; z++) {
+        const int rank = other.getThreadAttribution().getMpiProcess(other.getSparseBlockStructure().locate(x,y,z));
+        vector<plint> & nodes = shared[rank];
+        if (!sender && block.get(x-loc.x,y-loc.y,z-loc.z).getDynamics().isBoundary()) { continue; }
+        nodes.insert(nodes.end(),{x,y,z});
       }
      }
     }
   }
-  MPI_Waitall(reqs.size(),&reqs[0],MPI_STATUS_IGNORE);
+
+  // The domain tells the preinlet which nodes it wants, in the order they are sent
+  vector<MPI_Request> requests;
+  if (!sender) {
+    for (auto & pair : shared) {
+      requests.emplace_back();
+      MPI_Isend(pair.second.data(),pair.second.size(),MPI_LONG,pair.first,45,MPI_COMM_WORLD,&requests.back());
+    }
+  } else {
+    for (auto & pair : shared) {
+      int count;
+      MPI_Status status;
+      MPI_Probe(pair.first,45,MPI_COMM_WORLD,&status);
+      MPI_Get_count(&status,MPI_LONG,&count);
+      pair.second.resize(count);
+      MPI_Recv(pair.second.data(),count,MPI_LONG,pair.first,45,MPI_COMM_WORLD,MPI_STATUS_IGNORE);
+    }
+  }
+  MPI_Waitall(requests.size(),requests.data(),MPI_STATUSES_IGNORE);
+
+  for (auto & pair : shared) {
+    if (pair.second.empty()) { continue; }
+    velocityExchanges.emplace_back();
+    VelocityExchange & exchange = velocityExchanges.back();
+    exchange.rank = pair.first;
+    for (pluint i = 0 ; i < pair.second.size() ; i += 3) {
+      const plint x = pair.second[i], y = pair.second[i+1], z = pair.second[i+2];
+      const plint bId = hemocell->lattice->getSparseBlockStructure().locate(x,y,z);
+      const Dot3D & loc = hemocell->lattice->getComponent(bId).getLocation();
+      exchange.blocks.push_back(bId);
+      exchange.nodes.push_back(Dot3D(x-loc.x,y-loc.y,z-loc.z));
+    }
+    exchange.buffer.resize(3*exchange.nodes.size());
+  }
+  // The buffers do not move anymore, so the requests can point to them
+  velocityRequests.resize(velocityExchanges.size());
+  for (pluint i = 0 ; i < velocityExchanges.size() ; i++) {
+    VelocityExchange & exchange = velocityExchanges[i];
+    if (sender) {
+      MPI_Send_init(exchange.buffer.data(),exchange.buffer.size(),MPI_DOUBLE,exchange.rank,46,MPI_COMM_WORLD,&velocityRequests[i]);
+    } else {
+      MPI_Recv_init(exchange.buffer.data(),exchange.buffer.size(),MPI_DOUBLE,exchange.rank,46,MPI_COMM_WORLD,&velocityRequests[i]);
+    }
+  }
+  velocityExchangeMapped = true;
+}
+
+void PreInlet::applyPreInletVelocityBoundary() {
+  global.statistics.getCurrent()["applyPreInletVelocityBoundary"].start();
+  if (!velocityExchangeMapped) {
+    mapVelocityExchange();
+  }
+  plb::Array<FLUID_T,3> vel;
+  if (hemocell->partOfpreInlet) {
+    for (VelocityExchange & exchange : velocityExchanges) {
+      for (pluint i = 0 ; i < exchange.nodes.size() ; i++) {
+        const Dot3D & node = exchange.nodes[i];
+        hemocell->lattice->getComponent(exchange.blocks[i]).get(node.x,node.y,node.z).computeVelocity(vel);
+        exchange.buffer[3*i] = vel[0];
+        exchange.buffer[3*i+1] = vel[1];
+        exchange.buffer[3*i+2] = vel[2];
+      }
+    }
+  }
+  MPI_Startall(velocityRequests.size(),velocityRequests.data());
+  MPI_Waitall(velocityRequests.size(),velocityRequests.data(),MPI_STATUSES_IGNORE);
+  if (!hemocell->partOfpreInlet) {
+    for (VelocityExchange & exchange : velocityExchanges) {
+      for (pluint i = 0 ; i < exchange.nodes.size() ; i++) {
+        const Dot3D & node = exchange.nodes[i];
+        vel[0] = exchange.buffer[3*i];
+        vel[1] = exchange.buffer[3*i+1];
+        vel[2] = exchange.buffer[3*i+2];
+        Box3D point(node.x,node.x,node.y,node.y,node.z,node.z);
+        setBoundaryVelocity(hemocell->lattice->getComponent(exchange.blocks[i]),point,vel);
+      }
+    }
+  }
+  global.statistics.getCurrent().count("preInletVelocityMessages", velocityRequests.size());
   global.statistics.getCurrent().stop();
 }
 void PreInlet::initializePreInletVelocityBoundary() {
-  OnLatticeBoundaryCondition3D<T,DESCRIPTOR>* bc =
-        createZouHeBoundaryCondition3D<T,DESCRIPTOR>();
+  OnLatticeBoundaryCondition3D<FLUID_T,DESCRIPTOR>* bc =
+        createZouHeBoundaryCondition3D<FLUID_T,DESCRIPTOR>();
   Box3D domain;
   intersect(flagMatrix->getBoundingBox(),location,domain);
   if (direction == Direction::Xneg) {
@@ -309,8 +374,8 @@ void PreInlet::initializePreInletVelocityBoundary() {
 }
 
 void PreInlet::preInletFromSlice(Direction direction_, Box3D boundary) {
-  OnLatticeBoundaryCondition3D<T,DESCRIPTOR>* bc =
-        createZouHeBoundaryCondition3D<T,DESCRIPTOR>();
+  OnLatticeBoundaryCondition3D<FLUID_T,DESCRIPTOR>* bc =
+        createZouHeBoundaryCondition3D<FLUID_T,DESCRIPTOR>();
   direction = direction_;
   initialized = true;
 
@@ -570,8 +635,14 @@ PreInlet::PreInlet(HemoCell * hemocell_, plb::MultiBlockManagement3D & managemen
   preinlet_length = (*hemocell->cfg)["preInlet"]["parameters"]["lengthN"].read<int>();
 }
 
+PreInlet::~PreInlet() {
+  for (MPI_Request & request : velocityRequests) {
+    MPI_Request_free(&request);
+  }
+}
+
 void PreInlet::CreateDrivingForceFunctional::processGenericBlocks(plb::Box3D domain, std::vector<plb::AtomicBlock3D*> blocks) {
-  BlockLattice3D<T,DESCRIPTOR> * ff = dynamic_cast<BlockLattice3D<T,DESCRIPTOR>*>(blocks[0]);
+  BlockLattice3D<FLUID_T,DESCRIPTOR> * ff = dynamic_cast<BlockLattice3D<FLUID_T,DESCRIPTOR>*>(blocks[0]);
   for (plint iX=domain.x0; iX<=domain.x1; ++iX) {
     for (plint iY=domain.y0; iY<=domain.y1; ++iY) {
       for (plint iZ=domain.z0; iZ<=domain.z1; ++iZ) {
@@ -584,7 +655,7 @@ void PreInlet::CreateDrivingForceFunctional::processGenericBlocks(plb::Box3D dom
 }
 
 void PreInlet::FillFlagMatrix::processGenericBlocks(plb::Box3D domain, std::vector<plb::AtomicBlock3D*> blocks) {
-  BlockLattice3D<T,DESCRIPTOR> * ff = dynamic_cast<BlockLattice3D<T,DESCRIPTOR>*>(blocks[0]);
+  BlockLattice3D<FLUID_T,DESCRIPTOR> * ff = dynamic_cast<BlockLattice3D<FLUID_T,DESCRIPTOR>*>(blocks[0]);
   ScalarField3D<int> * sf = dynamic_cast<ScalarField3D<int>*>(blocks[1]);
   for (int x  = domain.x0 ; x <= domain.x1 ; x++) {
     for (int y  = domain.y0 ; y <= domain.y1 ; y++) {
@@ -743,7 +814,7 @@ void PreInlet::setDrivingForceTimeDependent(double t) {
     double current_vel = PreInlet::interpolate(normalizedVelocityTimes, normalizedVelocityValues, t, false);
     double currentDrivingForce = (current_vel / average_vel) * drivingForce;
 
-    plb::Array<T,3> force(0.,0.,0.);
+    plb::Array<FLUID_T,3> force(0.,0.,0.);
     if (direction == Direction::Xneg) {
       force[0] = currentDrivingForce;
     } 
@@ -770,7 +841,7 @@ void PreInlet::setDrivingForceTimeDependent(double t) {
 
 void PreInlet::setDrivingForce() {
   if (partOfpreInlet) {
-    plb::Array<T,3> force(0.,0.,0.);
+    plb::Array<FLUID_T,3> force(0.,0.,0.);
     if (direction == Direction::Xneg) {
       force[0] = drivingForce;
     } 
@@ -804,27 +875,27 @@ void PreInlet::createBoundary() {
         bool fluid = false;
         if (direction == Direction::Xneg || direction == Direction::Xpos) {
           if (y == location.y0-1 || z == location.z0-1) {
-            defineDynamics(*hemocell->lattice,x,y,z, new BounceBack<T,DESCRIPTOR>(1.));
+            defineDynamics(*hemocell->lattice,x,y,z, new BounceBack<FLUID_T,DESCRIPTOR>(1.));
             continue;
           }
           fluid = flagMatrix->get(fluidInlet.x0,y,z);
         }
         if (direction == Direction::Yneg || direction == Direction::Ypos) {
           if (x == location.x0-1 || z == location.z0-1) {
-            defineDynamics(*hemocell->lattice,x,y,z, new BounceBack<T,DESCRIPTOR>(1.));
+            defineDynamics(*hemocell->lattice,x,y,z, new BounceBack<FLUID_T,DESCRIPTOR>(1.));
             continue;
           }
           fluid = flagMatrix->get(x,fluidInlet.y0,z);
         }
         if (direction == Direction::Zneg || direction == Direction::Zpos) {
           if (x == location.x0-1 || y == location.y0-1) {
-            defineDynamics(*hemocell->lattice,x,y,z, new BounceBack<T,DESCRIPTOR>(1.));
+            defineDynamics(*hemocell->lattice,x,y,z, new BounceBack<FLUID_T,DESCRIPTOR>(1.));
             continue;
           }
           fluid = flagMatrix->get(x,y,fluidInlet.z0);
         }
         if(partOfpreInlet && !fluid) {
-          defineDynamics(*hemocell->lattice,x,y,z, new BounceBack<T,DESCRIPTOR>(1.));
+          defineDynamics(*hemocell->lattice,x,y,z, new BounceBack<FLUID_T,DESCRIPTOR>(1.));
         }
       }
     }
@@ -31,8 +31,11 @@ class PreInlet;
 #include "core/geometry3D.h"
 #include "atomicBlock/atomicBlock3D.h"
 #include "config.h"
+#include "communicationBufferPool.h"
 #include "hemocell.h"
 
+#include <mpi.h>
+
 #ifndef HEMOCELL_H
 namespace hemo {
   class HemoCell;
@@ -81,6 +84,7 @@ public:
   
   PreInlet(hemo::HemoCell * hemocell_, plb::MultiScalarField3D<int> * flagMatrix_);
   PreInlet(hemo::HemoCell * hemocell_, plb::MultiBlockManagement3D & management);
+  ~PreInlet();
   inline plint getNumberOfNodes() { return cellsInBoundingBox(location);}
   void createBoundary();
   bool readNormalizedVelocities();
@@ -124,6 +128,23 @@ public:
   std::vector<int> particle_senders;
   HemoCell * hemocell;
   MultiScalarField3D<int> *flagMatrix = 0; 
+  ///Persistent buffers for the particle exchange, send buffers per block id, receive buffers per rank
+  CommunicationBufferPool particleBuffers{"preInletParticles"};
+
+  ///Velocities of the fluid inlet nodes exchanged with one rank of the other side of the preinlet
+  struct VelocityExchange {
+    int rank;
+    ///Block id and local coordinates of every node, in the order of the buffer
+    std::vector<plint> blocks;
+    std::vector<plb::Dot3D> nodes;
+    std::vector<T> buffer;
+  };
+  ///One message per pair of ranks, mapped on the first applyPreInletVelocityBoundary()
+  std::vector<VelocityExchange> velocityExchanges;
+  ///Persistent requests of velocityExchanges
+  std::vector<MPI_Request> velocityRequests;
+  bool velocityExchangeMapped = false;
+  void mapVelocityExchange();
 };
 
 }
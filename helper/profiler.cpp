@@ -110,6 +110,7 @@ void Profiler::stop() {
 void Profiler::reset() {
   started = false;
   total_time = std::chrono::high_resolution_clock::duration::zero();
+  counters.clear();
   
   //Reset all child timers
   for (std::pair<const std::string,Profiler> & timer_pair : timers) {
@@ -141,6 +142,10 @@ void Profiler::printStatistics_inner(int level, T & out) {
   } else {
     out << std::string(level,' ') << name << ": " << std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(total_time + (std::chrono::high_resolution_clock::now() - start_time)).count()/1000.0) << std::endl;
   }
+  //Print all counters
+  for (std::pair<const std::string,long> & counter_pair : counters) {
+    out << std::string(level+1,' ') << "#" << counter_pair.first << ": " << counter_pair.second << std::endl;
+  }
   //Print all child timers
   for (std::pair<const std::string,Profiler> & timer_pair : timers) {
     Profiler & timer = timer_pair.second;
@@ -195,6 +200,24 @@ Profiler & Profiler::getCurrent() {
   return *current;
 }
 
+void Profiler::count(std::string counter, long value) {
+  counters[counter] += value;
+}
+
+void Profiler::countMax(std::string counter, long value) {
+  long & current_value = counters[counter];
+  if (value > current_value) {
+    current_value = value;
+  }
+}
+
+long Profiler::getCounter(std::string counter) {
+  if (counters.find(counter) == counters.end()) {
+    return 0;
+  }
+  return counters.at(counter);
+}
+
 std::string Profiler::toString(std::chrono::high_resolution_clock::duration time) {
   return std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(time).count()/1000.0);
 }
@@ -43,6 +43,9 @@ namespace hemo {
  * started (sub)timer. With this functionality you can time a function
  * which is called through different paths as different functions in the
  * hierarchy.
+ *
+ * Next to timings a Profiler can hold named counters (e.g. buffer sizes), these
+ * are printed together with the timings.
  */
 class Profiler {
 public:
@@ -60,6 +63,12 @@ public:
   Profiler & operator[] (std::string);
   Profiler & getCurrent();
 
+  /// Add value to the named counter
+  void count(std::string counter, long value = 1);
+  /// Keep the maximum of the named counter and value (high-water mark)
+  void countMax(std::string counter, long value);
+  long getCounter(std::string counter);
+
   std::string static toString(std::chrono::high_resolution_clock::duration);
 
 private:
@@ -71,9 +80,25 @@ private:
   bool started = false;
   const std::string name;
   std::map<std::string,Profiler> timers;
+  std::map<std::string,long> counters;
   Profiler & parent;
   Profiler * current = this;
 };
+
+/**
+ * Adds the wall clock time (seconds) of its scope to a plain counter, used for
+ * per atomic block timings where a named Profiler per block would be too heavy
+ */
+class ScopedBlockTimer {
+public:
+  ScopedBlockTimer(double & time_) : time(time_) {}
+  ~ScopedBlockTimer() {
+    time += std::chrono::duration<double>(std::chrono::high_resolution_clock::now()-start_time).count();
+  }
+private:
+  double & time;
+  const std::chrono::high_resolution_clock::time_point start_time = std::chrono::high_resolution_clock::now();
+};
 }
 #endif /* PROFILER_H */
 
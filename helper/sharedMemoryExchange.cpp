@@ -0,0 +1,112 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "sharedMemoryExchange.h"
+#include "logfile.h"
+
+#include <vector>
+
+namespace hemo {
+
+//Every published buffer starts with its size, padded to keep the data aligned
+static const std::size_t headerSize = 2*sizeof(std::size_t);
+
+SharedMemoryExchange::SharedMemoryExchange() {
+  MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &nodeComm);
+
+  int nodeSize_;
+  MPI_Comm_size(nodeComm,&nodeSize_);
+  MPI_Group worldGroup, nodeGroup;
+  MPI_Comm_group(MPI_COMM_WORLD,&worldGroup);
+  MPI_Comm_group(nodeComm,&nodeGroup);
+  std::vector<int> nodeRanks(nodeSize_), worldRanks(nodeSize_);
+  for (int i = 0 ; i < nodeSize_ ; i++) { nodeRanks[i] = i; }
+  MPI_Group_translate_ranks(nodeGroup,nodeSize_,nodeRanks.data(),worldGroup,worldRanks.data());
+  for (int i = 0 ; i < nodeSize_ ; i++) {
+    worldToNode[worldRanks[i]] = i;
+  }
+  MPI_Group_free(&worldGroup);
+  MPI_Group_free(&nodeGroup);
+
+  allocate(0);
+  hlog << "(SharedMemoryExchange) " << nodeSize_ << " processes share the node of process 0" << std::endl;
+}
+
+SharedMemoryExchange::~SharedMemoryExchange() {
+  free();
+  if (nodeComm != MPI_COMM_NULL) {
+    MPI_Comm_free(&nodeComm);
+  }
+}
+
+void SharedMemoryExchange::allocate(std::size_t capacity_) {
+  capacity = capacity_;
+  MPI_Win_allocate_shared(capacity+headerSize,1,MPI_INFO_NULL,nodeComm,&base,&window);
+  *((std::size_t*)base) = 0;
+  MPI_Win_lock_all(MPI_MODE_NOCHECK,window);
+}
+
+void SharedMemoryExchange::free() {
+  if (window != MPI_WIN_NULL) {
+    MPI_Win_unlock_all(window);
+    MPI_Win_free(&window);
+    base = 0;
+  }
+}
+
+char * SharedMemoryExchange::beginPublish(std::size_t size) {
+  int grow = size > capacity;
+  MPI_Allreduce(MPI_IN_PLACE,&grow,1,MPI_INT,MPI_LOR,nodeComm);
+  if (grow) {
+    std::size_t newCapacity = capacity;
+    if (size > capacity) {
+      //Some headroom, so we do not reallocate on every small increase
+      newCapacity = size + size/2;
+    }
+    free();
+    allocate(newCapacity);
+  }
+  *((std::size_t*)base) = size;
+  return base + headerSize;
+}
+
+void SharedMemoryExchange::publish() {
+  MPI_Win_sync(window);
+  MPI_Barrier(nodeComm);
+  MPI_Win_sync(window);
+}
+
+const char * SharedMemoryExchange::getPublished(int worldRank, std::size_t & size) {
+  MPI_Aint segmentSize;
+  int dispUnit;
+  char * segment;
+  MPI_Win_shared_query(window,worldToNode.at(worldRank),&segmentSize,&dispUnit,&segment);
+  size = *((std::size_t*)segment);
+  return segment + headerSize;
+}
+
+void SharedMemoryExchange::release() {
+  MPI_Barrier(nodeComm);
+}
+
+}
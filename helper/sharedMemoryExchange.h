@@ -0,0 +1,72 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef HEMO_SHARED_MEMORY_EXCHANGE_H
+#define HEMO_SHARED_MEMORY_EXCHANGE_H
+
+#include <mpi.h>
+#include <cstddef>
+#include <map>
+
+namespace hemo {
+/**
+ * Publish a buffer per process in an MPI-3 shared memory window, so that
+ * processes on the same node (MPI_COMM_TYPE_SHARED) can read each others data
+ * directly instead of going through point-to-point messages.
+ *
+ * Every exchange is a collective over the node:
+ *   - beginPublish() returns the (grown if necessary) buffer of this process
+ *   - publish() makes the buffers of all processes on the node readable
+ *   - getPublished() returns a pointer directly into the buffer of another process
+ *   - release() marks that everybody is done reading, before the next write
+ *
+ * The capacity of the window only ever grows, growing requires a collective
+ * reallocation of the window on the node.
+ */
+class SharedMemoryExchange {
+public:
+  SharedMemoryExchange();
+  ~SharedMemoryExchange();
+
+  /// Whether the given process (rank in MPI_COMM_WORLD) shares this node
+  bool onNode(int worldRank) const { return worldToNode.find(worldRank) != worldToNode.end(); }
+  int nodeSize() const { return worldToNode.size(); }
+
+  char * beginPublish(std::size_t size);
+  void publish();
+  /// Pointer to the published buffer of an on-node process, size is set to its length in bytes
+  const char * getPublished(int worldRank, std::size_t & size);
+  void release();
+
+private:
+  void allocate(std::size_t capacity_);
+  void free();
+
+  MPI_Comm nodeComm = MPI_COMM_NULL;
+  MPI_Win window = MPI_WIN_NULL;
+  char * base = 0;
+  std::size_t capacity = 0;
+  std::map<int,int> worldToNode;
+};
+}
+#endif
@@ -0,0 +1,478 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "stokesInitializer.h"
+#include "hemocell.h"
+#include "interiorViscosity.h"
+#include "palabos3D.h"
+#include "palabos3D.hh"
+
+#include <algorithm>
+#include <map>
+#include <mpi.h>
+
+namespace hemo {
+using namespace plb;
+
+typedef DESCRIPTOR<T> D;
+
+StokesInitializer::StokesInitializer(HemoCell & hemocell_, unsigned int coarsening, T tolerance_, unsigned int maxIterations_) :
+  hemocell(hemocell_), c(coarsening), tolerance(tolerance_), maxIterations(maxIterations_)
+{
+  if (!hemocell.lattice) {
+    hlog << "(StokesInitializer) (Error) The lattice must be initialized before the flow can be initialized" << endl;
+    exit(1);
+  }
+  if (c < 1) {
+    hlog << "(StokesInitializer) (Error) The coarsening must be at least 1" << endl;
+    exit(1);
+  }
+}
+
+bool StokesInitializer::lineFluid(unsigned int d, const plint I[3], plint x) const {
+  const unsigned int a = (d+1)%3, b = (d+2)%3;
+  return lines[d][(I[a]*nc[b] + I[b])*n[d] + x];
+}
+
+char * StokesInitializer::allocateShared(MPI_Aint size, MPI_Win & window) {
+  char * base;
+  MPI_Win_allocate_shared(leader ? size : 0, 1, MPI_INFO_NULL, nodeComm, &base, &window);
+  MPI_Aint segmentSize;
+  int dispUnit;
+  MPI_Win_shared_query(window, 0, &segmentSize, &dispUnit, &base);
+  MPI_Win_lock_all(MPI_MODE_NOCHECK, window);
+  return base;
+}
+
+void StokesInitializer::freeShared(MPI_Win & window) {
+  if (window != MPI_WIN_NULL) {
+    MPI_Win_unlock_all(window);
+    MPI_Win_free(&window);
+  }
+}
+
+void StokesInitializer::syncShared(MPI_Win window) {
+  MPI_Win_sync(window);
+  MPI_Barrier(nodeComm);
+  MPI_Win_sync(window);
+}
+
+void StokesInitializer::gatherGeometry() {
+  MultiBlockLattice3D<FLUID_T,DESCRIPTOR> & lattice = *hemocell.lattice;
+  n[0] = lattice.getNx(); n[1] = lattice.getNy(); n[2] = lattice.getNz();
+  for (unsigned int d = 0; d < 3; d++) {
+    periodic[d] = lattice.periodicity().get(d);
+    nc[d] = (n[d] - 1)/c + 1;
+  }
+  size_t size[3], total = 0;
+  for (unsigned int d = 0; d < 3; d++) {
+    size[d] = size_t(nc[(d+1)%3])*nc[(d+2)%3]*n[d];
+    total += size[d];
+  }
+  char * base = allocateShared(total, geometryWindow);
+  for (unsigned int d = 0; d < 3; d++) {
+    lines[d] = (unsigned char *)base + (d ? size[0] : 0) + (d > 1 ? size[1] : 0);
+  }
+  if (leader) {
+    std::fill(lines[0], lines[0] + total, 0);
+  }
+  syncShared(geometryWindow);
+
+  // Every lattice node is in the bulk of exactly one block, so every rank fills
+  // in its own nodes and the maximum over the nodes is the complete geometry
+  for (plint bId : lattice.getLocalInfo().getBlocks()) {
+    BlockLattice3D<FLUID_T,DESCRIPTOR> & block = lattice.getComponent(bId);
+    const Dot3D & location = block.getLocation();
+    Box3D bulk;
+    lattice.getSparseBlockStructure().getBulk(bId, bulk);
+    for (plint x = bulk.x0; x <= bulk.x1; x++) {
+      for (plint y = bulk.y0; y <= bulk.y1; y++) {
+        for (plint z = bulk.z0; z <= bulk.z1; z++) {
+          const plint g[3] = {x, y, z};
+          const bool onCoarse[3] = {x%c == 0, y%c == 0, z%c == 0};
+          if (onCoarse[0] + onCoarse[1] + onCoarse[2] < 2) {
+            continue;
+          }
+          const unsigned char isFluid = !block.get(x - location.x, y - location.y, z - location.z).getDynamics().isBoundary();
+          for (unsigned int d = 0; d < 3; d++) {
+            const unsigned int a = (d+1)%3, b = (d+2)%3;
+            if (onCoarse[a] && onCoarse[b]) {
+              lines[d][((g[a]/c)*nc[b] + g[b]/c)*n[d] + g[d]] = isFluid;
+            }
+          }
+        }
+      }
+    }
+  }
+  syncShared(geometryWindow);
+  if (!leader) {
+    return;
+  }
+  // In chunks, the geometry can have more entries than an int counts
+  const size_t chunk = size_t(1) << 30;
+  for (size_t offset = 0; offset < total; offset += chunk) {
+    MPI_Allreduce(MPI_IN_PLACE, lines[0] + offset, std::min(chunk, total - offset), MPI_UNSIGNED_CHAR, MPI_MAX, leaderComm);
+  }
+
+  fluid.assign(nc[0]*nc[1]*nc[2], 0);
+  for (plint I = 0; I < nc[0]; I++) {
+    for (plint J = 0; J < nc[1]; J++) {
+      for (plint K = 0; K < nc[2]; K++) {
+        const plint node[3] = {I, J, K};
+        fluid[coarseIndex(I, J, K)] = lineFluid(0, node, I*c);
+      }
+    }
+  }
+}
+
+void StokesInitializer::buildStencils() {
+  stencils.clear();
+  ghosts.clear();
+  for (plint I = 0; I < nc[0]; I++) {
+    for (plint J = 0; J < nc[1]; J++) {
+      for (plint K = 0; K < nc[2]; K++) {
+        if (!fluid[coarseIndex(I, J, K)]) {
+          continue;
+        }
+        const plint node[3] = {I, J, K};
+        Stencil stencil;
+        stencil.node = coarseIndex(I, J, K);
+        stencil.diagonal = 0.;
+        for (unsigned int d = 0; d < 3; d++) {
+          long neighbour[2];
+          T distance[2];
+          bool open[2];
+          for (int side = 0; side < 2; side++) {
+            const int s = side ? 1 : -1;
+            plint other[3] = {I, J, K};
+            other[d] += s;
+            plint h = c;
+            bool inRange = other[d] >= 0 && other[d] < nc[d];
+            if (!inRange && periodic[d]) {
+              h = n[d] - c*(nc[d] - 1);
+              other[d] = side ? 0 : nc[d] - 1;
+              inRange = true;
+            }
+            // Walk the lattice nodes towards the neighbour, the wall is halfway
+            // to the first bounce back node. Towards an open face the walk
+            // continues up to the face, which can be beyond the last coarse node
+            const plint x0 = node[d]*c;
+            const plint steps = inRange ? h : (side ? n[d] - 1 - x0 : x0);
+            plint wall = 0;
+            for (plint k = 1; k <= steps; k++) {
+              if (!lineFluid(d, node, ((x0 + s*k)%n[d] + n[d])%n[d])) {
+                wall = k;
+                break;
+              }
+            }
+            open[side] = false;
+            if (wall) {
+              neighbour[side] = -1;
+              distance[side] = wall - 0.5;
+              const long otherIndex = coarseIndex(other[0], other[1], other[2]);
+              if (inRange && !fluid[otherIndex]) {
+                // Linear through zero at the wall, into the solid coarse node
+                ghosts.push_back({otherIndex, stencil.node, -(h - distance[side])/distance[side]});
+              }
+            } else if (inRange) {
+              neighbour[side] = coarseIndex(other[0], other[1], other[2]);
+              distance[side] = h;
+            } else {
+              open[side] = true;
+            }
+          }
+          if (open[0] && open[1]) {
+            stencil.neighbours[2*d] = stencil.neighbours[2*d+1] = -1;
+            stencil.weights[2*d] = stencil.weights[2*d+1] = 0.;
+            continue;
+          }
+          // Zero gradient at an open face: mirror the other side
+          for (int side = 0; side < 2; side++) {
+            if (open[side]) {
+              neighbour[side] = neighbour[1-side];
+              distance[side] = distance[1-side];
+            }
+          }
+          // Shortley-Weller, second order for unequal distances
+          for (int side = 0; side < 2; side++) {
+            stencil.neighbours[2*d+side] = neighbour[side];
+            stencil.weights[2*d+side] = 2./(distance[side]*(distance[0] + distance[1]));
+            stencil.diagonal += stencil.weights[2*d+side];
+          }
+        }
+        if (stencil.diagonal > 0.) {
+          stencils.push_back(stencil);
+        }
+      }
+    }
+  }
+}
+
+void StokesInitializer::solve() {
+  std::fill(phi, phi + size_t(nc[0])*nc[1]*nc[2], 0.);
+  // Red-black ordering, the nodes of one colour only depend on the other colour
+  std::vector<const Stencil*> colours[2];
+  for (const Stencil & stencil : stencils) {
+    const long node = stencil.node;
+    const plint I = node/(nc[1]*nc[2]), J = (node/nc[2])%nc[1], K = node%nc[2];
+    colours[(I + J + K)%2].push_back(&stencil);
+  }
+  const plint nMax = std::max(nc[0], std::max(nc[1], nc[2]));
+  const T omega = 2./(1. + std::sin(PI/nMax));
+
+  solverResidual = 1.;
+  for (iterations = 0; iterations < maxIterations && solverResidual > tolerance; iterations++) {
+    for (std::vector<const Stencil*> & colour : colours) {
+      for (const Stencil * stencil : colour) {
+        T sum = 1.;
+        for (int k = 0; k < 6; k++) {
+          if (stencil->neighbours[k] >= 0) {
+            sum += stencil->weights[k]*phi[stencil->neighbours[k]];
+          }
+        }
+        T & value = phi[stencil->node];
+        value += omega*(sum/stencil->diagonal - value);
+      }
+    }
+    if (iterations%10 != 9) {
+      continue;
+    }
+    // Residual relative to the right hand side (1 on every node)
+    T residual = 0.;
+    for (const Stencil & stencil : stencils) {
+      T r = 1. - stencil.diagonal*phi[stencil.node];
+      for (int k = 0; k < 6; k++) {
+        if (stencil.neighbours[k] >= 0) {
+          r += stencil.weights[k]*phi[stencil.neighbours[k]];
+        }
+      }
+      residual += r*r;
+    }
+    solverResidual = stencils.empty() ? 0. : std::sqrt(residual/stencils.size());
+  }
+}
+
+void StokesInitializer::fillGhosts() {
+  std::map<long,std::pair<T,int>> values;
+  for (const Ghost & ghost : ghosts) {
+    std::pair<T,int> & value = values[ghost.ghost];
+    value.first += ghost.factor*phi[ghost.node];
+    value.second++;
+  }
+  for (auto const & value : values) {
+    phi[value.first] = value.second.first/value.second.second;
+  }
+}
+
+T StokesInitializer::interpolate(const plint x[3], T gradient[3]) const {
+  plint lower[3], upper[3];
+  T fraction[3], width[3];
+  for (unsigned int d = 0; d < 3; d++) {
+    lower[d] = std::min(x[d]/c, nc[d] - 1);
+    if (lower[d] < nc[d] - 1) {
+      upper[d] = lower[d] + 1;
+      width[d] = c;
+    } else if (periodic[d]) {
+      upper[d] = 0;
+      width[d] = n[d] - c*(nc[d] - 1);
+    } else {
+      // Beyond the last coarse node of an open face, zero gradient
+      upper[d] = lower[d];
+      width[d] = 0.;
+    }
+    fraction[d] = width[d] > 0. ? (x[d] - lower[d]*c)/width[d] : 0.;
+  }
+
+  T value = 0.;
+  gradient[0] = gradient[1] = gradient[2] = 0.;
+  for (int corner = 0; corner < 8; corner++) {
+    const int bit[3] = {corner & 1, (corner >> 1) & 1, (corner >> 2) & 1};
+    T weight[3], slope[3];
+    plint node[3];
+    for (unsigned int d = 0; d < 3; d++) {
+      node[d] = bit[d] ? upper[d] : lower[d];
+      weight[d] = bit[d] ? fraction[d] : 1. - fraction[d];
+      slope[d] = width[d] > 0. ? (bit[d] ? 1. : -1.)/width[d] : 0.;
+    }
+    const T cornerPhi = phi[coarseIndex(node[0], node[1], node[2])];
+    value += weight[0]*weight[1]*weight[2]*cornerPhi;
+    gradient[0] += slope[0]*weight[1]*weight[2]*cornerPhi;
+    gradient[1] += weight[0]*slope[1]*weight[2]*cornerPhi;
+    gradient[2] += weight[0]*weight[1]*slope[2]*cornerPhi;
+  }
+  return value;
+}
+
+void StokesInitializer::initialize(hemo::Array<T,3> force, T rho) {
+  global.statistics.getCurrent()["stokesInitializer"].start();
+  MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &nodeComm);
+  int nodeRank;
+  MPI_Comm_rank(nodeComm, &nodeRank);
+  leader = nodeRank == 0;
+  MPI_Comm_split(MPI_COMM_WORLD, leader ? 0 : MPI_UNDEFINED, 0, &leaderComm);
+
+  gatherGeometry();
+  if (leader) {
+    buildStencils();
+    fluid.clear();
+    fluid.shrink_to_fit();
+  }
+  freeShared(geometryWindow);
+
+  phi = (T *)allocateShared(sizeof(T)*nc[0]*nc[1]*nc[2], phiWindow);
+  T phiMax = 0.;
+  double solveInfo[2] = {0., 0.};
+  if (leader) {
+    solve();
+    fillGhosts();
+    for (const Stencil & stencil : stencils) {
+      phiMax = std::max(phiMax, phi[stencil.node]);
+    }
+    solveInfo[0] = iterations;
+    solveInfo[1] = solverResidual;
+  }
+  syncShared(phiWindow);
+  MPI_Bcast(solveInfo, 2, MPI_DOUBLE, 0, nodeComm);
+  iterations = solveInfo[0];
+  solverResidual = solveInfo[1];
+  const T nu = param::nu_lbm;
+  hlog << "(StokesInitializer) Solved the flow on a " << nc[0] << "x" << nc[1] << "x" << nc[2] << " grid ("
+       << stencils.size() << " fluid nodes) in " << iterations << " iterations, relative residual " << solverResidual
+       << ", maximum velocity " << phiMax*norm(force)/nu << " (lbm units)" << endl;
+  if (solverResidual > tolerance) {
+    hlog << "(StokesInitializer) (Warning) The coarse solve did not reach the tolerance " << tolerance << endl;
+  }
+
+  // Equilibrium with the velocity rho*u minus half the force, which the Guo
+  // forcing adds to the velocity, plus the non equilibrium part of the strain rate
+  MultiBlockLattice3D<FLUID_T,DESCRIPTOR> & lattice = *hemocell.lattice;
+  const T rhoBar = D::rhoBar(rho);
+  const T invRho = D::invRho(rhoBar);
+  for (plint bId : lattice.getLocalInfo().getBlocks()) {
+    BlockLattice3D<FLUID_T,DESCRIPTOR> & block = lattice.getComponent(bId);
+    const Dot3D & location = block.getLocation();
+    Box3D bulk;
+    lattice.getSparseBlockStructure().getBulk(bId, bulk);
+    for (plint x = bulk.x0; x <= bulk.x1; x++) {
+      for (plint y = bulk.y0; y <= bulk.y1; y++) {
+        for (plint z = bulk.z0; z <= bulk.z1; z++) {
+          Cell<FLUID_T,DESCRIPTOR> & cell = block.get(x - location.x, y - location.y, z - location.z);
+          if (cell.getDynamics().isBoundary()) {
+            continue;
+          }
+          const plint g[3] = {x, y, z};
+          T gradient[3];
+          const T value = interpolate(g, gradient);
+
+          plb::Array<T,3> j;
+          for (unsigned int d = 0; d < 3; d++) {
+            j[d] = rho*force[d]/nu*value - 0.5*force[d];
+          }
+          const T jSqr = j[0]*j[0] + j[1]*j[1] + j[2]*j[2];
+
+          // du_a/dx_b = force_a/nu dphi/dx_b, PiNeq = -2 rho cs2 S / omega
+          const T piFactor = -rho*D::cs2/omegaOf(cell)/nu;
+          plb::Array<T,SymmetricTensor<T,DESCRIPTOR>::n> piNeq;
+          int k = 0;
+          for (int a = 0; a < 3; a++) {
+            for (int b = a; b < 3; b++) {
+              piNeq[k++] = piFactor*(force[a]*gradient[b] + force[b]*gradient[a]);
+            }
+          }
+
+          for (plint iPop = 0; iPop < D::q; iPop++) {
+            cell[iPop] = dynamicsTemplates<T,DESCRIPTOR>::bgk_ma2_equilibrium(iPop, rhoBar, invRho, j, jSqr)
+                       + offEquilibriumTemplates<T,DESCRIPTOR>::fromPiToFneq(iPop, piNeq);
+          }
+        }
+      }
+    }
+  }
+  lattice.getBlockCommunicator().duplicateOverlaps(lattice, modif::staticVariables);
+
+  freeShared(phiWindow);
+  phi = 0;
+  stencils.clear();
+  stencils.shrink_to_fit();
+  ghosts.clear();
+  ghosts.shrink_to_fit();
+  if (leaderComm != MPI_COMM_NULL) {
+    MPI_Comm_free(&leaderComm);
+  }
+  MPI_Comm_free(&nodeComm);
+  global.statistics.getCurrent().stop();
+}
+
+T StokesInitializer::residual(hemo::Array<T,3> force, unsigned int window) {
+  const T forceNorm = norm(force);
+  if (forceNorm == 0. || window == 0) {
+    hlog << "(StokesInitializer) (Error) The residual needs a non zero driving force and window" << endl;
+    exit(1);
+  }
+  MultiBlockLattice3D<FLUID_T,DESCRIPTOR> & lattice = *hemocell.lattice;
+  std::vector<T> change;
+  for (int pass = 0; pass < 2; pass++) {
+    if (pass) {
+      for (unsigned int i = 0; i < window; i++) {
+        lattice.collideAndStream();
+      }
+    }
+    size_t i = 0;
+    for (plint bId : lattice.getLocalInfo().getBlocks()) {
+      BlockLattice3D<FLUID_T,DESCRIPTOR> & block = lattice.getComponent(bId);
+      const Dot3D & location = block.getLocation();
+      Box3D bulk;
+      lattice.getSparseBlockStructure().getBulk(bId, bulk);
+      for (plint x = bulk.x0; x <= bulk.x1; x++) {
+        for (plint y = bulk.y0; y <= bulk.y1; y++) {
+          for (plint z = bulk.z0; z <= bulk.z1; z++) {
+            Cell<FLUID_T,DESCRIPTOR> & cell = block.get(x - location.x, y - location.y, z - location.z);
+            if (cell.getDynamics().isBoundary()) {
+              continue;
+            }
+            plb::Array<FLUID_T,3> velocity;
+            cell.computeVelocity(velocity);
+            for (unsigned int d = 0; d < 3; d++, i++) {
+              if (pass) {
+                change[i] = velocity[d] - change[i];
+              } else {
+                change.push_back(velocity[d]);
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+
+  double sum[2] = {0., double(change.size()/3)};
+  for (T du : change) {
+    sum[0] += du*du;
+  }
+  MPI_Allreduce(MPI_IN_PLACE, sum, 2, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+  const T residual = sum[1] > 0. ? std::sqrt(sum[0]/sum[1])/(window*forceNorm) : 0.;
+  hlog << "(StokesInitializer) Fluid residual over " << window << " iterations (mean acceleration relative to the force) " << residual
+       << ", the fluid advanced these " << window << " iterations" << endl;
+  return residual;
+}
+}
@@ -0,0 +1,133 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef HEMO_STOKES_INITIALIZER_H
+#define HEMO_STOKES_INITIALIZER_H
+
+#include "constant_defaults.h"
+#include "array.h"
+
+#include <vector>
+#include <mpi.h>
+
+namespace hemo {
+class HemoCell;
+
+/**
+ * Starts the fluid close to the steady flow driven by a body force, instead of
+ * warming up a fluid at rest for thousands of iterations.
+ *
+ * The Stokes equation without pressure gradient, nu lap(u) = -force, is solved
+ * with red-black SOR on a grid that is coarsening times coarser than the
+ * lattice. The no slip wall lies halfway between a fluid and a bounce back node,
+ * as on the lattice, and is placed at that distance on the coarse grid
+ * (Shortley-Weller), so a straight channel of any cross section gets its
+ * Poiseuille profile, exactly the discrete one with a coarsening of 1. Open
+ * faces of the lattice have a zero gradient, periodic faces wrap. The coarse
+ * geometry and solution live once per node in shared memory: every rank writes
+ * its own lattice nodes into the geometry of its node, the nodes exchange theirs
+ * and the first rank of every node solves, the other ranks read the solution
+ * for their blocks. Both are freed when initialize() returns.
+ *
+ * The solution is interpolated (trilinear) to the lattice, which is set to the
+ * equilibrium plus the non equilibrium part of the interpolated strain rate.
+ * Where the flow is not unidirectional (contractions, bends) this misses the
+ * pressure gradient and secondary flows, residual() tells how far from steady
+ * the fluid still is, so the warm-up can be skipped or shortened.
+ *
+ * Used by the case after the dynamics of the lattice (and its walls) are set:
+ *   StokesInitializer stokes(hemocell, coarsening);
+ *   stokes.initialize(force);
+ *   T r = stokes.residual(force);  // the force must be set on the lattice
+ */
+class StokesInitializer {
+public:
+  StokesInitializer(HemoCell & hemocell_, unsigned int coarsening = 4, T tolerance_ = 1e-6, unsigned int maxIterations_ = 100000);
+
+  /// Solve the coarse flow for the body force (lbm units) and set the lattice to it at density rho
+  void initialize(hemo::Array<T,3> force, T rho = 1.);
+
+  /// Root mean square acceleration of the fluid over window collideAndStream
+  /// calls of the lattice, relative to the acceleration by force: about 1 for a
+  /// fluid at rest, 0 for the steady flow. The window keeps the short lived
+  /// disturbances of the interpolation out. The window time steps are done on
+  /// the lattice itself, so the fluid is window iterations further afterwards
+  T residual(hemo::Array<T,3> force, unsigned int window = 100);
+
+  /// SOR sweeps and relative residual of the last coarse solve
+  unsigned int getIterations() const { return iterations; }
+  T getSolverResidual() const { return solverResidual; }
+
+private:
+  /// Discrete laplacian of a fluid coarse node, index -1 is a wall (zero velocity)
+  struct Stencil {
+    long node;
+    long neighbours[6];
+    T weights[6];
+    T diagonal;
+  };
+  /// Solid coarse node next to a wall, extrapolated from the fluid node with factor
+  struct Ghost {
+    long ghost, node;
+    T factor;
+  };
+
+  /// Shared memory of size bytes on the first rank of the node, locked for the whole node
+  char * allocateShared(MPI_Aint size, MPI_Win & window);
+  void freeShared(MPI_Win & window);
+  /// Make the writes to the shared memory of window visible to the whole node
+  void syncShared(MPI_Win window);
+
+  void gatherGeometry();
+  void buildStencils();
+  void solve();
+  void fillGhosts();
+  /// Interpolated solution phi and its gradient at lattice node x
+  T interpolate(const plint x[3], T gradient[3]) const;
+
+  long coarseIndex(plint I, plint J, plint K) const { return (I*nc[1] + J)*nc[2] + K; }
+  bool lineFluid(unsigned int d, const plint I[3], plint x) const;
+
+  HemoCell & hemocell;
+  const plint c;
+  const T tolerance;
+  const unsigned int maxIterations;
+  plint n[3], nc[3];
+  bool periodic[3];
+  /// Ranks on this node, and the first ranks of all nodes (MPI_COMM_NULL on the others)
+  MPI_Comm nodeComm = MPI_COMM_NULL, leaderComm = MPI_COMM_NULL;
+  bool leader = false;
+  MPI_Win geometryWindow = MPI_WIN_NULL, phiWindow = MPI_WIN_NULL;
+  /// Fluid flag of the lattice nodes on every line of coarse nodes along direction d (shared)
+  unsigned char * lines[3] = {0, 0, 0};
+  /// Only on the first rank of the node
+  std::vector<unsigned char> fluid;
+  std::vector<Stencil> stencils;
+  std::vector<Ghost> ghosts;
+  /// Solution of lap(phi) = -1 on the coarse nodes, walls extrapolated into the solid nodes next to them (shared)
+  T * phi = 0;
+  unsigned int iterations = 0;
+  T solverResidual = 0.;
+};
+}
+#endif
@@ -149,6 +149,83 @@ void getFlagMatrixFromSTL(std::string meshFileName, plint extendedEnvelopeWidth,
     domain = Box3D(nx - 2, nx - 1, 0, ny - 1, 0, nz - 1);
     applyProcessingFunctional(new CopyFromNeighbor(hemo::Array<plint, 3>({-1, 0, 0})), domain, *flagMatrix);
 
+    removeSolidBlocks(flagMatrix);
+}
+
+plint removeSolidBlocks(MultiScalarField3D<int> *& flagMatrix) {
+  SparseBlockStructure3D const & sparse = flagMatrix->getSparseBlockStructure();
+  std::map<plint,Box3D> const & bulks = sparse.getBulks();
+  plint maxId = 0;
+  for (auto const & bulk : bulks) {
+    maxId = std::max(maxId,bulk.first);
+  }
+
+  // 1. Count the fluid cells of each block, including the layer around it, which is needed for the bounceback
+  vector<long> fluidCells(maxId+1,0);
+  for (plint bId : flagMatrix->getLocalInfo().getBlocks()) {
+    ScalarField3D<int> & flags = flagMatrix->getComponent(bId);
+    Dot3D location = flags.getLocation();
+    Box3D domain;
+    if (!intersect(bulks.at(bId).enlarge(1).shift(-location.x,-location.y,-location.z),flags.getBoundingBox(),domain)) {
+      continue;
+    }
+    for (plint x = domain.x0 ; x <= domain.x1 ; x++) {
+      for (plint y = domain.y0 ; y <= domain.y1 ; y++) {
+        for (plint z = domain.z0 ; z <= domain.z1 ; z++) {
+          if (flags.get(x,y,z) == 1) { fluidCells[bId]++; }
+        }
+      }
+    }
+  }
+  MPI_Allreduce(MPI_IN_PLACE,fluidCells.data(),fluidCells.size(),MPI_LONG,MPI_SUM,MPI_COMM_WORLD);
+
+  // 2. Keep the active blocks, and cut them (in id order) in pieces with an equal amount of fluid cells per process
+  SparseBlockStructure3D * reduced = new SparseBlockStructure3D(sparse.getBoundingBox());
+  long totalFluidCells = 0;
+  for (auto const & bulk : bulks) {
+    if (fluidCells[bulk.first]) {
+      Box3D uniqueBulk;
+      sparse.getUniqueBulk(bulk.first,uniqueBulk);
+      reduced->addBlock(bulk.second,uniqueBulk,bulk.first);
+      totalFluidCells += fluidCells[bulk.first];
+    }
+  }
+  if (totalFluidCells == 0) {
+    hlog << "(Voxelizer) (Error) The geometry does not contain any fluid cells, check the STL file and the resolution" << endl;
+    exit(1);
+  }
+  const plint removed = bulks.size() - reduced->getNumBlocks();
+  hlog << "(Voxelizer) Removing " << removed << " of " << bulks.size() << " atomic blocks that are completely solid" << endl;
+  if (removed == 0) {
+    delete reduced;
+    return 0;
+  }
+
+  std::map<plint,plint> blockToMpi;
+  const double share = totalFluidCells/(double)global::mpi().getSize();
+  long passed = 0;
+  for (auto const & bulk : reduced->getBulks()) {
+    plint proc = (passed + fluidCells[bulk.first]/2.)/share;
+    blockToMpi[bulk.first] = std::min(proc,(plint)global::mpi().getSize()-1);
+    passed += fluidCells[bulk.first];
+  }
+
+  // 3. Move the flags to the reduced structure
+  MultiScalarField3D<int> * reducedFlagMatrix = new MultiScalarField3D<int>(
+          MultiBlockManagement3D(*reduced,
+                                 new ExplicitThreadAttribution(blockToMpi),
+                                 flagMatrix->getMultiBlockManagement().getEnvelopeWidth(),
+                                 flagMatrix->getMultiBlockManagement().getRefinementLevel()),
+          defaultMultiBlockPolicy3D().getBlockCommunicator(),
+          defaultMultiBlockPolicy3D().getCombinedStatistics(),
+          defaultMultiBlockPolicy3D().getMultiScalarAccess<int>(),
+          0);
+  delete reduced;
+  copyNonLocal(*flagMatrix,*reducedFlagMatrix,reducedFlagMatrix->getBoundingBox(),modif::staticVariables);
+  reducedFlagMatrix->duplicateOverlaps(modif::staticVariables);
+  delete flagMatrix;
+  flagMatrix = reducedFlagMatrix;
+  return removed;
 }
 
 }
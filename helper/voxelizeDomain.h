@@ -47,6 +47,19 @@ private:
     hemo::Array<plb::plint, 3> offset;
 };
 
+/**
+ * Remove the atomic blocks without a fluid cell (flag 1) in or directly around
+ * them from the flag matrix. The flag matrix is replaced with one on the
+ * reduced block structure, of which the blocks are distributed over the
+ * processes by their number of fluid cells. Returns the number of removed blocks.
+ */
+plint removeSolidBlocks(plb::MultiScalarField3D<int> *& flagMatrix);
+
+/**
+ * Voxelize an stl into a flag matrix (1 is fluid), fully solid atomic blocks
+ * are removed (removeSolidBlocks), so the lattice should be created with
+ * flagMatrix->getMultiBlockManagement()
+ */
 void getFlagMatrixFromSTL(std::string meshFileName, plb::plint extendedEnvelopeWidth, plb::plint refDirLength, plb::plint refDir,
                           plb::VoxelizedDomain3D<T> *&voxelizedDomain, plb::MultiScalarField3D<int> *&flagMatrix, plint blockSize, int particleEnvelope = 0);
 void getFlagMatrixFromSTL(std::string meshFileName, plb::plint extendedEnvelopeWidth, plb::plint refDirLength, plb::plint refDir,
@@ -41,7 +41,6 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 /* Helpers */
 #include "preInlet.h"
-// #include "leesEdwardsBC.h"
 
 /* Always used palabos functions in case files*/
 #ifndef COMPILING_HEMOCELL_LIBRARY
@@ -53,6 +52,22 @@ using namespace plb;
 #endif
 
 namespace hemo { 
+class FluidHaloExchange;
+class FusedFluidKernel;
+class GridRefinement;
+class LeesEdwardsBC;
+
+/// Cost counters of one atomic block, see HemoCell::getBlockCosts()
+struct BlockCostInfo {
+  plint blockId;
+  int fluidNodes;
+  int particles;
+  int completeCells;
+  /// Number of iterations in the window
+  unsigned int samples;
+  /// Wall clock time (s) per functional (and collideAndStream) over the window
+  std::map<std::string,double> times;
+};
 
 /*!
  * The HemoCell class contains all the information, data and methods to set up a
@@ -128,10 +143,6 @@ class HemoCell {
   bool boundaryRepulsionEnabled = false;
   void setRepulsion(T repulsionConstant, T repulsionCutoff);
 
-  // Lees-Edwards boundary condition
-  bool leesEdwardsBC = false;
-  double * LEcurrentDisplacement;
-
   //Set the timescale separation of the particles of a particle type
   void setMaterialTimeScaleSeparation(string name, unsigned int separation);
   
@@ -179,6 +190,10 @@ public:
 
   ///Load a checkpoint
   void loadCheckPoint();
+
+  ///Start from the fluid and cells of a checkpoint of this case at another resolution
+  ///instead of loadParticles(), see CoarseCheckpoint
+  void loadCoarseCheckPoint(std::string directory);
   
   ///Save a checkpoint
   void saveCheckPoint();
@@ -193,9 +208,18 @@ public:
   /// it again after calling iterate
   void iterate();
 
+  /// Fluid part of iterate() when parameters/splitPhaseIterate is set: the
+  /// fluid halo exchange is in flight during the collision of blocks without
+  /// remote neighbours. The particle envelope sync of the same iteration
+  /// overlaps with the cells that are not in any envelope
+  void iterateSplitPhase();
+
   /// Check if any exis signal was caught
   void checkExitSignals();
 
+  /// Cost counters of the local atomic blocks over the last parameters/blockCostWindow iterations
+  vector<BlockCostInfo> getBlockCosts();
+
   //Load balancing library functions
   /// Calculate and return the fractional load imbalance 
   T calculateFractionalLoadImbalance();
@@ -203,11 +227,19 @@ public:
   ///Load balance the domain (only necessary with nAtomic blocks > nMpi processors, also checkpoints
   void doLoadBalance();
   
+  ///Time the block sizes of parameters/tuneBlockSizes for a few iterations and continue with the fastest,
+  ///afterIteration is called after every iteration (e.g. to set the driving force again)
+  void tuneDecomposition(std::function<void()> afterIteration = std::function<void()>());
+
   ///Restructure the grid, has an optional argument to specify whether a checkpoint from this iteration is available, default is YES!
   void doRestructure(bool checkpoint_avail = true);
   
   ///Initialize the fluid field with the given management, should be done after specifing the pre inlets and before initializing the cellfields
   void initializeLattice(MultiBlockManagement3D const & management);
+
+  ///Store only the fluid nodes of flagMatrix (and the walls next to them) when parameters/sparseFluidStorage is set,
+  ///call after all dynamics of the lattice are defined, see SparseFluidStorage
+  void compactFluidStorage(MultiScalarField3D<int> & flagMatrix);
  
   PreInlet * preInlet = 0;
   
@@ -216,8 +248,16 @@ public:
   map<plint,plint> BlockToMpi;
   
   LoadBalancer * loadBalancer = 0;
+  ///Split-phase collide and stream, only created when parameters/splitPhaseIterate is set
+  FluidHaloExchange * fluidHalo = 0;
+  ///Fused collide and stream of the fluid, only created when parameters/fusedFluidKernel is set
+  FusedFluidKernel * fusedFluid = 0;
+  ///Coupling of the (fine) lattice to a coarse lattice around it, created by the case, see GridRefinement
+  GridRefinement * gridRefinement = 0;
+  ///Lees-Edwards boundary condition of the fluid and particles, created by the case, see LeesEdwardsBC
+  LeesEdwardsBC * leesEdwards = 0;
   ///The fluid lattice
-  MultiBlockLattice3D<T, DESCRIPTOR> * lattice = 0, *preinlet_lattice = 0, * domain_lattice = 0;
+  MultiBlockLattice3D<FLUID_T, DESCRIPTOR> * lattice = 0, *preinlet_lattice = 0, * domain_lattice = 0;
   
   MultiBlockManagement3D * preinlet_lattice_management = 0, * domain_lattice_management = 0;
   
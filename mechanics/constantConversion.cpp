@@ -50,6 +50,12 @@ void Parameters::lbm_base_parameters(Config & cfg) {
       tau = 3.0 * nu_lbm + 0.5;
     }
 
+    // Diffusion constant of the CEPAC field, optional
+    try {
+      T D_CEPAC = cfg["domain"]["DCEPAC"].read<T>();
+      tau_CEPAC = 3.0 * D_CEPAC * dt / (dx*dx) + 0.5;
+    } catch (std::invalid_argument & e) {}
+
     dm = rho_p * (dx * dx *dx);
     df = dm * dx / (dt * dt);
 #ifdef FORCE_LIMIT
@@ -109,6 +115,9 @@ void Parameters::printParameters() {
   hlog << "\t tau: \t" << tau << std::endl;
   hlog << "\t nu_lbm: \t" << nu_lbm << std::endl;
   hlog << "\t u_lb_max: \t" << u_lbm_max << std::endl;
+  if (tau_CEPAC > 0.0) {
+    hlog << "\t tau_CEPAC: \t" << tau_CEPAC << std::endl;
+  }
 #ifdef FORCE_LIMIT
   hlog << "\t f_limit: \t" << f_limit << std::endl;
 #endif
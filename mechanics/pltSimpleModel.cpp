@@ -23,7 +23,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include "pltSimpleModel.h"
 #include "logfile.h"
-#include "octree.h"
+#include "cellBVH.h"
 #include "mollerTrumbore.h"
 
 #include "palabos3D.h"
@@ -208,7 +208,7 @@ void PltSimpleModel::ParticleMechanics(map<int,vector<HemoCellParticle *>> & par
 }
 
 #ifdef SOLIDIFY_MECHANICS
-void PltSimpleModel::solidifyMechanics(const std::map<int,std::vector<int>>& ppc,std::vector<HemoCellParticle>& particles,plb::BlockLattice3D<T,DESCRIPTOR> * fluid,plb::BlockLattice3D<T,CEPAC_DESCRIPTOR> * CEPAC, pluint ctype, HemoCellParticleField & pf) {
+void PltSimpleModel::solidifyMechanics(const std::map<int,std::vector<int>>& ppc,std::vector<HemoCellParticle>& particles,plb::BlockLattice3D<FLUID_T,DESCRIPTOR> * fluid,plb::BlockLattice3D<CEPAC_T,CEPAC_DESCRIPTOR> * CEPAC, pluint ctype, HemoCellParticleField & pf) {
   //For all cells
   for (auto & pair : ppc) {
     bool broken = false;
@@ -233,13 +233,13 @@ void PltSimpleModel::solidifyMechanics(const std::map<int,std::vector<int>>& ppc
 
     // If it was tagged last round, solidify it now
     if (solidify) {
-      hemo::OctreeStructCell octCell(3, 1, 30, cellConstants.triangle_list, particles, cell);
+      const hemo::CellBVH & bvh = hemo::CellBVH::forCell(cellConstants.triangle_list, particles, cell);
  
       set<Array<plint,3>> innerNodes;
-      octCell.findInnerNodes(fluid,particles,cell,innerNodes);
+      bvh.findInnerNodes(fluid,innerNodes);
       for (const Array<plint,3> & node : innerNodes) {
           if (!fluid->get(node[0],node[1],node[2]).getDynamics().isBoundary()) {
-          defineDynamics(*fluid,node[0],node[1],node[2],new BounceBack<T,DESCRIPTOR>(1.));
+          defineDynamics(*fluid,node[0],node[1],node[2],new BounceBack<FLUID_T,DESCRIPTOR>(1.));
           bindingFieldHelper::get(*pf.cellFields).add(pf, {node[0],node[1],node[2]});
         }
       }
@@ -46,7 +46,7 @@ class PltSimpleModel : public CellMechanics {
 
   void ParticleMechanics(map<int,vector<HemoCellParticle *>> &particles_per_cell, const map<int,bool> &lpc, pluint ctype);
 #ifdef SOLIDIFY_MECHANICS
-  void solidifyMechanics(const std::map<int,std::vector<int>>&,std::vector<HemoCellParticle>&,plb::BlockLattice3D<T,DESCRIPTOR> *,plb::BlockLattice3D<T,CEPAC_DESCRIPTOR> *, pluint ctype, HemoCellParticleField&);
+  void solidifyMechanics(const std::map<int,std::vector<int>>&,std::vector<HemoCellParticle>&,plb::BlockLattice3D<FLUID_T,DESCRIPTOR> *,plb::BlockLattice3D<CEPAC_T,CEPAC_DESCRIPTOR> *, pluint ctype, HemoCellParticleField&);
 #endif
   void statistics();
 
@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+"""
+Compare the output of two runs of a case, typically examples/pipeflow with the
+fluid populations stored in double and in float (FLUID_T in
+config/constant_defaults.h). Both runs must use the same config and atomic
+block decomposition.
+
+Compared are
+  - the velocity profile over the pipe radius (Fluid hdf5 output, flow along x)
+  - the deformation of the cells (csv output): area, volume and reduced volume
+
+usage: compare_precision.py <reference output dir> <output dir> [options]
+"""
+import argparse
+import os
+import sys
+from glob import glob
+
+import h5py as h5
+import numpy as np
+
+
+def iterations(outDir, subDir, pattern):
+    its = set()
+    for name in glob(os.path.join(outDir, subDir, pattern)):
+        its.add(int(os.path.basename(name).split('.')[1 if subDir == 'csv' else 0]))
+    return its
+
+
+def readFluid(outDir, iteration):
+    """ Coordinates and velocity of every fluid node, without the envelopes """
+    coords, vels = [], []
+    files = glob(os.path.join(outDir, 'hdf5', '%012d' % iteration, 'Fluid.*.p.*.h5'))
+    if not files:
+        sys.exit("No Fluid output of iteration %d in %s" % (iteration, outDir))
+    for name in files:
+        with h5.File(name, 'r') as f:
+            vel = f['Velocity'][1:-1, 1:-1, 1:-1, :]  # Stored as z,y,x with an envelope of 1
+            rp = f.attrs['relativePosition'] + 1
+        z, y, x = np.meshgrid(*[rp[d] + np.arange(vel.shape[d]) for d in range(3)], indexing='ij')
+        coords.append(np.stack([x.ravel(), y.ravel(), z.ravel()], axis=1))
+        vels.append(vel.reshape(-1, 3))
+    coords, vels = np.concatenate(coords), np.concatenate(vels)
+    order = np.lexsort(coords.T[::-1])
+    return coords[order], vels[order]
+
+
+def radialProfile(coords, vels):
+    """ Mean axial velocity per unit wide bin of distance to the pipe axis """
+    yc = 0.5*(coords[:, 1].min() + coords[:, 1].max())
+    zc = 0.5*(coords[:, 2].min() + coords[:, 2].max())
+    r = np.sqrt((coords[:, 1]-yc)**2 + (coords[:, 2]-zc)**2)
+    bins = np.floor(r).astype(int)
+    count = np.bincount(bins)
+    profile = np.bincount(bins, weights=vels[:, 0]) / np.maximum(count, 1)
+    return profile, count
+
+
+def readCells(outDir, cellType, iteration):
+    name = os.path.join(outDir, 'csv', '%s.%012d.csv' % (cellType, iteration))
+    if not os.path.exists(name):
+        return None
+    data = np.genfromtxt(name, delimiter=',', names=True)
+    data = np.atleast_1d(data)
+    return data[np.argsort(data['cellId'])]
+
+
+def reducedVolume(cells):
+    """ Volume relative to a sphere with the same area, 1 for a sphere """
+    return 6.*np.sqrt(np.pi)*cells['volume']/cells['area']**1.5
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('reference', help='output directory of the reference (double) run')
+    parser.add_argument('candidate', help='output directory of the run to validate')
+    parser.add_argument('--iteration', type=int, help='iteration to compare (default: last common fluid output)')
+    parser.add_argument('--profile-tolerance', type=float, default=1e-3,
+                        help='allowed deviation of the velocity profile relative to the maximum velocity')
+    parser.add_argument('--deformation-tolerance', type=float, default=1e-3,
+                        help='allowed relative deviation of the mean reduced volume of a cell type')
+    args = parser.parse_args()
+
+    iteration = args.iteration
+    if iteration is None:
+        common = iterations(args.reference, 'hdf5', '*') & iterations(args.candidate, 'hdf5', '*')
+        if not common:
+            sys.exit("No common fluid output iterations")
+        iteration = max(common)
+    print("Comparing iteration %d of %s against %s" % (iteration, args.candidate, args.reference))
+    failed = False
+
+    refCoords, refVel = readFluid(args.reference, iteration)
+    coords, vel = readFluid(args.candidate, iteration)
+    if refCoords.shape != coords.shape or not np.allclose(refCoords, coords):
+        sys.exit("The fluid domains differ, were the runs done with the same config and decomposition?")
+    uMax = np.abs(refVel[:, 0]).max()
+    if uMax == 0.:
+        sys.exit("The reference run has no flow")
+    nodeDeviation = np.abs(vel - refVel).max()/uMax
+
+    refProfile, count = radialProfile(refCoords, refVel)
+    profile, _ = radialProfile(coords, vel)
+    profileDeviation = np.abs(profile - refProfile)[count > 0].max()/uMax
+    print("\nVelocity profile (u_x, lattice units)")
+    print("%6s %8s %14s %14s %12s" % ("r", "nodes", "reference", "candidate", "deviation"))
+    for r in np.nonzero(count)[0]:
+        print("%6d %8d %14.6e %14.6e %12.3e" % (r, count[r], refProfile[r], profile[r], abs(profile[r]-refProfile[r])/uMax))
+    print("Maximum deviation relative to u_max: profile %.3e, single node %.3e" % (profileDeviation, nodeDeviation))
+    if profileDeviation > args.profile_tolerance:
+        print("FAILED: profile deviation above %g" % args.profile_tolerance)
+        failed = True
+
+    print("\nCell deformation")
+    for cellType in ('RBC', 'PLT'):
+        refCells = readCells(args.reference, cellType, iteration)
+        cells = readCells(args.candidate, cellType, iteration)
+        if refCells is None or cells is None or len(refCells) == 0:
+            continue
+        refRv, rv = reducedVolume(refCells), reducedVolume(cells)
+        meanDeviation = abs(rv.mean() - refRv.mean())/refRv.mean()
+        print("%s: %d cells, mean reduced volume %.6f (reference %.6f), std %.6f (reference %.6f), deviation %.3e" %
+              (cellType, len(cells), rv.mean(), refRv.mean(), rv.std(), refRv.std(), meanDeviation))
+        if len(cells) == len(refCells) and np.all(cells['cellId'] == refCells['cellId']):
+            pos = np.stack([cells[c] for c in 'XYZ'], axis=1)
+            refPos = np.stack([refCells[c] for c in 'XYZ'], axis=1)
+            print("%s: per cell maximum relative deviation of area %.3e, volume %.3e, reduced volume %.3e, "
+                  "maximum displacement %.3e" %
+                  (cellType, (np.abs(cells['area']-refCells['area'])/refCells['area']).max(),
+                   (np.abs(cells['volume']-refCells['volume'])/refCells['volume']).max(),
+                   (np.abs(rv-refRv)/refRv).max(), np.sqrt(((pos-refPos)**2).sum(axis=1)).max()))
+        else:
+            print("%s: the runs contain different cells, only the mean is compared" % cellType)
+        if meanDeviation > args.deformation_tolerance:
+            print("FAILED: %s deformation deviation above %g" % (cellType, args.deformation_tolerance))
+            failed = True
+
+    if failed:
+        sys.exit(1)
+    print("\nPASSED")
+
+
+if __name__ == '__main__':
+    main()